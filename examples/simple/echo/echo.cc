@@ -2,6 +2,8 @@
 
 #include "muduo/base/Logging.h"
 
+#include <sched.h>
+
 using std::placeholders::_1;
 using std::placeholders::_2;
 using std::placeholders::_3;
@@ -10,8 +12,11 @@ using std::placeholders::_3;
 // using namespace muduo::net;
 
 EchoServer::EchoServer(muduo::net::EventLoop *loop,
-                       const muduo::net::InetAddress &listenAddr)
-    : server_(loop, listenAddr, "EchoServer") {
+                       const muduo::net::InetAddress &listenAddr,
+                       muduo::net::TcpServer::Option option)
+    : server_(loop, listenAddr, "EchoServer", option),
+      numConnections_(0),
+      numLocal_(0) {
     server_.setConnectionCallback(
         std::bind(&EchoServer::onConnection, this, _1));
     server_.setMessageCallback(
@@ -27,6 +32,12 @@ void EchoServer::onConnection(const muduo::net::TcpConnectionPtr &conn) {
     LOG_INFO << "EchoServer - " << conn->peerAddress().toIpPort() << " -> "
            << conn->localAddress().toIpPort() << " is "
            << (conn->connected() ? "UP" : "DOWN");
+    if (conn->connected()) {
+        ++numConnections_;
+        if (conn->incomingCpu() == ::sched_getcpu()) {
+            ++numLocal_;
+        }
+    }
 }
 
 void EchoServer::onMessage(const muduo::net::TcpConnectionPtr &conn,
@@ -3,15 +3,25 @@
 
 #include "muduo/net/TcpServer.h"
 
+#include <atomic>
+
 // RFC 862
 class EchoServer
 {
  public:
   EchoServer(muduo::net::EventLoop* loop,
-             const muduo::net::InetAddress& listenAddr);
+             const muduo::net::InetAddress& listenAddr,
+             muduo::net::TcpServer::Option option = muduo::net::TcpServer::kNoReusePort);
+
+  void setThreadNum(int numThreads) { server_.setThreadNum(numThreads); }
+  void setCpuSteering(bool on) { server_.setCpuSteering(on); }
 
   void start();  // calls server_.start();
 
+  // connections, and those served on the CPU that received them
+  int numConnections() const { return numConnections_.load(); }
+  int numLocal() const { return numLocal_.load(); }
+
  private:
   void onConnection(const muduo::net::TcpConnectionPtr& conn);
 
@@ -20,6 +30,8 @@ class EchoServer
                  muduo::Timestamp time);
 
   muduo::net::TcpServer server_;
+  std::atomic<int> numConnections_;
+  std::atomic<int> numLocal_;
 };
 
 #endif  // MUDUO_EXAMPLES_SIMPLE_ECHO_ECHO_H
@@ -3,13 +3,123 @@
 #include "muduo/base/Logging.h"
 #include "muduo/net/EventLoop.h"
 
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
 #include <unistd.h>
 
 // using namespace muduo;
 // using namespace muduo::net;
 
-int main()
+// Clients ping-pong 64-byte messages over many connections, to a server
+// with an SO_REUSEPORT listener in each I/O thread, optionally steered
+// by CPU.  Reports round trips per second, and how many connections were
+// served on the CPU that received them.
+void bench(int numThreads, bool steer, int numConnections, double seconds)
 {
+    muduo::Logger::setLogLevel(muduo::Logger::WARN);
+    const uint16_t kPort = 2007;
+    muduo::net::EventLoop loop;
+    EchoServer server(&loop, muduo::net::InetAddress(kPort),
+                      muduo::net::TcpServer::kReusePortPerLoop);
+    server.setThreadNum(numThreads);
+    server.setCpuSteering(steer);
+    server.start();
+
+    const int kClients = 4;
+    std::atomic<int64_t> roundTrips(0);
+    std::vector<std::thread> clients;
+    for (int c = 0; c < kClients; ++c)
+    {
+        clients.emplace_back([&, c] {
+            struct sockaddr_in addr;
+            memset(&addr, 0, sizeof addr);
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(kPort);
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            std::vector<int> fds;
+            for (int i = c; i < numConnections; i += kClients)
+            {
+                int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+                if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr) < 0)
+                {
+                    perror("connect");
+                    ::close(fd);
+                    break;
+                }
+                fds.push_back(fd);
+            }
+            char message[64] = { 0 };
+            int64_t count = 0;
+            muduo::Timestamp start(muduo::Timestamp::now());
+            while (timeDifference(muduo::Timestamp::now(), start) < seconds)
+            {
+                for (int fd : fds)
+                {
+                    if (::write(fd, message, sizeof message) != sizeof message)
+                    {
+                        perror("write");
+                    }
+                }
+                for (int fd : fds)
+                {
+                    size_t n = 0;
+                    while (n < sizeof message)
+                    {
+                        ssize_t nr = ::read(fd, message + n, sizeof message - n);
+                        if (nr <= 0)
+                        {
+                            perror("read");
+                            return;
+                        }
+                        n += static_cast<size_t>(nr);
+                    }
+                }
+                count += static_cast<int64_t>(fds.size());
+            }
+            roundTrips += count;
+            for (int fd : fds)
+            {
+                ::close(fd);
+            }
+        });
+    }
+    std::thread waiter([&] {
+        for (std::thread& client : clients)
+        {
+            client.join();
+        }
+        loop.quit();
+    });
+    loop.loop();
+    waiter.join();
+    printf("%d threads %s: %.0f round trips/s, %d of %d connections on the CPU that received them\n",
+           numThreads, steer ? "steered by CPU" : "by hash",
+           static_cast<double>(roundTrips.load()) / seconds,
+           server.numLocal(), server.numConnections());
+}
+
+// usage: simple_echo
+//        simple_echo bench [threads [steer [connections [seconds]]]]
+int main(int argc, char* argv[])
+{
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+    {
+        int numThreads = argc > 2 ? atoi(argv[2]) : static_cast<int>(::sysconf(_SC_NPROCESSORS_ONLN));
+        bool steer = argc > 3 ? atoi(argv[3]) != 0 : true;
+        int numConnections = argc > 4 ? atoi(argv[4]) : 100;
+        double seconds = argc > 5 ? atof(argv[5]) : 5;
+        bench(numThreads, steer, numConnections, seconds);
+        return 0;
+    }
+
     LOG_INFO << "pid = " << getpid();
     muduo::Logger::setLogLevel(muduo::Logger::TRACE);
     muduo::net::EventLoop loop;
@@ -0,0 +1,241 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_MOVEONLYFUNCTION_H
+#define MUDUO_BASE_MOVEONLYFUNCTION_H
+
+#include <assert.h>
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace muduo
+{
+
+template<typename Signature>
+class MoveOnlyFunction;
+
+///
+/// A std::function that is movable but not copyable, so it can hold
+/// a closure that owns a Buffer or a std::unique_ptr.
+///
+/// Callables up to kInlineSize bytes are stored inline, no allocation,
+/// larger ones go to the heap.  An empty std::function or a null pointer
+/// makes an empty one, as std::function does.
+///
+template<typename R, typename... ARGS>
+class MoveOnlyFunction<R (ARGS...)>
+{
+ public:
+  static const size_t kInlineSize = 80;
+
+  MoveOnlyFunction() noexcept
+    : ops_(NULL)
+  {
+  }
+
+  MoveOnlyFunction(std::nullptr_t) noexcept
+    : ops_(NULL)
+  {
+  }
+
+  template<typename F,
+           typename = typename std::enable_if<
+               !std::is_same<typename std::decay<F>::type, MoveOnlyFunction>::value>::type>
+  MoveOnlyFunction(F&& f)
+    : ops_(NULL)
+  {
+    typedef typename std::decay<F>::type Fn;
+    if (!isNull(f))
+    {
+      construct<Fn>(std::forward<F>(f), std::integral_constant<bool, isInline<Fn>()>());
+    }
+  }
+
+  MoveOnlyFunction(MoveOnlyFunction&& rhs) noexcept
+    : ops_(rhs.ops_)
+  {
+    if (ops_)
+    {
+      ops_->move(&rhs.storage_, &storage_);
+      rhs.ops_ = NULL;
+    }
+  }
+
+  MoveOnlyFunction& operator=(MoveOnlyFunction&& rhs) noexcept
+  {
+    if (this != &rhs)
+    {
+      reset();
+      if (rhs.ops_)
+      {
+        rhs.ops_->move(&rhs.storage_, &storage_);
+        ops_ = rhs.ops_;
+        rhs.ops_ = NULL;
+      }
+    }
+    return *this;
+  }
+
+  MoveOnlyFunction& operator=(std::nullptr_t) noexcept
+  {
+    reset();
+    return *this;
+  }
+
+  MoveOnlyFunction(const MoveOnlyFunction&) = delete;
+  MoveOnlyFunction& operator=(const MoveOnlyFunction&) = delete;
+
+  ~MoveOnlyFunction()
+  {
+    reset();
+  }
+
+  explicit operator bool() const noexcept
+  { return ops_ != NULL; }
+
+  // const as std::function, the callable itself may be mutated.
+  R operator()(ARGS... args) const
+  {
+    assert(ops_ != NULL);
+    return ops_->invoke(const_cast<Storage*>(&storage_), std::forward<ARGS>(args)...);
+  }
+
+ private:
+  union Storage
+  {
+    void* heap;
+    typename std::aligned_storage<kInlineSize, alignof(std::max_align_t)>::type inlined;
+  };
+
+  struct Ops
+  {
+    R (*invoke)(Storage*, ARGS&&...);
+    void (*move)(Storage* from, Storage* to);  // and destroys from
+    void (*destroy)(Storage*);
+  };
+
+  template<typename Sig>
+  static bool isNull(const std::function<Sig>& f)
+  { return !f; }
+
+  template<typename Sig>
+  static bool isNull(const MoveOnlyFunction<Sig>& f)
+  { return !f; }
+
+  template<typename T>
+  static bool isNull(T* p)
+  { return p == NULL; }
+
+  template<typename T, typename C>
+  static bool isNull(T C::* p)
+  { return p == NULL; }
+
+  template<typename F>
+  static bool isNull(const F&)
+  { return false; }
+
+  template<typename Fn>
+  static constexpr bool isInline()
+  {
+    return sizeof(Fn) <= kInlineSize
+        && alignof(Fn) <= alignof(Storage)
+        && std::is_nothrow_move_constructible<Fn>::value;
+  }
+
+  template<typename Fn>
+  struct InlineOps
+  {
+    static Fn* get(Storage* s)
+    { return static_cast<Fn*>(static_cast<void*>(&s->inlined)); }
+
+    static R invoke(Storage* s, ARGS&&... args)
+    { return (*get(s))(std::forward<ARGS>(args)...); }
+
+    static void move(Storage* from, Storage* to)
+    {
+      ::new (static_cast<void*>(&to->inlined)) Fn(std::move(*get(from)));
+      get(from)->~Fn();
+    }
+
+    static void destroy(Storage* s)
+    { get(s)->~Fn(); }
+
+    static const Ops ops;
+  };
+
+  template<typename Fn>
+  struct HeapOps
+  {
+    static Fn* get(Storage* s)
+    { return static_cast<Fn*>(s->heap); }
+
+    static R invoke(Storage* s, ARGS&&... args)
+    { return (*get(s))(std::forward<ARGS>(args)...); }
+
+    static void move(Storage* from, Storage* to)
+    {
+      to->heap = from->heap;
+      from->heap = NULL;
+    }
+
+    static void destroy(Storage* s)
+    { delete get(s); }
+
+    static const Ops ops;
+  };
+
+  template<typename Fn, typename F>
+  void construct(F&& f, std::true_type)
+  {
+    ::new (static_cast<void*>(&storage_.inlined)) Fn(std::forward<F>(f));
+    ops_ = &InlineOps<Fn>::ops;
+  }
+
+  template<typename Fn, typename F>
+  void construct(F&& f, std::false_type)
+  {
+    storage_.heap = new Fn(std::forward<F>(f));
+    ops_ = &HeapOps<Fn>::ops;
+  }
+
+  void reset() noexcept
+  {
+    if (ops_)
+    {
+      ops_->destroy(&storage_);
+      ops_ = NULL;
+    }
+  }
+
+  const Ops* ops_;
+  Storage storage_;
+};
+
+template<typename R, typename... ARGS>
+template<typename Fn>
+const typename MoveOnlyFunction<R (ARGS...)>::Ops
+MoveOnlyFunction<R (ARGS...)>::InlineOps<Fn>::ops =
+{
+  &InlineOps<Fn>::invoke, &InlineOps<Fn>::move, &InlineOps<Fn>::destroy
+};
+
+template<typename R, typename... ARGS>
+template<typename Fn>
+const typename MoveOnlyFunction<R (ARGS...)>::Ops
+MoveOnlyFunction<R (ARGS...)>::HeapOps<Fn>::ops =
+{
+  &HeapOps<Fn>::invoke, &HeapOps<Fn>::move, &HeapOps<Fn>::destroy
+};
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_MOVEONLYFUNCTION_H
@@ -0,0 +1,166 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_MPSCQUEUE_H
+#define MUDUO_BASE_MPSCQUEUE_H
+
+#include "muduo/base/noncopyable.h"
+
+#include <assert.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+namespace muduo
+{
+
+///
+/// Unbounded lock-free queue, many threads push, one thread pops.
+///
+/// A linked list after Dmitry Vyukov's, push is one exchange.
+/// Nodes come from a preallocated pool with a lock-free free list,
+/// from the heap only when the pool runs out.
+/// FIFO for each pushing thread.
+///
+template<typename T>
+class MpscQueue : noncopyable
+{
+ public:
+  explicit MpscQueue(uint32_t poolSize = 1024)
+    : poolSize_(poolSize),
+      pool_(new Node[poolSize]),
+      freeHead_(0),
+      size_(0)
+  {
+    for (uint32_t i = 0; i < poolSize_; ++i)
+    {
+      pool_[i].pooled = true;
+      deallocate(&pool_[i]);
+    }
+    Node* dummy = allocate();
+    head_.store(dummy, std::memory_order_relaxed);
+    tail_ = dummy;
+  }
+
+  ~MpscQueue()
+  {
+    T x;
+    while (pop(&x))
+    {
+    }
+    deallocate(tail_);
+  }
+
+  /// Thread safe.
+  void push(T&& x)
+  {
+    Node* node = allocate();
+    node->value = std::move(x);
+    node->next.store(NULL, std::memory_order_relaxed);
+    size_.fetch_add(1, std::memory_order_relaxed);
+    Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+    // between the exchange and this store, the queue ends at prev for pop()
+    prev->next.store(node, std::memory_order_release);
+  }
+
+  /// Consumer thread only.
+  /// @return false if empty, or the next push is not finished yet.
+  bool pop(T* x)
+  {
+    Node* tail = tail_;
+    Node* next = tail->next.load(std::memory_order_acquire);
+    if (next == NULL)
+    {
+      return false;
+    }
+    // next becomes the dummy, its value is taken
+    *x = std::move(next->value);
+    tail_ = next;
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    deallocate(tail);
+    return true;
+  }
+
+  /// Approximate when pushing concurrently.
+  size_t size() const
+  {
+    int64_t n = size_.load(std::memory_order_relaxed);
+    return n > 0 ? static_cast<size_t>(n) : 0;
+  }
+
+ private:
+  struct Node
+  {
+    Node() : next(NULL), freeNext(0), pooled(false) {}
+
+    T value;
+    std::atomic<Node*> next;
+    // 1-based index of the next free node in pool_, 0 ends the list
+    std::atomic<uint32_t> freeNext;
+    bool pooled;
+  };
+
+  // the free list head is a 1-based index tagged with a counter against ABA
+  static uint64_t pack(uint32_t tag, uint32_t index)
+  { return static_cast<uint64_t>(tag) << 32 | index; }
+
+  static uint32_t indexOf(uint64_t head)
+  { return static_cast<uint32_t>(head); }
+
+  static uint32_t tagOf(uint64_t head)
+  { return static_cast<uint32_t>(head >> 32); }
+
+  Node* allocate()
+  {
+    uint64_t head = freeHead_.load(std::memory_order_acquire);
+    while (indexOf(head) != 0)
+    {
+      Node* node = &pool_[indexOf(head) - 1];
+      // may be stale if another thread took node, then the CAS fails
+      uint64_t next = pack(tagOf(head) + 1, node->freeNext.load(std::memory_order_relaxed));
+      if (freeHead_.compare_exchange_weak(head, next,
+                                          std::memory_order_acquire,
+                                          std::memory_order_acquire))
+      {
+        return node;
+      }
+    }
+    return new Node;
+  }
+
+  void deallocate(Node* node)
+  {
+    node->value = T();
+    if (!node->pooled)
+    {
+      delete node;
+      return;
+    }
+    const uint32_t index = static_cast<uint32_t>(node - pool_.get()) + 1;
+    uint64_t head = freeHead_.load(std::memory_order_relaxed);
+    do
+    {
+      node->freeNext.store(indexOf(head), std::memory_order_relaxed);
+    } while (!freeHead_.compare_exchange_weak(head, pack(tagOf(head) + 1, index),
+                                              std::memory_order_release,
+                                              std::memory_order_relaxed));
+  }
+
+  const uint32_t poolSize_;
+  std::unique_ptr<Node[]> pool_;
+  std::atomic<uint64_t> freeHead_;
+  std::atomic<Node*> head_;  // last pushed
+  Node* tail_;  // dummy, consumer only
+  std::atomic<int64_t> size_;
+};
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_MPSCQUEUE_H
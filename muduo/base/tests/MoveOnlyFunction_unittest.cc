@@ -0,0 +1,136 @@
+#include "muduo/base/MoveOnlyFunction.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+
+//#define BOOST_TEST_MODULE MoveOnlyFunctionTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using muduo::MoveOnlyFunction;
+
+namespace
+{
+
+int g_alive = 0;
+
+struct Counted
+{
+  explicit Counted(int* sum) : sum_(sum) { ++g_alive; }
+  Counted(const Counted& rhs) : sum_(rhs.sum_) { ++g_alive; }
+  Counted(Counted&& rhs) noexcept : sum_(rhs.sum_) { ++g_alive; }
+  ~Counted() { --g_alive; }
+
+  void operator()(int x) { *sum_ += x; }
+
+  int* sum_;
+};
+
+struct Large : Counted
+{
+  explicit Large(int* sum) : Counted(sum) { padding[0] = 0; }
+  char padding[256];
+};
+
+void addTo(std::unique_ptr<int>& p, int x)
+{
+  *p += x;
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(testMoveOnlyFunctionInline)
+{
+  int sum = 0;
+  {
+    MoveOnlyFunction<void (int)> f{Counted(&sum)};
+    BOOST_CHECK(f);
+    BOOST_CHECK_EQUAL(g_alive, 1);
+    f(1);
+    MoveOnlyFunction<void (int)> g(std::move(f));
+    BOOST_CHECK(!f);
+    BOOST_CHECK(g);
+    BOOST_CHECK_EQUAL(g_alive, 1);
+    g(2);
+    f = std::move(g);
+    f(3);
+    BOOST_CHECK_EQUAL(g_alive, 1);
+    f = nullptr;
+    BOOST_CHECK(!f);
+    BOOST_CHECK_EQUAL(g_alive, 0);
+  }
+  BOOST_CHECK_EQUAL(sum, 6);
+  BOOST_CHECK_EQUAL(g_alive, 0);
+}
+
+BOOST_AUTO_TEST_CASE(testMoveOnlyFunctionHeap)
+{
+  int sum = 0;
+  {
+    MoveOnlyFunction<void (int)> f{Large(&sum)};
+    BOOST_CHECK_EQUAL(g_alive, 1);
+    f(1);
+    MoveOnlyFunction<void (int)> g;
+    BOOST_CHECK(!g);
+    g = std::move(f);
+    BOOST_CHECK_EQUAL(g_alive, 1);
+    g(2);
+  }
+  BOOST_CHECK_EQUAL(sum, 3);
+  BOOST_CHECK_EQUAL(g_alive, 0);
+}
+
+BOOST_AUTO_TEST_CASE(testMoveOnlyFunctionMoveOnlyCapture)
+{
+  std::unique_ptr<int> p(new int(10));
+  int* raw = p.get();
+  MoveOnlyFunction<void (int)> f(std::bind(&addTo, std::move(p), std::placeholders::_1));
+  f(5);
+  BOOST_CHECK_EQUAL(*raw, 15);
+
+  std::string s(1000, 'x');
+  const char* data = s.data();
+  MoveOnlyFunction<size_t ()> g(
+      std::bind([](std::string& str) { return str.size(); }, std::move(s)));
+  MoveOnlyFunction<size_t ()> h(std::move(g));
+  BOOST_CHECK_EQUAL(h(), 1000);
+  // moved, not copied
+  BOOST_CHECK(s.empty() || s.data() != data);
+}
+
+BOOST_AUTO_TEST_CASE(testMoveOnlyFunctionFromStdFunction)
+{
+  int sum = 0;
+  std::function<void (int)> stdf = Counted(&sum);
+  MoveOnlyFunction<void (int)> f(stdf);
+  MoveOnlyFunction<void (int)> g(std::move(stdf));
+  f(1);
+  g(2);
+  BOOST_CHECK_EQUAL(sum, 3);
+}
+
+BOOST_AUTO_TEST_CASE(testMoveOnlyFunctionFromEmpty)
+{
+  std::function<void (int)> stdf;
+  MoveOnlyFunction<void (int)> f(stdf);
+  BOOST_CHECK(!f);
+  MoveOnlyFunction<void (int)> g(std::move(stdf));
+  BOOST_CHECK(!g);
+  MoveOnlyFunction<void ()> h = std::function<void ()>();
+  BOOST_CHECK(!h);
+
+  void (*null)(int) = NULL;
+  MoveOnlyFunction<void (int)> p(null);
+  BOOST_CHECK(!p);
+
+  std::unique_ptr<int> sum(new int(0));
+  MoveOnlyFunction<void (std::unique_ptr<int>&, int)> q(&addTo);
+  BOOST_CHECK(q);
+  MoveOnlyFunction<void (std::unique_ptr<int>&, int)> r(addTo);
+  BOOST_CHECK(r);
+  q(sum, 1);
+  r(sum, 2);
+  BOOST_CHECK_EQUAL(*sum, 3);
+}
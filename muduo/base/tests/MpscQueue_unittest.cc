@@ -0,0 +1,92 @@
+#include "muduo/base/MpscQueue.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+//#define BOOST_TEST_MODULE MpscQueueTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using muduo::MpscQueue;
+
+BOOST_AUTO_TEST_CASE(testMpscQueueFifo)
+{
+  MpscQueue<int> queue(4);
+  int x = 0;
+  BOOST_CHECK(!queue.pop(&x));
+  BOOST_CHECK_EQUAL(queue.size(), 0);
+  // more than the pool, the rest comes from the heap
+  for (int i = 0; i < 10; ++i)
+  {
+    queue.push(std::move(i));
+  }
+  BOOST_CHECK_EQUAL(queue.size(), 10);
+  for (int i = 0; i < 10; ++i)
+  {
+    BOOST_REQUIRE(queue.pop(&x));
+    BOOST_CHECK_EQUAL(x, i);
+  }
+  BOOST_CHECK(!queue.pop(&x));
+  BOOST_CHECK_EQUAL(queue.size(), 0);
+  // and back to the pool
+  for (int i = 0; i < 3; ++i)
+  {
+    queue.push(std::move(i));
+    BOOST_REQUIRE(queue.pop(&x));
+    BOOST_CHECK_EQUAL(x, i);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testMpscQueueMoveOnly)
+{
+  MpscQueue<std::unique_ptr<int>> queue;
+  queue.push(std::unique_ptr<int>(new int(42)));
+  queue.push(std::unique_ptr<int>(new int(43)));
+  std::unique_ptr<int> p;
+  BOOST_REQUIRE(queue.pop(&p));
+  BOOST_CHECK_EQUAL(*p, 42);
+  // the other one is freed by the dtor
+}
+
+BOOST_AUTO_TEST_CASE(testMpscQueueProducers)
+{
+  const int kProducers = 8;
+  const int kItems = 200000;
+  MpscQueue<int64_t> queue(256);
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducers; ++p)
+  {
+    producers.emplace_back([&queue, p] {
+      for (int i = 0; i < kItems; ++i)
+      {
+        queue.push(static_cast<int64_t>(p) << 32 | i);
+      }
+    });
+  }
+
+  std::vector<int64_t> next(kProducers, 0);
+  int64_t received = 0;
+  while (received < kProducers * kItems)
+  {
+    int64_t x = 0;
+    if (queue.pop(&x))
+    {
+      int p = static_cast<int>(x >> 32);
+      int64_t i = x & 0xffffffff;
+      BOOST_REQUIRE(p >= 0 && p < kProducers);
+      // in order for each producer
+      BOOST_REQUIRE_EQUAL(i, next[p]);
+      ++next[p];
+      ++received;
+    }
+  }
+  for (std::thread& t : producers)
+  {
+    t.join();
+  }
+  BOOST_CHECK_EQUAL(queue.size(), 0);
+  int64_t x = 0;
+  BOOST_CHECK(!queue.pop(&x));
+}
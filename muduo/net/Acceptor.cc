@@ -9,12 +9,17 @@
 #include "muduo/net/Acceptor.h"
 
 #include "muduo/base/Logging.h"
+#include "muduo/base/Mutex.h"
 #include "muduo/net/EventLoop.h"
 #include "muduo/net/InetAddress.h"
 #include "muduo/net/SocketsOps.h"
 
+#include <algorithm>
+#include <vector>
+
 #include <errno.h>
 #include <fcntl.h>
+#include <stdio.h>
 //#include <sys/types.h>
 //#include <sys/stat.h>
 #include <unistd.h>
@@ -22,28 +27,76 @@
 using namespace muduo;
 using namespace muduo::net;
 
+namespace
+{
+
+// acceptors are registered for the inspector only, never on the fast path.
+MutexLock& registryMutex()
+{
+  static MutexLock mutex;
+  return mutex;
+}
+
+std::vector<Acceptor*>& registry()
+{
+  static std::vector<Acceptor*> acceptors;
+  return acceptors;
+}
+
+}  // namespace
+
 Acceptor::Acceptor(EventLoop* loop, const InetAddress& listenAddr, bool reuseport)
   : loop_(loop),// 不是Accptor独有的，为什么持有指针？
     acceptSocket_(sockets::createNonblockingOrDie(listenAddr.family())), //独有的
     acceptChannel_(loop, acceptSocket_.fd()),  //独有的
     listening_(false),
-    idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC))
+    idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC)),
+    acceptBatch_(1),
+    numAccepted_(0),
+    numBatches_(0),
+    numEmfile_(0),
+    lastAccepted_(0),
+    lastStats_(Timestamp::now())
 {
   assert(idleFd_ >= 0);
   acceptSocket_.setReuseAddr(true);
   acceptSocket_.setReusePort(reuseport);
   acceptSocket_.bindAddress(listenAddr);
+  ipPort_ = localAddress().toIpPort();
   acceptChannel_.setReadCallback(
       std::bind(&Acceptor::handleRead, this));
+  MutexLockGuard lock(registryMutex());
+  registry().push_back(this);
 }
 
 Acceptor::~Acceptor()
 {
+  {
+    MutexLockGuard lock(registryMutex());
+    std::vector<Acceptor*>& acceptors = registry();
+    acceptors.erase(std::remove(acceptors.begin(), acceptors.end(), this), acceptors.end());
+  }
   acceptChannel_.disableAll();
   acceptChannel_.remove();
   ::close(idleFd_);
 }
 
+void Acceptor::setAcceptBatch(int n)
+{
+  assert(n > 0);
+  acceptBatch_ = n;
+}
+
+InetAddress Acceptor::localAddress() const
+{
+  return InetAddress(sockets::getLocalAddr(acceptSocket_.fd()));
+}
+
+bool Acceptor::steerByCpu(int numAcceptors)
+{
+  return acceptSocket_.attachReusePortCpuFilter(numAcceptors);
+}
+
 void Acceptor::listen()
 {
   loop_->assertInLoopThread();
@@ -55,11 +108,34 @@ void Acceptor::listen()
 void Acceptor::handleRead()
 {
   loop_->assertInLoopThread();
-  InetAddress peerAddr;
-  //FIXME loop until no more
-  int connfd = acceptSocket_.accept(&peerAddr);
-  if (connfd >= 0)
+  int accepted = 0;
+  while (accepted < acceptBatch_)
   {
+    InetAddress peerAddr;
+    int connfd = acceptSocket_.accept(&peerAddr);
+    if (connfd < 0)
+    {
+      int savedErrno = errno;
+      // EAGAIN, no more to accept
+      if (savedErrno != EAGAIN)
+      {
+        LOG_SYSERR << "in Acceptor::handleRead";
+      }
+      // Read the section named "The special problem of
+      // accept()ing when you can't" in libev's doc.
+      // By Marc Lehmann, author of libev.
+      if (savedErrno == EMFILE)
+      {
+        numEmfile_.fetch_add(1, std::memory_order_relaxed);
+        ::close(idleFd_);
+        idleFd_ = ::accept(acceptSocket_.fd(), NULL, NULL);
+        ::close(idleFd_);
+        idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+      }
+      break;
+    }
+
+    ++accepted;
     // string hostport = peerAddr.toIpPort();
     // LOG_TRACE << "Accepts of " << hostport;
     if (newConnectionCallback_)
@@ -71,19 +147,40 @@ void Acceptor::handleRead()
       sockets::close(connfd);
     }
   }
-  else
+
+  if (accepted > 0)
   {
-    LOG_SYSERR << "in Acceptor::handleRead";
-    // Read the section named "The special problem of
-    // accept()ing when you can't" in libev's doc.
-    // By Marc Lehmann, author of libev.
-    if (errno == EMFILE)
+    numAccepted_.fetch_add(accepted, std::memory_order_relaxed);
+    numBatches_.fetch_add(1, std::memory_order_relaxed);
+    if (batchCallback_)
     {
-      ::close(idleFd_);
-      idleFd_ = ::accept(acceptSocket_.fd(), NULL, NULL);
-      ::close(idleFd_);
-      idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+      batchCallback_();
     }
   }
 }
 
+string Acceptor::allStatsString()
+{
+  string result;
+  char buf[256];
+  Timestamp now(Timestamp::now());
+  MutexLockGuard lock(registryMutex());
+  for (Acceptor* acceptor : registry())
+  {
+    const int64_t accepted = acceptor->numAccepted();
+    const int64_t batches = acceptor->numBatches();
+    const double seconds = timeDifference(now, acceptor->lastStats_);
+    snprintf(buf, sizeof buf,
+             "%s accepted %lld (%.1f/s) batches %lld (%.1f per batch) emfile %lld\n",
+             acceptor->ipPort_.c_str(),
+             static_cast<long long>(accepted),
+             seconds > 0 ? static_cast<double>(accepted - acceptor->lastAccepted_) / seconds : 0.0,
+             static_cast<long long>(batches),
+             batches > 0 ? static_cast<double>(accepted) / static_cast<double>(batches) : 0.0,
+             static_cast<long long>(acceptor->numEmfile()));
+    result += buf;
+    acceptor->lastAccepted_ = accepted;
+    acceptor->lastStats_ = now;
+  }
+  return result;
+}
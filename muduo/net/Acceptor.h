@@ -11,6 +11,7 @@
 #ifndef MUDUO_NET_ACCEPTOR_H
 #define MUDUO_NET_ACCEPTOR_H
 
+#include <atomic>
 #include <functional>
 
 #include "muduo/net/Channel.h"
@@ -27,10 +28,14 @@ class InetAddress;
 ///
 /// Acceptor of incoming TCP connections.
 ///
+/// Accepts up to a batch of connections each time the listening socket
+/// is readable, and counts them for the inspector.
+///
 class Acceptor : noncopyable
 {
  public:
   typedef std::function<void (int sockfd, const InetAddress&)> NewConnectionCallback;
+  typedef std::function<void ()> BatchCallback;
 
   Acceptor(EventLoop* loop, const InetAddress& listenAddr, bool reuseport);
   ~Acceptor();
@@ -38,23 +43,57 @@ class Acceptor : noncopyable
   void setNewConnectionCallback(const NewConnectionCallback& cb)
   { newConnectionCallback_ = cb; }
 
+  /// Called after each batch of new connections,
+  /// eg. to hand them off to other loops together.
+  void setBatchCallback(const BatchCallback& cb)
+  { batchCallback_ = cb; }
+
+  /// Accepts at most 'n' connections each time the socket is readable,
+  /// fewer if there is no more.  1 by default.
+  void setAcceptBatch(int n);
+
   void listen();
 
+  EventLoop* getLoop() const { return loop_; }
   bool listening() const { return listening_; }
 
+  /// The address bound, with the port chosen if it asked for port 0.
+  InetAddress localAddress() const;
+
+  /// With SO_REUSEPORT, connections go to the (cpu % numAcceptors)-th
+  /// acceptor listening on the port, by the CPU that received them.
+  /// @return false if not supported
+  bool steerByCpu(int numAcceptors);
+
   // Deprecated, use the correct spelling one above.
   // Leave the wrong spelling here in case one needs to grep it for error messages.
   // bool listenning() const { return listening(); }
 
+  int64_t numAccepted() const { return numAccepted_.load(std::memory_order_relaxed); }
+  int64_t numBatches() const { return numBatches_.load(std::memory_order_relaxed); }
+  int64_t numEmfile() const { return numEmfile_.load(std::memory_order_relaxed); }
+
+  /// Counters of all acceptors, and their accept rates since the last call.
+  static string allStatsString();
+
  private:
   void handleRead();
 
   EventLoop* loop_;
+  string ipPort_;
   Socket acceptSocket_;
   Channel acceptChannel_;
   NewConnectionCallback newConnectionCallback_;
+  BatchCallback batchCallback_;
   bool listening_;
   int idleFd_;
+  int acceptBatch_;
+  std::atomic<int64_t> numAccepted_;
+  std::atomic<int64_t> numBatches_;
+  std::atomic<int64_t> numEmfile_;
+  // for allStatsString(), guarded by its registry
+  int64_t lastAccepted_;
+  Timestamp lastStats_;
 };
 
 }  // namespace net
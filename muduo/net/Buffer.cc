@@ -9,6 +9,7 @@
 
 #include "muduo/net/Buffer.h"
 
+#include "muduo/net/BufferPool.h"
 #include "muduo/net/SocketsOps.h"
 
 #include <errno.h>
@@ -17,24 +18,145 @@
 using namespace muduo;
 using namespace muduo::net;
 
-const char Buffer::kCRLF[] = "\r\n";
-
 const size_t Buffer::kCheapPrepend;
 const size_t Buffer::kInitialSize;
+char Buffer::emptyStorage_[Buffer::kCheapPrepend];
+
+Buffer::Buffer(const Buffer& rhs)
+  : buffer_(NULL),
+    capacity_(0),
+    size_(rhs.size_),
+    readerIndex_(rhs.readerIndex_),
+    writerIndex_(rhs.writerIndex_),
+    lazy_(rhs.lazy_)
+{
+  if (rhs.buffer_)
+  {
+    allocate(size_);
+    ::memcpy(begin() + readerIndex_, rhs.peek(), rhs.readableBytes());
+  }
+}
+
+Buffer::Buffer(Buffer&& rhs) noexcept
+  : buffer_(rhs.buffer_),
+    capacity_(rhs.capacity_),
+    size_(rhs.size_),
+    readerIndex_(rhs.readerIndex_),
+    writerIndex_(rhs.writerIndex_),
+    lazy_(rhs.lazy_)
+{
+  rhs.buffer_ = NULL;
+  rhs.capacity_ = 0;
+  rhs.size_ = kCheapPrepend;
+  rhs.readerIndex_ = kCheapPrepend;
+  rhs.writerIndex_ = kCheapPrepend;
+}
+
+Buffer::~Buffer()
+{
+  if (buffer_)
+  {
+    BufferPool::deallocate(buffer_, capacity_);
+  }
+}
+
+void Buffer::allocate(size_t size)
+{
+  assert(buffer_ == NULL);
+  buffer_ = BufferPool::allocate(size, &capacity_);
+  size_ = size;
+}
+
+void Buffer::resize(size_t size)
+{
+  if (size <= capacity_)
+  {
+    size_ = size;
+    return;
+  }
+  char* old = buffer_;
+  size_t oldCapacity = capacity_;
+  buffer_ = NULL;
+  allocate(size);
+  if (old)
+  {
+    // only readable bytes are meaningful, keep them at the same offset
+    ::memcpy(begin() + readerIndex_, old + readerIndex_, readableBytes());
+    BufferPool::deallocate(old, oldCapacity);
+  }
+}
+
+void Buffer::release()
+{
+  assert(readableBytes() == 0);
+  BufferPool::deallocate(buffer_, capacity_);
+  buffer_ = NULL;
+  capacity_ = 0;
+  size_ = kCheapPrepend;
+  readerIndex_ = kCheapPrepend;
+  writerIndex_ = kCheapPrepend;
+}
 
-ssize_t Buffer::readFd(int fd, int* savedErrno)
+ssize_t Buffer::readFd(int fd, int* savedErrno, size_t sizeHint)
+{
+  BufferPool* pool = BufferPool::current();
+  if (pool == NULL)
+  {
+    // saved an ioctl()/FIONREAD call to tell how much to read
+    char extrabuf[65536];
+    return readv(fd, savedErrno, extrabuf, sizeof extrabuf);
+  }
+
+  size_t scratchCapacity = 0;
+  char* scratch = pool->scratch(&scratchCapacity);
+  if (sizeHint > writableBytes())
+  {
+    if (readableBytes() > 0)
+    {
+      ensureWritableBytes(sizeHint);
+    }
+    else
+    {
+      const ssize_t n = sockets::read(fd, scratch + kCheapPrepend, scratchCapacity - kCheapPrepend);
+      if (n < 0)
+      {
+        *savedErrno = errno;
+      }
+      else if (implicit_cast<size_t>(n) <= std::max(writableBytes(), kInitialSize))
+      {
+        // not worth a large block
+        append(scratch + kCheapPrepend, n);
+      }
+      else
+      {
+        pool->takeScratch();
+        if (buffer_)
+        {
+          BufferPool::deallocate(buffer_, capacity_);
+        }
+        buffer_ = scratch;
+        capacity_ = scratchCapacity;
+        size_ = scratchCapacity;
+        readerIndex_ = kCheapPrepend;
+        writerIndex_ = kCheapPrepend + n;
+      }
+      return n;
+    }
+  }
+  return readv(fd, savedErrno, scratch + kCheapPrepend, scratchCapacity - kCheapPrepend);
+}
+
+ssize_t Buffer::readv(int fd, int* savedErrno, char* extrabuf, size_t extraLen)
 {
-  // saved an ioctl()/FIONREAD call to tell how much to read
-  char extrabuf[65536];
   struct iovec vec[2];
   const size_t writable = writableBytes();
   vec[0].iov_base = begin()+writerIndex_;
   vec[0].iov_len = writable;
   vec[1].iov_base = extrabuf;
-  vec[1].iov_len = sizeof extrabuf;
+  vec[1].iov_len = extraLen;
   // when there is enough space in this buffer, don't read into extrabuf.
   // when extrabuf is used, we read 128k-1 bytes at most.
-  const int iovcnt = (writable < sizeof extrabuf) ? 2 : 1;
+  const int iovcnt = (writable < extraLen) ? 2 : 1;
   const ssize_t n = sockets::readv(fd, vec, iovcnt);
   if (n < 0)
   {
@@ -46,7 +168,7 @@ ssize_t Buffer::readFd(int fd, int* savedErrno)
   }
   else
   {
-    writerIndex_ = buffer_.size();
+    writerIndex_ = size_;
     append(extrabuf, n - writable);
   }
   // if (n == writable + sizeof extrabuf)
@@ -55,4 +177,3 @@ ssize_t Buffer::readFd(int fd, int* savedErrno)
   // }
   return n;
 }
-
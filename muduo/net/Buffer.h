@@ -15,10 +15,10 @@
 #include "muduo/base/StringPiece.h"
 #include "muduo/base/Types.h"
 
+#include "muduo/net/ByteScan.h"
 #include "muduo/net/Endian.h"
 
 #include <algorithm>
-#include <vector>
 
 #include <assert.h>
 #include <string.h>
@@ -45,31 +45,63 @@ class Buffer : public muduo::copyable
   static const size_t kCheapPrepend = 8;
   static const size_t kInitialSize = 1024;
 
-  explicit Buffer(size_t initialSize = kInitialSize)
-    : buffer_(kCheapPrepend + initialSize),
+  /// A lazy buffer holds no storage until something is written to it,
+  /// and gives its storage back as soon as it becomes empty,
+  /// @c initialSize is ignored then.  Meant for many mostly idle
+  /// connections, at the cost of one pool round trip per message.
+  explicit Buffer(size_t initialSize = kInitialSize, bool lazy = false)
+    : buffer_(NULL),
+      capacity_(0),
+      size_(lazy ? kCheapPrepend : kCheapPrepend + initialSize),
       readerIndex_(kCheapPrepend),
-      writerIndex_(kCheapPrepend)
+      writerIndex_(kCheapPrepend),
+      lazy_(lazy)
   {
+    if (!lazy_)
+    {
+      allocate(size_);
+    }
     assert(readableBytes() == 0);
-    assert(writableBytes() == initialSize);
+    assert(writableBytes() == (lazy_ ? 0 : initialSize));
     assert(prependableBytes() == kCheapPrepend);
   }
 
-  // implicit copy-ctor, move-ctor, dtor and assignment are fine
-  // NOTE: implicit move-ctor is added in g++ 4.6
+  // Storage comes from the BufferPool of current thread, if any.
+  Buffer(const Buffer& rhs);
+  Buffer(Buffer&& rhs) noexcept;
+  ~Buffer();
+
+  Buffer& operator=(const Buffer& rhs)
+  {
+    Buffer copy(rhs);
+    swap(copy);
+    return *this;
+  }
+
+  Buffer& operator=(Buffer&& rhs) noexcept
+  {
+    swap(rhs);
+    return *this;
+  }
 
   void swap(Buffer& rhs)
   {
-    buffer_.swap(rhs.buffer_);
+    std::swap(buffer_, rhs.buffer_);
+    std::swap(capacity_, rhs.capacity_);
+    std::swap(size_, rhs.size_);
     std::swap(readerIndex_, rhs.readerIndex_);
     std::swap(writerIndex_, rhs.writerIndex_);
+    std::swap(lazy_, rhs.lazy_);
   }
 
+  bool lazy() const
+  { return lazy_; }
+
   size_t readableBytes() const
   { return writerIndex_ - readerIndex_; }
 
   size_t writableBytes() const
-  { return buffer_.size() - writerIndex_; }
+  { return size_ - writerIndex_; }
 
   size_t prependableBytes() const
   { return readerIndex_; }
@@ -79,18 +111,40 @@ class Buffer : public muduo::copyable
 
   const char* findCRLF() const
   {
-    // FIXME: replace with memmem()?
-    const char* crlf = std::search(peek(), beginWrite(), kCRLF, kCRLF+2);
-    return crlf == beginWrite() ? NULL : crlf;
+    return scan::findCRLF(peek(), beginWrite());
   }
 
   const char* findCRLF(const char* start) const
   {
     assert(peek() <= start);
     assert(start <= beginWrite());
-    // FIXME: replace with memmem()?
-    const char* crlf = std::search(start, beginWrite(), kCRLF, kCRLF+2);
-    return crlf == beginWrite() ? NULL : crlf;
+    return scan::findCRLF(start, beginWrite());
+  }
+
+  /// End of a header block, as in HTTP.
+  const char* findCRLFCRLF() const
+  {
+    return scan::findCRLFCRLF(peek(), beginWrite());
+  }
+
+  const char* findCRLFCRLF(const char* start) const
+  {
+    assert(peek() <= start);
+    assert(start <= beginWrite());
+    return scan::findCRLFCRLF(start, beginWrite());
+  }
+
+  /// The first readable byte which is one of @c set.
+  const char* findAnyOf(const StringPiece& set) const
+  {
+    return scan::findAnyOf(peek(), beginWrite(), set.data(), set.size());
+  }
+
+  const char* findAnyOf(const char* start, const StringPiece& set) const
+  {
+    assert(peek() <= start);
+    assert(start <= beginWrite());
+    return scan::findAnyOf(start, beginWrite(), set.data(), set.size());
   }
 
   const char* findEOL() const
@@ -154,6 +208,10 @@ class Buffer : public muduo::copyable
   {
     readerIndex_ = kCheapPrepend;
     writerIndex_ = kCheapPrepend;
+    if (lazy_ && buffer_)
+    {
+      release();
+    }
   }
 
   string retrieveAllAsString()
@@ -354,6 +412,10 @@ class Buffer : public muduo::copyable
   void prepend(const void* /*restrict*/ data, size_t len)
   {
     assert(len <= prependableBytes());
+    if (buffer_ == NULL)
+    {
+      resize(size_);
+    }
     readerIndex_ -= len;
     const char* d = static_cast<const char*>(data);
     std::copy(d, d+len, begin()+readerIndex_);
@@ -362,7 +424,7 @@ class Buffer : public muduo::copyable
   void shrink(size_t reserve)
   {
     // FIXME: use vector::shrink_to_fit() in C++ 11 if possible.
-    Buffer other;
+    Buffer other(kInitialSize, lazy_);
     other.ensureWritableBytes(readableBytes()+reserve);
     other.append(toStringPiece());
     swap(other);
@@ -370,29 +432,43 @@ class Buffer : public muduo::copyable
 
   size_t internalCapacity() const
   {
-    return buffer_.capacity();
+    return capacity_;
   }
 
   /// Read data directly into buffer.
   ///
   /// It may implement with readv(2)
+  /// @c sizeHint is how many bytes the caller expects, if that doesn't
+  /// fit, an empty buffer reads into the scratch block of current
+  /// thread's BufferPool and takes the block over instead of copying,
+  /// a non-empty one grows beforehand.
   /// @return result of read(2), @c errno is saved
-  ssize_t readFd(int fd, int* savedErrno);
+  ssize_t readFd(int fd, int* savedErrno, size_t sizeHint = 0);
 
  private:
 
+  // without storage, lazy or moved-from, the indices are all kCheapPrepend,
+  // so peek() and beginWrite() still point to an object, with 0 bytes to use.
   char* begin()
-  { return &*buffer_.begin(); }
+  { return buffer_ ? buffer_ : emptyStorage_; }
 
   const char* begin() const
-  { return &*buffer_.begin(); }
+  { return buffer_ ? buffer_ : emptyStorage_; }
+
+  void allocate(size_t size);
+  // like vector::resize(), keeps readable data
+  void resize(size_t size);
+  // gives storage back, for an empty lazy buffer
+  void release();
+  // reads into writable bytes, then into extrabuf
+  ssize_t readv(int fd, int* savedErrno, char* extrabuf, size_t extraLen);
 
   void makeSpace(size_t len)
   {
-    if (writableBytes() + prependableBytes() < len + kCheapPrepend)
+    if (buffer_ == NULL || writableBytes() + prependableBytes() < len + kCheapPrepend)
     {
       // FIXME: move readable data
-      buffer_.resize(writerIndex_+len);
+      resize(writerIndex_+len);
     }
     else
     {
@@ -409,11 +485,14 @@ class Buffer : public muduo::copyable
   }
 
  private:
-  std::vector<char> buffer_;
+  char* buffer_;
+  size_t capacity_;
+  size_t size_;
   size_t readerIndex_;
   size_t writerIndex_;
+  bool lazy_;
 
-  static const char kCRLF[];
+  static char emptyStorage_[kCheapPrepend];
 };
 
 }  // namespace net
@@ -0,0 +1,229 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include "muduo/net/BufferPool.h"
+
+#include "muduo/base/CurrentThread.h"
+#include "muduo/base/Logging.h"
+#include "muduo/base/Mutex.h"
+#include "muduo/net/Buffer.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+__thread BufferPool* t_bufferPool = 0;
+
+const size_t kPrepend = Buffer::kCheapPrepend;
+const size_t kMinClassSize = kPrepend + 1024;
+const size_t kMaxClassSize = kPrepend + (1024 << (BufferPool::kNumClasses - 1));
+
+// pools are registered for the inspector only, never on the fast path.
+MutexLock& registryMutex()
+{
+  static MutexLock mutex;
+  return mutex;
+}
+
+std::vector<BufferPool*>& registry()
+{
+  static std::vector<BufferPool*> pools;
+  return pools;
+}
+
+}  // namespace
+
+const int BufferPool::kNumClasses;
+const size_t BufferPool::kDefaultMaxHeldBytes;
+
+BufferPool::BufferPool()
+  : threadId_(CurrentThread::tid()),
+    maxHeldBytes_(kDefaultMaxHeldBytes),
+    scratch_(NULL),
+    scratchCapacity_(0),
+    gets_(0),
+    hits_(0),
+    puts_(0),
+    heldBytes_(0)
+{
+  std::fill(freeLists_, freeLists_ + kNumClasses, static_cast<FreeBlock*>(NULL));
+  // a second EventLoop in this thread dies right after, keep the first pool.
+  if (t_bufferPool == NULL)
+  {
+    t_bufferPool = this;
+  }
+  MutexLockGuard lock(registryMutex());
+  registry().push_back(this);
+}
+
+BufferPool::~BufferPool()
+{
+  {
+    MutexLockGuard lock(registryMutex());
+    std::vector<BufferPool*>& pools = registry();
+    pools.erase(std::remove(pools.begin(), pools.end(), this), pools.end());
+  }
+  if (t_bufferPool == this)
+  {
+    t_bufferPool = NULL;
+  }
+  ::free(scratch_);
+  for (int i = 0; i < kNumClasses; ++i)
+  {
+    while (freeLists_[i])
+    {
+      FreeBlock* next = freeLists_[i]->next;
+      ::free(freeLists_[i]);
+      freeLists_[i] = next;
+    }
+  }
+}
+
+size_t BufferPool::roundUp(size_t size)
+{
+  if (size > kMaxClassSize)
+  {
+    return size;
+  }
+  size_t capacity = kMinClassSize;
+  while (capacity < size)
+  {
+    capacity = (capacity - kPrepend) * 2 + kPrepend;
+  }
+  return capacity;
+}
+
+int BufferPool::sizeClass(size_t capacity)
+{
+  int index = 0;
+  for (size_t c = kMinClassSize; c <= kMaxClassSize; c = (c - kPrepend) * 2 + kPrepend)
+  {
+    if (c == capacity)
+    {
+      return index;
+    }
+    ++index;
+  }
+  return -1;
+}
+
+char* BufferPool::get(size_t size, size_t* capacity)
+{
+  assert(CurrentThread::tid() == threadId_);
+  increment(gets_);
+  *capacity = roundUp(size);
+  int index = sizeClass(*capacity);
+  if (index >= 0 && freeLists_[index] != NULL)
+  {
+    FreeBlock* block = freeLists_[index];
+    freeLists_[index] = block->next;
+    increment(hits_);
+    increment(heldBytes_, -static_cast<int64_t>(*capacity));
+    return reinterpret_cast<char*>(block);
+  }
+  char* block = static_cast<char*>(::malloc(*capacity));
+  if (block == NULL)
+  {
+    LOG_SYSFATAL << "BufferPool::get " << *capacity;
+  }
+  return block;
+}
+
+void BufferPool::put(char* block, size_t capacity)
+{
+  assert(CurrentThread::tid() == threadId_);
+  increment(puts_);
+  int index = sizeClass(capacity);
+  if (index >= 0 && heldBytes() + capacity <= maxHeldBytes_)
+  {
+    FreeBlock* node = reinterpret_cast<FreeBlock*>(block);
+    node->next = freeLists_[index];
+    freeLists_[index] = node;
+    increment(heldBytes_, static_cast<int64_t>(capacity));
+  }
+  else
+  {
+    ::free(block);
+  }
+}
+
+char* BufferPool::scratch(size_t* capacity)
+{
+  if (scratch_ == NULL)
+  {
+    scratch_ = get(kMaxClassSize, &scratchCapacity_);
+  }
+  *capacity = scratchCapacity_;
+  return scratch_;
+}
+
+BufferPool* BufferPool::current()
+{
+  return t_bufferPool;
+}
+
+char* BufferPool::allocate(size_t size, size_t* capacity)
+{
+  if (t_bufferPool)
+  {
+    return t_bufferPool->get(size, capacity);
+  }
+  *capacity = roundUp(size);
+  char* block = static_cast<char*>(::malloc(*capacity));
+  if (block == NULL)
+  {
+    LOG_SYSFATAL << "BufferPool::allocate " << *capacity;
+  }
+  return block;
+}
+
+void BufferPool::deallocate(char* block, size_t capacity)
+{
+  if (t_bufferPool)
+  {
+    t_bufferPool->put(block, capacity);
+  }
+  else
+  {
+    ::free(block);
+  }
+}
+
+string BufferPool::statsString() const
+{
+  int64_t gets = numGets();
+  int64_t hits = numHits();
+  char buf[256];
+  snprintf(buf, sizeof buf,
+           "tid %d gets %lld hits %lld (%.1f%%) puts %lld held %lld bytes\n",
+           threadId_,
+           static_cast<long long>(gets),
+           static_cast<long long>(hits),
+           gets > 0 ? 100.0 * static_cast<double>(hits) / static_cast<double>(gets) : 0.0,
+           static_cast<long long>(numPuts()),
+           static_cast<long long>(heldBytes()));
+  return buf;
+}
+
+string BufferPool::allStatsString()
+{
+  string result;
+  MutexLockGuard lock(registryMutex());
+  for (const BufferPool* pool : registry())
+  {
+    result += pool->statsString();
+  }
+  return result;
+}
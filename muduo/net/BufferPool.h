@@ -0,0 +1,114 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_BUFFERPOOL_H
+#define MUDUO_NET_BUFFERPOOL_H
+
+#include "muduo/base/noncopyable.h"
+#include "muduo/base/Types.h"
+
+#include <atomic>
+
+#include <sys/types.h>
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// Storage blocks for Buffer, recycled in size classes.
+///
+/// Owned by EventLoop, one per loop thread, and only used in that thread,
+/// so it never locks.  Buffer allocates through allocate()/deallocate(),
+/// which go to the pool of the calling thread if it has an EventLoop,
+/// or to malloc(3) otherwise.  A block freed in another thread simply
+/// migrates to that thread's pool, all blocks of a class are alike.
+///
+class BufferPool : noncopyable
+{
+ public:
+  /// Size classes are 8 + 1KiB, 8 + 2KiB, ..., 8 + 64KiB,
+  /// the first one fits a default Buffer exactly.
+  static const int kNumClasses = 7;
+  static const size_t kDefaultMaxHeldBytes = 8 * 1024 * 1024;
+
+  BufferPool();
+  ~BufferPool();
+
+  /// Returns a block of at least @c size bytes,
+  /// its actual size is stored in @c *capacity.
+  char* get(size_t size, size_t* capacity);
+  /// Takes back a block got from any pool, or from allocate().
+  void put(char* block, size_t capacity);
+
+  /// A block of the largest class for reading into, see Buffer::readFd().
+  /// It stays with the pool until taken by takeScratch().
+  char* scratch(size_t* capacity);
+  /// The caller owns the scratch block from now on,
+  /// next scratch() gets another one.
+  void takeScratch()
+  { scratch_ = NULL; }
+
+  /// Blocks beyond this are freed instead of being kept.
+  void setMaxHeldBytes(size_t maxHeldBytes)
+  { maxHeldBytes_ = maxHeldBytes; }
+
+  /// Counters are written by the owner thread only,
+  /// they can be read from any thread.
+  int64_t numGets() const { return gets_.load(std::memory_order_relaxed); }
+  int64_t numHits() const { return hits_.load(std::memory_order_relaxed); }
+  int64_t numPuts() const { return puts_.load(std::memory_order_relaxed); }
+  int64_t heldBytes() const { return heldBytes_.load(std::memory_order_relaxed); }
+
+  string statsString() const;
+
+  /// The pool of current thread, NULL if none.
+  static BufferPool* current();
+
+  /// Allocates from the pool of current thread, if any.
+  static char* allocate(size_t size, size_t* capacity);
+  static void deallocate(char* block, size_t capacity);
+
+  /// Block size for a request of @c size bytes.
+  static size_t roundUp(size_t size);
+
+  /// Stats of all pools in this process, for the inspector.
+  static string allStatsString();
+
+ private:
+  static int sizeClass(size_t capacity);
+
+  struct FreeBlock
+  {
+    FreeBlock* next;
+  };
+
+  static void increment(std::atomic<int64_t>& counter, int64_t n = 1)
+  {
+    counter.store(counter.load(std::memory_order_relaxed) + n,
+                  std::memory_order_relaxed);
+  }
+
+  const pid_t threadId_;
+  size_t maxHeldBytes_;
+  FreeBlock* freeLists_[kNumClasses];
+  char* scratch_;
+  size_t scratchCapacity_;
+  std::atomic<int64_t> gets_;
+  std::atomic<int64_t> hits_;
+  std::atomic<int64_t> puts_;
+  std::atomic<int64_t> heldBytes_;
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_BUFFERPOOL_H
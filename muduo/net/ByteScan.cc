@@ -0,0 +1,393 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+
+#include "muduo/net/ByteScan.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define MUDUO_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+typedef const char* (*FindFunc)(const char* begin, const char* end);
+typedef const char* (*FindAnyOfFunc)(const char* begin, const char* end,
+                                     const char* set, size_t setLen);
+
+struct Kernels
+{
+  const char* name;
+  FindFunc findCRLF;
+  FindFunc findCRLFCRLF;
+  FindAnyOfFunc findAnyOf;
+};
+
+const size_t kMaxSimdSet = 16;
+
+const char* findCRLFScalar(const char* begin, const char* end)
+{
+  const char* p = begin;
+  while (end - p >= 2)
+  {
+    p = static_cast<const char*>(memchr(p, '\r', end - p - 1));
+    if (p == NULL)
+    {
+      return NULL;
+    }
+    if (p[1] == '\n')
+    {
+      return p;
+    }
+    ++p;
+  }
+  return NULL;
+}
+
+const char* findCRLFCRLFScalar(const char* begin, const char* end)
+{
+  const char* p = begin;
+  while (end - p >= 4)
+  {
+    p = static_cast<const char*>(memchr(p, '\r', end - p - 3));
+    if (p == NULL)
+    {
+      return NULL;
+    }
+    if (p[1] == '\n' && p[2] == '\r' && p[3] == '\n')
+    {
+      return p;
+    }
+    ++p;
+  }
+  return NULL;
+}
+
+const char* findAnyOfScalar(const char* begin, const char* end,
+                            const char* set, size_t setLen)
+{
+  if (setLen == 1)
+  {
+    return static_cast<const char*>(memchr(begin, set[0], end - begin));
+  }
+  bool table[256] = { false };
+  for (size_t i = 0; i < setLen; ++i)
+  {
+    table[static_cast<unsigned char>(set[i])] = true;
+  }
+  for (const char* p = begin; p < end; ++p)
+  {
+    if (table[static_cast<unsigned char>(*p)])
+    {
+      return p;
+    }
+  }
+  return NULL;
+}
+
+#ifdef MUDUO_SCAN_X86
+
+// The vector kernels look for the first byte of the pattern 64 bytes
+// at a time, and only load the following bytes to verify a candidate,
+// so the common no-match path costs about one compare per vector.
+// Runs longer than kVectorScan without a CR are left to memchr(3),
+// which libc tunes for the CPU, and which beats us there.
+const ptrdiff_t kVectorScan = 512;
+
+inline const char* firstOf(const char* p, uint64_t mask)
+{
+  return p + __builtin_ctzll(mask);
+}
+
+inline uint64_t movemask64(__m128i m0, __m128i m1, __m128i m2, __m128i m3)
+{
+  return static_cast<uint64_t>(static_cast<unsigned>(_mm_movemask_epi8(m0)))
+      | static_cast<uint64_t>(static_cast<unsigned>(_mm_movemask_epi8(m1))) << 16
+      | static_cast<uint64_t>(static_cast<unsigned>(_mm_movemask_epi8(m2))) << 32
+      | static_cast<uint64_t>(static_cast<unsigned>(_mm_movemask_epi8(m3))) << 48;
+}
+
+inline __m128i load128(const char* p)
+{
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+// bytes [p, p+64) equal to c, as a bit mask
+inline uint64_t matchSse2(const char* p, __m128i c)
+{
+  return movemask64(_mm_cmpeq_epi8(load128(p), c),
+                    _mm_cmpeq_epi8(load128(p + 16), c),
+                    _mm_cmpeq_epi8(load128(p + 32), c),
+                    _mm_cmpeq_epi8(load128(p + 48), c));
+}
+
+inline bool anySse2(const char* p, __m128i c)
+{
+  __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(load128(p), c),
+                                        _mm_cmpeq_epi8(load128(p + 16), c)),
+                           _mm_or_si128(_mm_cmpeq_epi8(load128(p + 32), c),
+                                        _mm_cmpeq_epi8(load128(p + 48), c)));
+  return _mm_movemask_epi8(m) != 0;
+}
+
+const char* findCRLFSse2(const char* begin, const char* end)
+{
+  const __m128i cr = _mm_set1_epi8('\r');
+  const __m128i lf = _mm_set1_epi8('\n');
+  const char* p = begin;
+  // a match starting in the last byte of a block is found with the next one
+  for (; end - p >= 65 && p - begin < kVectorScan; p += 64)
+  {
+    if (anySse2(p, cr))
+    {
+      uint64_t mask = matchSse2(p, cr) & matchSse2(p + 1, lf);
+      if (mask)
+      {
+        return firstOf(p, mask);
+      }
+    }
+  }
+  return findCRLFScalar(p, end);
+}
+
+const char* findCRLFCRLFSse2(const char* begin, const char* end)
+{
+  const __m128i cr = _mm_set1_epi8('\r');
+  const __m128i lf = _mm_set1_epi8('\n');
+  const char* p = begin;
+  for (; end - p >= 67 && p - begin < kVectorScan; p += 64)
+  {
+    if (anySse2(p, cr))
+    {
+      uint64_t mask = matchSse2(p, cr) & matchSse2(p + 1, lf)
+                      & matchSse2(p + 2, cr) & matchSse2(p + 3, lf);
+      if (mask)
+      {
+        return firstOf(p, mask);
+      }
+    }
+  }
+  return findCRLFCRLFScalar(p, end);
+}
+
+const char* findAnyOfSse2(const char* begin, const char* end,
+                          const char* set, size_t setLen)
+{
+  if (setLen <= 1 || setLen > kMaxSimdSet)
+  {
+    return findAnyOfScalar(begin, end, set, setLen);
+  }
+  __m128i needles[kMaxSimdSet];
+  for (size_t i = 0; i < setLen; ++i)
+  {
+    needles[i] = _mm_set1_epi8(set[i]);
+  }
+  const char* p = begin;
+  for (; end - p >= 32; p += 32)
+  {
+    __m128i a = load128(p);
+    __m128i b = load128(p + 16);
+    __m128i ea = _mm_cmpeq_epi8(a, needles[0]);
+    __m128i eb = _mm_cmpeq_epi8(b, needles[0]);
+    for (size_t i = 1; i < setLen; ++i)
+    {
+      ea = _mm_or_si128(ea, _mm_cmpeq_epi8(a, needles[i]));
+      eb = _mm_or_si128(eb, _mm_cmpeq_epi8(b, needles[i]));
+    }
+    uint64_t mask = static_cast<unsigned>(_mm_movemask_epi8(ea))
+                    | static_cast<unsigned>(_mm_movemask_epi8(eb)) << 16;
+    if (mask)
+    {
+      return firstOf(p, mask);
+    }
+  }
+  return findAnyOfScalar(p, end, set, setLen);
+}
+
+__attribute__((target("avx2")))
+inline __m256i load256(const char* p)
+{
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+__attribute__((target("avx2")))
+inline uint64_t matchAvx2(const char* p, __m256i c)
+{
+  return static_cast<uint64_t>(static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(load256(p), c))))
+      | static_cast<uint64_t>(static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(load256(p + 32), c)))) << 32;
+}
+
+__attribute__((target("avx2")))
+inline bool anyAvx2(const char* p, __m256i c)
+{
+  __m256i m = _mm256_or_si256(_mm256_cmpeq_epi8(load256(p), c),
+                              _mm256_cmpeq_epi8(load256(p + 32), c));
+  return !_mm256_testz_si256(m, m);
+}
+
+__attribute__((target("avx2")))
+const char* findCRLFAvx2(const char* begin, const char* end)
+{
+  const __m256i cr = _mm256_set1_epi8('\r');
+  const __m256i lf = _mm256_set1_epi8('\n');
+  const char* p = begin;
+  for (; end - p >= 65 && p - begin < kVectorScan; p += 64)
+  {
+    if (anyAvx2(p, cr))
+    {
+      uint64_t mask = matchAvx2(p, cr) & matchAvx2(p + 1, lf);
+      if (mask)
+      {
+        return firstOf(p, mask);
+      }
+    }
+  }
+  return findCRLFScalar(p, end);
+}
+
+__attribute__((target("avx2")))
+const char* findCRLFCRLFAvx2(const char* begin, const char* end)
+{
+  const __m256i cr = _mm256_set1_epi8('\r');
+  const __m256i lf = _mm256_set1_epi8('\n');
+  const char* p = begin;
+  for (; end - p >= 67 && p - begin < kVectorScan; p += 64)
+  {
+    if (anyAvx2(p, cr))
+    {
+      uint64_t mask = matchAvx2(p, cr) & matchAvx2(p + 1, lf)
+                      & matchAvx2(p + 2, cr) & matchAvx2(p + 3, lf);
+      if (mask)
+      {
+        return firstOf(p, mask);
+      }
+    }
+  }
+  return findCRLFCRLFScalar(p, end);
+}
+
+__attribute__((target("avx2")))
+const char* findAnyOfAvx2(const char* begin, const char* end,
+                          const char* set, size_t setLen)
+{
+  if (setLen <= 1 || setLen > kMaxSimdSet)
+  {
+    return findAnyOfScalar(begin, end, set, setLen);
+  }
+  __m256i needles[kMaxSimdSet];
+  for (size_t i = 0; i < setLen; ++i)
+  {
+    needles[i] = _mm256_set1_epi8(set[i]);
+  }
+  const char* p = begin;
+  for (; end - p >= 64; p += 64)
+  {
+    __m256i a = load256(p);
+    __m256i b = load256(p + 32);
+    __m256i ea = _mm256_cmpeq_epi8(a, needles[0]);
+    __m256i eb = _mm256_cmpeq_epi8(b, needles[0]);
+    for (size_t i = 1; i < setLen; ++i)
+    {
+      ea = _mm256_or_si256(ea, _mm256_cmpeq_epi8(a, needles[i]));
+      eb = _mm256_or_si256(eb, _mm256_cmpeq_epi8(b, needles[i]));
+    }
+    uint64_t mask = static_cast<uint64_t>(static_cast<unsigned>(_mm256_movemask_epi8(ea)))
+                    | static_cast<uint64_t>(static_cast<unsigned>(_mm256_movemask_epi8(eb))) << 32;
+    if (mask)
+    {
+      return firstOf(p, mask);
+    }
+  }
+  return findAnyOfSse2(p, end, set, setLen);
+}
+
+#endif  // MUDUO_SCAN_X86
+
+const Kernels kScalar = { "scalar", findCRLFScalar, findCRLFCRLFScalar, findAnyOfScalar };
+#ifdef MUDUO_SCAN_X86
+const Kernels kSse2 = { "sse2", findCRLFSse2, findCRLFCRLFSse2, findAnyOfSse2 };
+const Kernels kAvx2 = { "avx2", findCRLFAvx2, findCRLFCRLFAvx2, findAnyOfAvx2 };
+#endif
+
+bool supports(const Kernels& k)
+{
+#ifdef MUDUO_SCAN_X86
+  if (&k == &kAvx2)
+  {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+  }
+#endif
+  (void)k;
+  return true;
+}
+
+Kernels bestKernels()
+{
+#ifdef MUDUO_SCAN_X86
+  return supports(kAvx2) ? kAvx2 : kSse2;
+#else
+  return kScalar;
+#endif
+}
+
+Kernels& kernels()
+{
+  static Kernels k = bestKernels();
+  return k;
+}
+
+}  // namespace
+
+const char* scan::findCRLF(const char* begin, const char* end)
+{
+  return kernels().findCRLF(begin, end);
+}
+
+const char* scan::findCRLFCRLF(const char* begin, const char* end)
+{
+  return kernels().findCRLFCRLF(begin, end);
+}
+
+const char* scan::findAnyOf(const char* begin, const char* end,
+                            const char* set, size_t setLen)
+{
+  return kernels().findAnyOf(begin, end, set, setLen);
+}
+
+const char* scan::kernelName()
+{
+  return kernels().name;
+}
+
+bool scan::setKernel(const char* name)
+{
+  const Kernels* all[] = {
+    &kScalar,
+#ifdef MUDUO_SCAN_X86
+    &kSse2,
+    &kAvx2,
+#endif
+  };
+  for (const Kernels* k : all)
+  {
+    if (strcmp(k->name, name) == 0 && supports(*k))
+    {
+      kernels() = *k;
+      return true;
+    }
+  }
+  return false;
+}
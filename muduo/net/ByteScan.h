@@ -0,0 +1,52 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_BYTESCAN_H
+#define MUDUO_NET_BYTESCAN_H
+
+#include <stddef.h>
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// Delimiter search for protocol parsers.
+///
+/// Uses AVX2 or SSE2 when the CPU has them, picked once at runtime,
+/// otherwise a portable scalar version.  All return NULL if not found.
+///
+namespace scan
+{
+
+/// The first "\r\n" in [begin, end).
+const char* findCRLF(const char* begin, const char* end);
+
+/// The first "\r\n\r\n" in [begin, end).
+const char* findCRLFCRLF(const char* begin, const char* end);
+
+/// The first byte in [begin, end) which is one of the @c setLen bytes of @c set.
+/// Sets of more than 16 bytes are searched with the scalar version.
+const char* findAnyOf(const char* begin, const char* end,
+                      const char* set, size_t setLen);
+
+/// "avx2", "sse2" or "scalar".
+const char* kernelName();
+
+/// Switches to the named kernels, returns false if the CPU can't run them.
+/// For tests and benchmarks, not thread safe.
+bool setKernel(const char* name);
+
+}  // namespace scan
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_BYTESCAN_H
@@ -58,6 +58,7 @@ namespace net
 // All client visible callbacks go here.
 
 class Buffer;
+class ChainBuffer;
 class TcpConnection;
 typedef std::shared_ptr<TcpConnection> TcpConnectionPtr;
 typedef std::function<void()> TimerCallback;
@@ -71,6 +72,11 @@ typedef std::function<void (const TcpConnectionPtr&,
                             Buffer*,
                             Timestamp)> MessageCallback;
 
+// the data has been read to a chain of blocks, which never moves it
+typedef std::function<void (const TcpConnectionPtr&,
+                            ChainBuffer*,
+                            Timestamp)> ChainMessageCallback;
+
 void defaultConnectionCallback(const TcpConnectionPtr& conn);
 void defaultMessageCallback(const TcpConnectionPtr& conn,
                             Buffer* buffer,
@@ -0,0 +1,381 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+
+#include "muduo/net/ChainBuffer.h"
+
+#include "muduo/net/BufferPool.h"
+#include "muduo/net/SocketsOps.h"
+
+#include <algorithm>
+
+#include <errno.h>
+#include <sys/uio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t ChainBuffer::kCheapPrepend;
+const size_t ChainBuffer::kDefaultBlockSize;
+
+namespace
+{
+// read at least this many bytes per readFd() when there is room in the socket
+const size_t kReadSize = 65536;
+const int kMaxReadIovec = 16;
+const int kMaxWriteIovec = 64;
+}  // namespace
+
+// Data follows the header in the same allocation.
+struct ChainBuffer::Block
+{
+  Block* next;
+  size_t capacity;
+  size_t readerIndex;
+  size_t writerIndex;
+
+  char* begin()
+  { return reinterpret_cast<char*>(this + 1); }
+
+  const char* begin() const
+  { return reinterpret_cast<const char*>(this + 1); }
+
+  size_t readableBytes() const
+  { return writerIndex - readerIndex; }
+
+  size_t writableBytes() const
+  { return capacity - writerIndex; }
+
+  // of the pool block, with this header
+  size_t allocatedBytes() const
+  { return BufferPool::roundUp(sizeof(Block) + capacity); }
+};
+
+ChainBuffer::ChainBuffer(size_t blockSize)
+  : blockSize_(std::max(blockSize, 2*kCheapPrepend)),
+    readable_(0),
+    numBlocks_(0),
+    head_(NULL),
+    tail_(NULL)
+{
+}
+
+ChainBuffer::~ChainBuffer()
+{
+  retrieveAll();
+}
+
+ChainBuffer::ChainBuffer(ChainBuffer&& rhs) noexcept
+  : blockSize_(rhs.blockSize_),
+    readable_(0),
+    numBlocks_(0),
+    head_(NULL),
+    tail_(NULL)
+{
+  swap(rhs);
+}
+
+ChainBuffer& ChainBuffer::operator=(ChainBuffer&& rhs) noexcept
+{
+  swap(rhs);
+  return *this;
+}
+
+void ChainBuffer::swap(ChainBuffer& rhs)
+{
+  std::swap(blockSize_, rhs.blockSize_);
+  std::swap(readable_, rhs.readable_);
+  std::swap(numBlocks_, rhs.numBlocks_);
+  std::swap(head_, rhs.head_);
+  std::swap(tail_, rhs.tail_);
+}
+
+const char* ChainBuffer::peek() const
+{
+  return head_ ? head_->begin() + head_->readerIndex : NULL;
+}
+
+size_t ChainBuffer::contiguousBytes() const
+{
+  return head_ ? head_->readableBytes() : 0;
+}
+
+const char* ChainBuffer::pullup(size_t len)
+{
+  assert(len <= readableBytes());
+  if (len <= contiguousBytes())
+  {
+    return peek();
+  }
+
+  // gather into one block large enough, then splice it in as the new head.
+  Block* block = newBlock(std::max(len + kCheapPrepend, blockSize_));
+  block->readerIndex = kCheapPrepend;
+  block->writerIndex = kCheapPrepend;
+  size_t left = len;
+  while (left > 0)
+  {
+    size_t n = std::min(left, head_->readableBytes());
+    ::memcpy(block->begin() + block->writerIndex, head_->begin() + head_->readerIndex, n);
+    block->writerIndex += n;
+    head_->readerIndex += n;
+    left -= n;
+    if (head_->readableBytes() == 0)
+    {
+      Block* next = head_->next;
+      freeBlock(head_);
+      --numBlocks_;
+      head_ = next;
+    }
+  }
+  block->next = head_;
+  head_ = block;
+  if (block->next == NULL)
+  {
+    tail_ = block;
+  }
+  ++numBlocks_;
+  return peek();
+}
+
+void ChainBuffer::copyOut(void* dest, size_t len) const
+{
+  assert(len <= readableBytes());
+  char* d = static_cast<char*>(dest);
+  for (const Block* b = head_; len > 0; b = b->next)
+  {
+    size_t n = std::min(len, b->readableBytes());
+    ::memcpy(d, b->begin() + b->readerIndex, n);
+    d += n;
+    len -= n;
+  }
+}
+
+void ChainBuffer::retrieve(size_t len)
+{
+  assert(len <= readableBytes());
+  readable_ -= len;
+  while (len > 0)
+  {
+    size_t n = head_->readableBytes();
+    if (len < n)
+    {
+      head_->readerIndex += len;
+      break;
+    }
+    len -= n;
+    Block* next = head_->next;
+    freeBlock(head_);
+    --numBlocks_;
+    head_ = next;
+  }
+  if (head_ == NULL)
+  {
+    tail_ = NULL;
+  }
+}
+
+void ChainBuffer::retrieveAll()
+{
+  while (head_)
+  {
+    Block* next = head_->next;
+    freeBlock(head_);
+    head_ = next;
+  }
+  tail_ = NULL;
+  readable_ = 0;
+  numBlocks_ = 0;
+}
+
+string ChainBuffer::retrieveAsString(size_t len)
+{
+  assert(len <= readableBytes());
+  string result(len, '\0');
+  if (len > 0)
+  {
+    copyOut(&*result.begin(), len);
+    retrieve(len);
+  }
+  return result;
+}
+
+void ChainBuffer::append(const char* /*restrict*/ data, size_t len)
+{
+  readable_ += len;
+  while (len > 0)
+  {
+    if (tail_ == NULL || tail_->writableBytes() == 0)
+    {
+      Block* block = newBlock(blockSize_);
+      if (head_ == NULL)
+      {
+        block->readerIndex = kCheapPrepend;
+        block->writerIndex = kCheapPrepend;
+      }
+      pushBack(block);
+    }
+    size_t n = std::min(len, tail_->writableBytes());
+    ::memcpy(tail_->begin() + tail_->writerIndex, data, n);
+    tail_->writerIndex += n;
+    data += n;
+    len -= n;
+  }
+}
+
+void ChainBuffer::prepend(const void* /*restrict*/ data, size_t len)
+{
+  if (head_ == NULL || head_->readerIndex < len)
+  {
+    Block* block = newBlock(std::max(len, blockSize_));
+    block->readerIndex = block->capacity;
+    block->writerIndex = block->capacity;
+    block->next = head_;
+    head_ = block;
+    if (tail_ == NULL)
+    {
+      tail_ = block;
+    }
+    ++numBlocks_;
+  }
+  head_->readerIndex -= len;
+  ::memcpy(head_->begin() + head_->readerIndex, data, len);
+  readable_ += len;
+}
+
+int ChainBuffer::readableIovec(struct iovec* iov, int maxiov) const
+{
+  int n = 0;
+  for (const Block* b = head_; b != NULL && n < maxiov; b = b->next)
+  {
+    if (b->readableBytes() > 0)
+    {
+      iov[n].iov_base = const_cast<char*>(b->begin() + b->readerIndex);
+      iov[n].iov_len = b->readableBytes();
+      ++n;
+    }
+  }
+  return n;
+}
+
+ssize_t ChainBuffer::readFd(int fd, int* savedErrno)
+{
+  struct iovec vec[kMaxReadIovec];
+  Block* fresh[kMaxReadIovec];
+  int iovcnt = 0;
+  int numFresh = 0;
+  size_t total = 0;
+  if (tail_ && tail_->writableBytes() > 0)
+  {
+    vec[0].iov_base = tail_->begin() + tail_->writerIndex;
+    vec[0].iov_len = tail_->writableBytes();
+    total = vec[0].iov_len;
+    iovcnt = 1;
+  }
+  while (total < kReadSize && iovcnt < kMaxReadIovec)
+  {
+    Block* block = newBlock(blockSize_);
+    if (head_ == NULL && numFresh == 0)
+    {
+      block->readerIndex = kCheapPrepend;
+      block->writerIndex = kCheapPrepend;
+    }
+    fresh[numFresh++] = block;
+    vec[iovcnt].iov_base = block->begin() + block->writerIndex;
+    vec[iovcnt].iov_len = block->writableBytes();
+    total += vec[iovcnt].iov_len;
+    ++iovcnt;
+  }
+
+  const ssize_t n = sockets::readv(fd, vec, iovcnt);
+  if (n < 0)
+  {
+    *savedErrno = errno;
+  }
+  size_t left = n > 0 ? implicit_cast<size_t>(n) : 0;
+  readable_ += left;
+  if (tail_ && tail_->writableBytes() > 0)
+  {
+    size_t filled = std::min(left, tail_->writableBytes());
+    tail_->writerIndex += filled;
+    left -= filled;
+  }
+  for (int i = 0; i < numFresh; ++i)
+  {
+    Block* block = fresh[i];
+    if (left > 0)
+    {
+      size_t filled = std::min(left, block->writableBytes());
+      block->writerIndex += filled;
+      left -= filled;
+      pushBack(block);
+    }
+    else
+    {
+      freeBlock(block);
+    }
+  }
+  return n;
+}
+
+ssize_t ChainBuffer::writeFd(int fd, int* savedErrno)
+{
+  struct iovec vec[kMaxWriteIovec];
+  int iovcnt = readableIovec(vec, kMaxWriteIovec);
+  if (iovcnt == 0)
+  {
+    return 0;
+  }
+  const ssize_t n = sockets::writev(fd, vec, iovcnt);
+  if (n < 0)
+  {
+    *savedErrno = errno;
+  }
+  else
+  {
+    retrieve(n);
+  }
+  return n;
+}
+
+ChainBuffer::Block* ChainBuffer::newBlock(size_t capacity)
+{
+  // a default block with its header fills a size class of the pool exactly
+  static_assert(sizeof(Block) + kDefaultBlockSize == 16384 + kCheapPrepend,
+                "Block header");
+  size_t allocated = 0;
+  Block* block = reinterpret_cast<Block*>(
+      BufferPool::allocate(sizeof(Block) + capacity, &allocated));
+  block->capacity = capacity;
+  assert(block->allocatedBytes() == allocated);
+  (void)allocated;
+  block->next = NULL;
+  block->readerIndex = 0;
+  block->writerIndex = 0;
+  return block;
+}
+
+void ChainBuffer::freeBlock(Block* block)
+{
+  BufferPool::deallocate(reinterpret_cast<char*>(block), block->allocatedBytes());
+}
+
+void ChainBuffer::pushBack(Block* block)
+{
+  block->next = NULL;
+  if (tail_)
+  {
+    tail_->next = block;
+  }
+  else
+  {
+    head_ = block;
+  }
+  tail_ = block;
+  ++numBlocks_;
+}
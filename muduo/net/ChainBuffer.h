@@ -0,0 +1,234 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_CHAINBUFFER_H
+#define MUDUO_NET_CHAINBUFFER_H
+
+#include "muduo/base/noncopyable.h"
+#include "muduo/base/StringPiece.h"
+#include "muduo/base/Types.h"
+
+#include "muduo/net/Endian.h"
+
+#include <assert.h>
+#include <string.h>
+
+struct iovec;
+
+namespace muduo
+{
+namespace net
+{
+
+/// A segmented buffer, made of a chain of fixed-size blocks.
+///
+/// @code
+///  head                                                 tail
+/// +-------------+     +-------------+     +-------------+
+/// | .....###### | --> | ########### | --> | #####...... |
+/// +-------------+     +-------------+     +-------------+
+///       ^ peek()                                ^ writable bytes
+/// @endcode
+///
+/// Unlike Buffer, growing never moves readable bytes and retrieving
+/// frees whole blocks, so both are O(1) regardless of the payload size.
+/// The price is that readable bytes are not contiguous, peek() only
+/// covers the head block.  Parsers that need a contiguous view of the
+/// first N bytes call pullup(N), which copies at most N bytes.
+///
+/// Blocks come from the BufferPool of the calling thread, like Buffer's
+/// storage, so a stream through an EventLoop recycles the same few blocks.
+class ChainBuffer : noncopyable
+{
+ public:
+  static const size_t kCheapPrepend = 8;
+  /// With its header, a block takes 16KiB of the pool.
+  static const size_t kDefaultBlockSize = 16384 - 24;
+
+  explicit ChainBuffer(size_t blockSize = kDefaultBlockSize);
+  ~ChainBuffer();
+
+  ChainBuffer(ChainBuffer&& rhs) noexcept;
+  ChainBuffer& operator=(ChainBuffer&& rhs) noexcept;
+
+  void swap(ChainBuffer& rhs);
+
+  size_t readableBytes() const
+  { return readable_; }
+
+  size_t blockSize() const
+  { return blockSize_; }
+
+  size_t numBlocks() const
+  { return numBlocks_; }
+
+  /// Readable bytes in the head block, starting at peek().
+  const char* peek() const;
+  size_t contiguousBytes() const;
+
+  /// Makes the first @c len readable bytes contiguous,
+  /// returns a pointer to them, which is also peek() afterwards.
+  ///
+  /// Copies only when the bytes span more than one block.
+  const char* pullup(size_t len);
+
+  /// Copies the first @c len readable bytes to @c dest, without retrieving.
+  void copyOut(void* dest, size_t len) const;
+
+  void retrieve(size_t len);
+  void retrieveAll();
+  string retrieveAsString(size_t len);
+  string retrieveAllAsString()
+  { return retrieveAsString(readableBytes()); }
+
+  void append(const StringPiece& str)
+  { append(str.data(), str.size()); }
+
+  void append(const char* /*restrict*/ data, size_t len);
+
+  void append(const void* /*restrict*/ data, size_t len)
+  { append(static_cast<const char*>(data), len); }
+
+  /// Always O(1), allocates a new head block if there is no room in front.
+  void prepend(const void* /*restrict*/ data, size_t len);
+
+  void appendInt64(int64_t x)
+  {
+    int64_t be64 = sockets::hostToNetwork64(x);
+    append(&be64, sizeof be64);
+  }
+
+  void appendInt32(int32_t x)
+  {
+    int32_t be32 = sockets::hostToNetwork32(x);
+    append(&be32, sizeof be32);
+  }
+
+  void appendInt16(int16_t x)
+  {
+    int16_t be16 = sockets::hostToNetwork16(x);
+    append(&be16, sizeof be16);
+  }
+
+  void appendInt8(int8_t x)
+  { append(&x, sizeof x); }
+
+  void prependInt64(int64_t x)
+  {
+    int64_t be64 = sockets::hostToNetwork64(x);
+    prepend(&be64, sizeof be64);
+  }
+
+  void prependInt32(int32_t x)
+  {
+    int32_t be32 = sockets::hostToNetwork32(x);
+    prepend(&be32, sizeof be32);
+  }
+
+  void prependInt16(int16_t x)
+  {
+    int16_t be16 = sockets::hostToNetwork16(x);
+    prepend(&be16, sizeof be16);
+  }
+
+  void prependInt8(int8_t x)
+  { prepend(&x, sizeof x); }
+
+  ///
+  /// Peek integers from network endian, may span blocks.
+  ///
+  int64_t peekInt64() const
+  {
+    assert(readableBytes() >= sizeof(int64_t));
+    int64_t be64 = 0;
+    copyOut(&be64, sizeof be64);
+    return sockets::networkToHost64(be64);
+  }
+
+  int32_t peekInt32() const
+  {
+    assert(readableBytes() >= sizeof(int32_t));
+    int32_t be32 = 0;
+    copyOut(&be32, sizeof be32);
+    return sockets::networkToHost32(be32);
+  }
+
+  int16_t peekInt16() const
+  {
+    assert(readableBytes() >= sizeof(int16_t));
+    int16_t be16 = 0;
+    copyOut(&be16, sizeof be16);
+    return sockets::networkToHost16(be16);
+  }
+
+  int8_t peekInt8() const
+  {
+    assert(readableBytes() >= sizeof(int8_t));
+    return *peek();
+  }
+
+  int64_t readInt64()
+  {
+    int64_t result = peekInt64();
+    retrieve(sizeof result);
+    return result;
+  }
+
+  int32_t readInt32()
+  {
+    int32_t result = peekInt32();
+    retrieve(sizeof result);
+    return result;
+  }
+
+  int16_t readInt16()
+  {
+    int16_t result = peekInt16();
+    retrieve(sizeof result);
+    return result;
+  }
+
+  int8_t readInt8()
+  {
+    int8_t result = peekInt8();
+    retrieve(sizeof result);
+    return result;
+  }
+
+  /// Fills at most @c maxiov entries describing readable bytes,
+  /// returns the number of entries filled.
+  int readableIovec(struct iovec* iov, int maxiov) const;
+
+  /// Read data directly into the tail blocks with readv(2).
+  /// @return result of read(2), @c errno is saved
+  ssize_t readFd(int fd, int* savedErrno);
+
+  /// Write readable bytes with writev(2), retrieves what was written.
+  /// @return result of write(2), @c errno is saved
+  ssize_t writeFd(int fd, int* savedErrno);
+
+ private:
+  struct Block;
+
+  Block* newBlock(size_t capacity);
+  void freeBlock(Block* block);
+  void pushBack(Block* block);
+
+  size_t blockSize_;
+  size_t readable_;
+  size_t numBlocks_;
+  Block* head_;
+  Block* tail_;
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_CHAINBUFFER_H
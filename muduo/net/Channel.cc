@@ -32,6 +32,7 @@ Channel::Channel(EventLoop *loop, int fd__)
       events_(0),    // 初始事件为 0
       revents_(0),   // 事件响应初始化为 0
       index_(-1),    // 默认通道索引为 -1
+      edgeTriggered_(false),  // 默认水平触发
       logHup_(true), // 默认开启 HUP 日志
       tied_(false),  // 默认没有绑定对象
       eventHandling_(false),  // 默认没有事件处理
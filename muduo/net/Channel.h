@@ -121,10 +121,21 @@ namespace muduo
                 update();
             }
 
+            // 以边缘触发方式同时关注读写事件，只注册一次，
+            // 之后读写都要进行到 EAGAIN，Poller 须支持边缘触发
+            void enableEdgeTriggered()
+            {
+                edgeTriggered_ = true;
+                events_ = kReadEvent | kWriteEvent;
+                update();
+            }
+
             // 判断当前是否为写事件
             bool isWriting() const { return events_ & kWriteEvent; }
             // 判断当前是否为读事件
             bool isReading() const { return events_ & kReadEvent; }
+            // 判断是否为边缘触发
+            bool isEdgeTriggered() const { return edgeTriggered_; }
 
             // 供 Poller 使用，获取和设置索引
             int index() { return index_; }
@@ -163,6 +174,7 @@ namespace muduo
             int events_;  // 当前事件类型
             int revents_; // 接收到的事件类型（由 Poller 或 epoll 等设置）
             int index_;  // Poller 使用的索引
+            bool edgeTriggered_;  // 是否边缘触发
             bool logHup_;  // 是否记录 HUP 事件日志
 
             // 绑定对象的 weak_ptr，防止持有对象导致循环引用
@@ -0,0 +1,105 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include "muduo/net/ConnectionTable.h"
+
+#include <assert.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+const size_t kInitialCapacity = 16;
+}  // namespace
+
+ConnectionTable::ConnectionTable()
+  : slots_(kInitialCapacity),
+    size_(0)
+{
+}
+
+void ConnectionTable::insert(int64_t id, const TcpConnectionPtr& conn)
+{
+  assert(id > 0);
+  if ((size_ + 1) * 2 > slots_.size())
+  {
+    grow();
+  }
+  size_t index = homeOf(id);
+  while (slots_[index].id != 0)
+  {
+    assert(slots_[index].id != id);
+    index = next(index);
+  }
+  slots_[index].id = id;
+  slots_[index].conn = conn;
+  ++size_;
+}
+
+bool ConnectionTable::erase(int64_t id)
+{
+  size_t hole = homeOf(id);
+  while (slots_[hole].id != id)
+  {
+    if (slots_[hole].id == 0)
+    {
+      return false;
+    }
+    hole = next(hole);
+  }
+
+  // shifts back each following entry that may fill the hole, up to an empty slot
+  const size_t mask = slots_.size() - 1;
+  for (size_t index = next(hole); slots_[index].id != 0; index = next(index))
+  {
+    size_t home = homeOf(slots_[index].id);
+    // unless its home is after the hole
+    if (((index - home) & mask) >= ((index - hole) & mask))
+    {
+      slots_[hole].id = slots_[index].id;
+      slots_[hole].conn = std::move(slots_[index].conn);
+      hole = index;
+    }
+  }
+  slots_[hole].id = 0;
+  slots_[hole].conn.reset();
+  --size_;
+  return true;
+}
+
+TcpConnectionPtr ConnectionTable::find(int64_t id) const
+{
+  for (size_t index = homeOf(id); slots_[index].id != 0; index = next(index))
+  {
+    if (slots_[index].id == id)
+    {
+      return slots_[index].conn;
+    }
+  }
+  return TcpConnectionPtr();
+}
+
+void ConnectionTable::grow()
+{
+  std::vector<Slot> slots(slots_.size() * 2);
+  slots_.swap(slots);
+  for (Slot& slot : slots)
+  {
+    if (slot.id != 0)
+    {
+      size_t index = homeOf(slot.id);
+      while (slots_[index].id != 0)
+      {
+        index = next(index);
+      }
+      slots_[index].id = slot.id;
+      slots_[index].conn = std::move(slot.conn);
+    }
+  }
+}
@@ -0,0 +1,86 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_CONNECTIONTABLE_H
+#define MUDUO_NET_CONNECTIONTABLE_H
+
+#include "muduo/base/noncopyable.h"
+#include "muduo/net/Callbacks.h"
+
+#include <vector>
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// Connections of a TcpServer, by their positive 64-bit ids.
+///
+/// An open-addressed table with linear probing, in one array that doubles
+/// when half full.  Ids are handed out in sequence, so an id modulo the
+/// capacity is its home slot, and removing shifts the following entries
+/// back instead of leaving tombstones.
+///
+class ConnectionTable : noncopyable
+{
+ public:
+  ConnectionTable();
+
+  size_t size() const
+  { return size_; }
+
+  size_t capacity() const
+  { return slots_.size(); }
+
+  /// @c id must not be in the table.
+  void insert(int64_t id, const TcpConnectionPtr& conn);
+  /// Returns false if @c id is not in the table.
+  bool erase(int64_t id);
+  /// Returns null if @c id is not in the table.
+  TcpConnectionPtr find(int64_t id) const;
+
+  /// Calls @c func with a reference to each connection, which may reset it,
+  /// the id stays in the table.
+  template<typename Func>
+  void forEach(Func func)
+  {
+    for (Slot& slot : slots_)
+    {
+      if (slot.id != 0)
+      {
+        func(slot.conn);
+      }
+    }
+  }
+
+ private:
+  struct Slot
+  {
+    int64_t id;  // 0 if empty
+    TcpConnectionPtr conn;
+  };
+
+  size_t homeOf(int64_t id) const
+  { return static_cast<size_t>(id) & (slots_.size() - 1); }
+
+  size_t next(size_t index) const
+  { return (index + 1) & (slots_.size() - 1); }
+
+  void grow();
+
+  std::vector<Slot> slots_;  // the size is a power of 2
+  size_t size_;
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_CONNECTIONTABLE_H
@@ -10,6 +10,7 @@
 
 #include "muduo/base/Logging.h"
 #include "muduo/base/Mutex.h"
+#include "muduo/net/BufferPool.h"
 #include "muduo/net/Channel.h"
 #include "muduo/net/Poller.h"
 #include "muduo/net/SocketsOps.h"
@@ -54,6 +55,18 @@ namespace
 #pragma GCC diagnostic error "-Wold-style-cast"
 
     IgnoreSigPipe initObj;
+
+    MutexLock& registryMutex()
+    {
+        static MutexLock mutex;
+        return mutex;
+    }
+
+    std::vector<EventLoop*>& registry()
+    {
+        static std::vector<EventLoop*> loops;
+        return loops;
+    }
 } // namespace
 
 EventLoop* EventLoop::getEventLoopOfCurrentThread()
@@ -68,9 +81,14 @@ EventLoop::EventLoop()
       callingPendingFunctors_(false),
       iteration_(0),
       threadId_(CurrentThread::tid()),
+      bufferPool_(new BufferPool),
       poller_(Poller::newDefaultPoller(this)),
       timerQueue_(new TimerQueue(this)),
       wakeupFd_(createEventfd()),
+      wakeupPending_(false),
+      numQueued_(0),
+      numWakeups_(0),
+      numConnections_(0),
       wakeupChannel_(new Channel(this, wakeupFd_)),
       currentActiveChannel_(NULL)
 {
@@ -88,12 +106,19 @@ EventLoop::EventLoop()
         std::bind(&EventLoop::handleRead, this));
     // we are always reading the wakeupfd
     wakeupChannel_->enableReading();
+    MutexLockGuard lock(registryMutex());
+    registry().push_back(this);
 }
 
 EventLoop::~EventLoop()
 {
     LOG_DEBUG << "EventLoop " << this << " of thread " << threadId_
             << " destructs in thread " << CurrentThread::tid();
+    {
+        MutexLockGuard lock(registryMutex());
+        std::vector<EventLoop*>& loops = registry();
+        loops.erase(std::remove(loops.begin(), loops.end(), this), loops.end());
+    }
     wakeupChannel_->disableAll();
     wakeupChannel_->remove();
     ::close(wakeupFd_);
@@ -111,7 +136,12 @@ void EventLoop::loop()
     while (!quit_)
     {
         activeChannels_.clear();
-        pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_);
+        // don't block if something was left for the end of this iteration,
+        // nor past the next coarse timer
+        pollReturnTime_ = poller_->poll(afterIterationFunctors_.empty()
+                                            ? timerQueue_->pollTimeoutMs(kPollTimeMs)
+                                            : 0,
+                                        &activeChannels_);
         ++iteration_;
         if (Logger::logLevel() <= Logger::TRACE)
         {
@@ -125,8 +155,15 @@ void EventLoop::loop()
             currentActiveChannel_->handleEvent(pollReturnTime_);
         }
         currentActiveChannel_ = NULL;
+        timerQueue_->runCoarse(pollReturnTime_);
         eventHandling_ = false;
         doPendingFunctors();
+        if (!afterIterationFunctors_.empty())
+        {
+            doAfterIteration();
+            // what those queued, eg. writeCompleteCallback
+            doPendingFunctors();
+        }
     }
 
     LOG_TRACE << "EventLoop " << this << " stop looping";
@@ -159,10 +196,8 @@ void EventLoop::runInLoop(Functor cb)
 
 void EventLoop::queueInLoop(Functor cb)
 {
-    {
-        MutexLockGuard lock(mutex_);
-        pendingFunctors_.push_back(std::move(cb));
-    }
+    pendingFunctors_.push(std::move(cb));
+    numQueued_.fetch_add(1, std::memory_order_relaxed);
 
     if (!isInLoopThread() || callingPendingFunctors_)
     {
@@ -170,12 +205,41 @@ void EventLoop::queueInLoop(Functor cb)
     }
 }
 
+void EventLoop::runAfterIteration(Functor cb)
+{
+    assertInLoopThread();
+    afterIterationFunctors_.push_back(std::move(cb));
+}
+
 size_t EventLoop::queueSize() const
 {
-    MutexLockGuard lock(mutex_);
     return pendingFunctors_.size();
 }
 
+string EventLoop::allStatsString()
+{
+    string result;
+    char buf[256];
+    MutexLockGuard lock(registryMutex());
+    for (const EventLoop* loop : registry())
+    {
+        const int64_t queued = loop->numQueued();
+        const int64_t wakeups = loop->numWakeups();
+        snprintf(buf, sizeof buf,
+                 "tid %d queued %lld wakeups %lld (%.1f%%) pending %zu connections %d"
+                 " skipped_poller_updates %lld\n",
+                 loop->threadId_,
+                 static_cast<long long>(queued),
+                 static_cast<long long>(wakeups),
+                 queued > 0 ? 100.0 * static_cast<double>(wakeups) / static_cast<double>(queued) : 0.0,
+                 loop->queueSize(),
+                 loop->numConnections(),
+                 static_cast<long long>(loop->numSkippedPollerUpdates()));
+        result += buf;
+    }
+    return result;
+}
+
 TimerId EventLoop::runAt(Timestamp time, TimerCallback cb)
 {
     return timerQueue_->addTimer(std::move(cb), time, 0.0);
@@ -193,11 +257,34 @@ TimerId EventLoop::runEvery(double interval, TimerCallback cb)
     return timerQueue_->addTimer(std::move(cb), time, interval);
 }
 
+TimerId EventLoop::runAfterCoarse(double delay, TimerCallback cb)
+{
+    Timestamp time(addTime(Timestamp::now(), delay));
+    return timerQueue_->addTimer(std::move(cb), time, 0.0, true);
+}
+
+TimerId EventLoop::runEveryCoarse(double interval, TimerCallback cb)
+{
+    Timestamp time(addTime(Timestamp::now(), interval));
+    return timerQueue_->addTimer(std::move(cb), time, interval, true);
+}
+
 void EventLoop::cancel(TimerId timerId)
 {
     return timerQueue_->cancel(timerId);
 }
 
+void EventLoop::resetTimer(TimerId timerId, Timestamp time, bool lazy)
+{
+    timerQueue_->resetTimer(timerId, time, lazy);
+}
+
+void EventLoop::setTimerStructure(TimerStructure structure)
+{
+    assertInLoopThread();
+    timerQueue_->setStructure(structure);
+}
+
 void EventLoop::updateChannel(Channel* channel)
 {
     assert(channel->ownerLoop() == this);
@@ -224,6 +311,16 @@ bool EventLoop::hasChannel(Channel* channel)
     return poller_->hasChannel(channel);
 }
 
+bool EventLoop::supportsEdgeTriggered() const
+{
+    return poller_->supportsEdgeTriggered();
+}
+
+int64_t EventLoop::numSkippedPollerUpdates() const
+{
+    return poller_->numSkippedUpdates();
+}
+
 void EventLoop::abortNotInLoopThread()
 {
     LOG_FATAL << "EventLoop::abortNotInLoopThread - EventLoop " << this
@@ -233,6 +330,12 @@ void EventLoop::abortNotInLoopThread()
 
 void EventLoop::wakeup()
 {
+    // one write until the loop drains, it will see whatever was queued before
+    if (wakeupPending_.exchange(true, std::memory_order_acq_rel))
+    {
+        return;
+    }
+    numWakeups_.fetch_add(1, std::memory_order_relaxed);
     uint64_t one = 1;
     ssize_t n = sockets::write(wakeupFd_, &one, sizeof one);
     if (n != sizeof one)
@@ -253,19 +356,29 @@ void EventLoop::handleRead()
 
 void EventLoop::doPendingFunctors()
 {
-    std::vector<Functor> functors;
+    Functor functor;
     callingPendingFunctors_ = true;
+    // before draining, so a functor queued after it is drained, or wakes us up again
+    wakeupPending_.exchange(false, std::memory_order_acq_rel);
 
+    // only those queued so far, what they queue waits for the next iteration
+    const size_t n = pendingFunctors_.size();
+    for (size_t i = 0; i < n && pendingFunctors_.pop(&functor); ++i)
     {
-        MutexLockGuard lock(mutex_);
-        functors.swap(pendingFunctors_);
+        functor();
     }
+    callingPendingFunctors_ = false;
+}
 
-    for (const Functor& functor : functors)
+void EventLoop::doAfterIteration()
+{
+    // may grow while running, keeps its capacity for the next iteration
+    for (size_t i = 0; i < afterIterationFunctors_.size(); ++i)
     {
+        Functor functor(std::move(afterIterationFunctors_[i]));
         functor();
     }
-    callingPendingFunctors_ = false;
+    afterIterationFunctors_.clear();
 }
 
 void EventLoop::printActiveChannels() const
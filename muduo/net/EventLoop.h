@@ -19,6 +19,8 @@
 
 #include "muduo/base/Mutex.h"
 #include "muduo/base/CurrentThread.h"
+#include "muduo/base/MoveOnlyFunction.h"
+#include "muduo/base/MpscQueue.h"
 #include "muduo/base/Timestamp.h"
 #include "muduo/net/Callbacks.h"
 #include "muduo/net/TimerId.h"
@@ -27,6 +29,7 @@ namespace muduo
 {
     namespace net
     {
+        class BufferPool;
         class Channel;
         class Poller;
         class TimerQueue;
@@ -38,7 +41,9 @@ namespace muduo
         class EventLoop : noncopyable
         {
         public:
-            typedef std::function<void()> Functor;
+            // movable only, may own what it carries into the loop, eg. a Buffer.
+            // empty if made of an empty std::function, as a std::function would be.
+            typedef MoveOnlyFunction<void()> Functor;
 
             EventLoop();
             ~EventLoop(); // force out-line dtor, for std::unique_ptr members. //因此，理论上，如果类中只包含 unique_ptr 或其他类似的智能指针，我们完全可以在类内定义析构函数，因为 unique_ptr 会负责资源的清理。
@@ -72,9 +77,29 @@ namespace muduo
             /// Runs after finish pooling.
             /// Safe to call from other threads.
             void queueInLoop(Functor cb);
+            /// Runs callback at the end of this iteration,
+            /// after the queued callbacks, eg. to flush what was sent during it.
+            /// Must be called in the loop thread.
+            void runAfterIteration(Functor cb);
 
             size_t queueSize() const;
 
+            /// Functors queued so far, and the eventfd writes it took to wake
+            /// the loop for them, bursts are coalesced into one wakeup.
+            int64_t numQueued() const { return numQueued_.load(std::memory_order_relaxed); }
+            int64_t numWakeups() const { return numWakeups_.load(std::memory_order_relaxed); }
+            /// Channel updates the Poller applied without a system call each.
+            int64_t numSkippedPollerUpdates() const;
+
+            /// Connections served by this loop, from when they are assigned
+            /// to it, see EventLoopThreadPool::setStrategy().
+            int numConnections() const { return numConnections_.load(std::memory_order_relaxed); }
+            // internal usage, by TcpConnection
+            void addConnections(int delta) { numConnections_.fetch_add(delta, std::memory_order_relaxed); }
+
+            /// Counters of every EventLoop in this process, a line each.
+            static string allStatsString();
+
             // timers
 
             ///
@@ -93,16 +118,55 @@ namespace muduo
             ///
             TimerId runEvery(double interval, TimerCallback cb);
             ///
+            /// Runs callback after @c delay seconds, up to 10ms late.
+            /// Coarse timers are bucketed, and checked whenever the loop
+            /// wakes up, they don't program the timerfd.
+            /// For timeouts that needn't be precise, eg. idle checks.
+            /// Safe to call from other threads.
+            ///
+            TimerId runAfterCoarse(double delay, TimerCallback cb);
+            ///
+            /// Runs callback every @c interval seconds, each up to 10ms late.
+            /// Safe to call from other threads.
+            ///
+            TimerId runEveryCoarse(double interval, TimerCallback cb);
+            ///
             /// Cancels the timer.
             /// Safe to call from other threads.
             ///
             void cancel(TimerId timerId);
+            ///
+            /// Moves the timer to expire at @c time, its TimerId stays valid.
+            /// Lazily, a later time is only recorded, and the timer is queued
+            /// again for it when it comes up, so that pushing back a deadline
+            /// often costs little, eg. an idle timeout on every message.
+            /// From its own callback, it runs again at @c time.
+            /// Does nothing if it has run, or been canceled.
+            /// Safe to call from other threads.
+            ///
+            void resetTimer(TimerId timerId, Timestamp time, bool lazy = false);
+
+            enum TimerStructure
+            {
+                kTimerTree,   // a balanced tree, O(log n), the default
+                kTimerWheel,  // a hierarchical timing wheel, O(1), to 1ms
+                kTimerHeap,   // a 4-ary heap, O(log n), compact
+            };
+
+            ///
+            /// Orders the timers of this loop with another structure,
+            /// the wheel suits many timers re-armed often, eg. idle timeouts.
+            /// Must be called in the loop thread, eg. from a ThreadInitCallback.
+            ///
+            void setTimerStructure(TimerStructure structure);
 
             // internal usage
             void wakeup();
             void updateChannel(Channel* channel);
             void removeChannel(Channel* channel);
             bool hasChannel(Channel* channel);
+            // whether channels may be edge-triggered, depends on the Poller
+            bool supportsEdgeTriggered() const;
 
             // pid_t threadId() const { return threadId_; }
             void assertInLoopThread()
@@ -138,6 +202,7 @@ namespace muduo
             void abortNotInLoopThread();
             void handleRead(); // waked up
             void doPendingFunctors();
+            void doAfterIteration();
 
             void printActiveChannels() const; // DEBUG
 
@@ -150,9 +215,16 @@ namespace muduo
             int64_t iteration_;
             const pid_t threadId_;
             Timestamp pollReturnTime_;
+            // first, so that it is destroyed last
+            std::unique_ptr<BufferPool> bufferPool_;
             std::unique_ptr<Poller> poller_;
             std::unique_ptr<TimerQueue> timerQueue_;
             int wakeupFd_;
+            // eventfd was written and the loop has not drained since
+            std::atomic<bool> wakeupPending_;
+            std::atomic<int64_t> numQueued_;
+            std::atomic<int64_t> numWakeups_;
+            std::atomic<int> numConnections_;
             // unlike in TimerQueue, which is an internal class,
             // we don't expose Channel to client.
             std::unique_ptr<Channel> wakeupChannel_;
@@ -162,8 +234,10 @@ namespace muduo
             ChannelList activeChannels_;
             Channel* currentActiveChannel_;
 
-            mutable MutexLock mutex_;
-            std::vector<Functor> pendingFunctors_ GUARDED_BY(mutex_);
+            // lock-free, queueInLoop from many threads doesn't contend on a mutex
+            MpscQueue<Functor> pendingFunctors_;
+            // loop thread only
+            std::vector<Functor> afterIterationFunctors_;
         };
     } // namespace net
 } // namespace muduo
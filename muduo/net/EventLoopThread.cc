@@ -29,7 +29,8 @@ EventLoopThread::~EventLoopThread() {
     {
         // still a tiny chance to call destructed object, if threadFunc exits just now.
         // but when EventLoopThread destructs, usually programming is exiting anyway.
-        loop_->quit();
+        // quits from inside, loop() may not have started yet and would forget a quit().
+        loop_->queueInLoop(std::bind(&EventLoop::quit, loop_));
         thread_.join();
     }
 }
@@ -8,20 +8,46 @@
 
 #include "muduo/net/EventLoopThreadPool.h"
 
+#include "muduo/base/Logging.h"
 #include "muduo/net/EventLoop.h"
 #include "muduo/net/EventLoopThread.h"
 
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdio.h>
+#include <unistd.h>
 
 using namespace muduo;
 using namespace muduo::net;
 
+namespace
+{
+
+void pinToCpu(int cpu)
+{
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(cpu, &cpus);
+  int ret = ::pthread_setaffinity_np(::pthread_self(), sizeof cpus, &cpus);
+  if (ret != 0)
+  {
+    errno = ret;
+    LOG_SYSERR << "pthread_setaffinity_np " << cpu;
+  }
+}
+
+}  // namespace
+
 EventLoopThreadPool::EventLoopThreadPool(EventLoop* baseLoop, const string& nameArg)
   : baseLoop_(baseLoop),
     name_(nameArg),
     started_(false),
     numThreads_(0),
-    next_(0)
+    cpuAffinity_(false),
+    strategy_(kRoundRobin),
+    next_(0),
+    random_(reinterpret_cast<uintptr_t>(this) | 1)
 {
 }
 
@@ -37,11 +63,24 @@ void EventLoopThreadPool::start(const ThreadInitCallback& cb)
 
   started_ = true;
 
+  const long numCpus = ::sysconf(_SC_NPROCESSORS_ONLN);
   for (int i = 0; i < numThreads_; ++i)
   {
     char buf[name_.size() + 32];
     snprintf(buf, sizeof buf, "%s%d", name_.c_str(), i);
-    EventLoopThread* t = new EventLoopThread(cb, buf);
+    ThreadInitCallback init = cb;
+    if (cpuAffinity_ && numCpus > 0)
+    {
+      const int cpu = static_cast<int>(i % numCpus);
+      init = [cpu, cb](EventLoop* loop) {
+        pinToCpu(cpu);
+        if (cb)
+        {
+          cb(loop);
+        }
+      };
+    }
+    EventLoopThread* t = new EventLoopThread(init, buf);
     threads_.push_back(std::unique_ptr<EventLoopThread>(t));
     loops_.push_back(t->startLoop());
   }
@@ -59,8 +98,27 @@ EventLoop* EventLoopThreadPool::getNextLoop()
 
   if (!loops_.empty())
   {
-    // round-robin
+    const int size = static_cast<int>(loops_.size());
+    if (strategy_ == kTwoChoices && size > 1)
+    {
+      int first = static_cast<int>(nextRandom() % static_cast<uint64_t>(size));
+      int second = (first + 1 + static_cast<int>(nextRandom() % static_cast<uint64_t>(size - 1))) % size;
+      return loadOf(loops_[second]) < loadOf(loops_[first]) ? loops_[second] : loops_[first];
+    }
+
+    // round-robin, also to break ties
     loop = loops_[next_];
+    if (strategy_ == kLeastConnections || strategy_ == kLeastQueued)
+    {
+      for (int i = 1; i < size; ++i)
+      {
+        EventLoop* other = loops_[(next_ + i) % size];
+        if (loadOf(other) < loadOf(loop))
+        {
+          loop = other;
+        }
+      }
+    }
     ++next_;
     if (implicit_cast<size_t>(next_) >= loops_.size())
     {
@@ -70,6 +128,20 @@ EventLoop* EventLoopThreadPool::getNextLoop()
   return loop;
 }
 
+int64_t EventLoopThreadPool::loadOf(EventLoop* loop) const
+{
+  return strategy_ == kLeastQueued ? static_cast<int64_t>(loop->queueSize())
+                                   : loop->numConnections();
+}
+
+uint64_t EventLoopThreadPool::nextRandom()
+{
+  random_ ^= random_ << 13;
+  random_ ^= random_ >> 7;
+  random_ ^= random_ << 17;
+  return random_;
+}
+
 EventLoop* EventLoopThreadPool::getLoopForHash(size_t hashCode)
 {
   baseLoop_->assertInLoopThread();
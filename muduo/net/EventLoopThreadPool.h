@@ -32,13 +32,28 @@ class EventLoopThreadPool : noncopyable
  public:
   typedef std::function<void(EventLoop*)> ThreadInitCallback;
 
+  /// How getNextLoop() chooses among the loops.
+  enum Strategy
+  {
+    kRoundRobin,        // in turn, the default
+    kLeastConnections,  // the one with fewest connections
+    kTwoChoices,        // the one with fewer connections, of two at random
+    kLeastQueued,       // the one with fewest functors queued
+  };
+
   EventLoopThreadPool(EventLoop* baseLoop, const string& nameArg);
   ~EventLoopThreadPool();
   void setThreadNum(int numThreads) { numThreads_ = numThreads; }
+  /// Pins the i-th thread to CPU i, modulo the number of CPUs online.
+  /// Must be called before start().
+  void setCpuAffinity(bool on) { cpuAffinity_ = on; }
+  /// Loads are read from EventLoop::numConnections() and queueSize(),
+  /// ties go in turn.
+  void setStrategy(Strategy strategy) { strategy_ = strategy; }
   void start(const ThreadInitCallback& cb = ThreadInitCallback());
 
   // valid after calling start()
-  /// round-robin
+  /// by the strategy, round-robin by default
   EventLoop* getNextLoop();
 
   /// with the same hash code, it will always return the same EventLoop
@@ -53,12 +68,17 @@ class EventLoopThreadPool : noncopyable
   { return name_; }
 
  private:
+  int64_t loadOf(EventLoop* loop) const;
+  uint64_t nextRandom();
 
   EventLoop* baseLoop_;
   string name_;
   bool started_;
   int numThreads_;
+  bool cpuAffinity_;
+  Strategy strategy_;
   int next_;
+  uint64_t random_;  // xorshift state, for kTwoChoices
   std::vector<std::unique_ptr<EventLoopThread>> threads_;
   std::vector<EventLoop*> loops_;
 };
@@ -0,0 +1,311 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+
+#include "muduo/net/OutputQueue.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/SocketsOps.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <sys/uio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+const int kMaxIovec = IOV_MAX;
+}  // namespace
+
+OutputQueue::Chunk::Chunk(Chunk&& rhs) noexcept
+  : buffer(std::move(rhs.buffer)),
+    shared(std::move(rhs.shared)),
+    offset(rhs.offset),
+    fd(rhs.fd),
+    fileOffset(rhs.fileOffset),
+    fileBytes(rhs.fileBytes),
+    zerocopy(rhs.zerocopy),
+    pinned(rhs.pinned),
+    lastSeq(rhs.lastSeq),
+    chained(rhs.chained),
+    chain(std::move(rhs.chain))
+{
+  rhs.fd = -1;
+}
+
+OutputQueue::Chunk::~Chunk()
+{
+  if (fd >= 0)
+  {
+    sockets::close(fd);
+  }
+}
+
+void OutputQueue::Chunk::retrieve(size_t len)
+{
+  if (isFile())
+  {
+    fileOffset += static_cast<off_t>(len);
+    fileBytes -= len;
+  }
+  else if (chained)
+  {
+    chain.retrieve(len);
+  }
+  else if (shared || zerocopy)
+  {
+    offset += len;
+  }
+  else
+  {
+    buffer.retrieve(len);
+  }
+}
+
+OutputQueue::OutputQueue()
+  : bytes_(0),
+    nextSeq_(0),
+    zeroCopyCopied_(0)
+{
+}
+
+OutputQueue::~OutputQueue() = default;
+
+void OutputQueue::append(Buffer&& buf, bool zerocopy)
+{
+  if (buf.readableBytes() > 0)
+  {
+    bytes_ += buf.readableBytes();
+    chunks_.emplace_back(std::move(buf), zerocopy);
+  }
+}
+
+void OutputQueue::append(const char* data, size_t len)
+{
+  if (len > 0)
+  {
+    if (chunks_.empty() || !chunks_.back().chained)
+    {
+      chunks_.emplace_back();
+    }
+    chunks_.back().chain.append(data, len);
+    bytes_ += len;
+  }
+}
+
+void OutputQueue::append(const std::shared_ptr<const string>& data, size_t offset,
+                         bool zerocopy)
+{
+  assert(offset <= data->size());
+  if (offset < data->size())
+  {
+    bytes_ += data->size() - offset;
+    chunks_.emplace_back(data, offset, zerocopy);
+  }
+}
+
+void OutputQueue::appendFile(int fd, off_t offset, size_t length)
+{
+  if (length > 0)
+  {
+    bytes_ += length;
+    chunks_.emplace_back(fd, offset, length);
+  }
+  else
+  {
+    sockets::close(fd);
+  }
+}
+
+ssize_t OutputQueue::writeFd(int fd, Buffer* tail, int* savedErrno)
+{
+  if (!chunks_.empty() && chunks_.front().isFile())
+  {
+    return writeFile(fd, savedErrno);
+  }
+  if (!chunks_.empty() && chunks_.front().zerocopy)
+  {
+    return writeZeroCopy(fd, savedErrno);
+  }
+  if (chunks_.empty())
+  {
+    const ssize_t n = sockets::write(fd, tail->peek(), tail->readableBytes());
+    if (n < 0)
+    {
+      *savedErrno = errno;
+    }
+    else
+    {
+      tail->retrieve(n);
+    }
+    return n;
+  }
+
+  struct iovec vec[kMaxIovec];
+  int iovcnt = 0;
+  bool gathered = true;
+  for (const Chunk& chunk : chunks_)
+  {
+    if (iovcnt == kMaxIovec || chunk.isFile() || chunk.zerocopy)
+    {
+      gathered = false;
+      break;
+    }
+    if (chunk.chained)
+    {
+      int n = chunk.chain.readableIovec(vec + iovcnt, kMaxIovec - iovcnt);
+      size_t bytes = 0;
+      for (int i = iovcnt; i < iovcnt + n; ++i)
+      {
+        bytes += vec[i].iov_len;
+      }
+      iovcnt += n;
+      if (bytes < chunk.size())
+      {
+        gathered = false;
+        break;
+      }
+      continue;
+    }
+    vec[iovcnt].iov_base = const_cast<char*>(chunk.data());
+    vec[iovcnt].iov_len = chunk.size();
+    ++iovcnt;
+  }
+  if (gathered && iovcnt < kMaxIovec && tail->readableBytes() > 0)
+  {
+    vec[iovcnt].iov_base = const_cast<char*>(tail->peek());
+    vec[iovcnt].iov_len = tail->readableBytes();
+    ++iovcnt;
+  }
+  const ssize_t n = sockets::writev(fd, vec, iovcnt);
+  if (n < 0)
+  {
+    *savedErrno = errno;
+  }
+  else
+  {
+    retrieve(n, tail);
+  }
+  return n;
+}
+
+void OutputQueue::retrieve(size_t len, Buffer* tail)
+{
+  while (len > 0 && !chunks_.empty())
+  {
+    Chunk& chunk = chunks_.front();
+    size_t n = std::min(len, chunk.size());
+    chunk.retrieve(n);
+    bytes_ -= n;
+    len -= n;
+    if (chunk.size() == 0)
+    {
+      chunks_.pop_front();
+    }
+  }
+  if (len > 0)
+  {
+    tail->retrieve(len);
+  }
+}
+
+ssize_t OutputQueue::writeFile(int sockfd, int* savedErrno)
+{
+  Chunk& chunk = chunks_.front();
+  off_t offset = chunk.fileOffset;
+  const ssize_t n = sockets::sendfile(sockfd, chunk.fd, &offset, chunk.fileBytes);
+  if (n < 0)
+  {
+    *savedErrno = errno;
+    if (errno != EWOULDBLOCK)
+    {
+      // won't do better next time, closes the file.
+      bytes_ -= chunk.fileBytes;
+      chunks_.pop_front();
+    }
+  }
+  else if (n == 0)
+  {
+    // the file is shorter than promised, nothing more will come,
+    // and what follows would be out of place, fails with EIO.
+    LOG_ERROR << "OutputQueue::writeFile file ended with "
+              << chunk.fileBytes << " bytes unsent";
+    bytes_ -= chunk.fileBytes;
+    chunks_.pop_front();
+    *savedErrno = EIO;
+    return -1;
+  }
+  else
+  {
+    chunk.retrieve(n);
+    bytes_ -= n;
+    if (chunk.size() == 0)
+    {
+      chunks_.pop_front();
+    }
+  }
+  return n;
+}
+
+ssize_t OutputQueue::writeZeroCopy(int sockfd, int* savedErrno)
+{
+  Chunk& chunk = chunks_.front();
+  ssize_t n = sockets::sendZeroCopy(sockfd, chunk.data(), chunk.size());
+  if (n >= 0)
+  {
+    chunk.pinned = true;
+    chunk.lastSeq = nextSeq_++;
+  }
+  else if (errno == ENOBUFS)
+  {
+    // too many sends not completed yet, copies this time
+    n = sockets::write(sockfd, chunk.data(), chunk.size());
+  }
+  if (n < 0)
+  {
+    *savedErrno = errno;
+    return n;
+  }
+  chunk.retrieve(n);
+  bytes_ -= n;
+  if (chunk.size() == 0)
+  {
+    if (chunk.pinned)
+    {
+      pinned_.emplace_back(chunk.lastSeq, std::move(chunk));
+    }
+    chunks_.pop_front();
+  }
+  return n;
+}
+
+void OutputQueue::dropUnwritten()
+{
+  if (!chunks_.empty() && chunks_.front().pinned)
+  {
+    Chunk& chunk = chunks_.front();
+    pinned_.emplace_back(chunk.lastSeq, std::move(chunk));
+  }
+  chunks_.clear();
+  bytes_ = 0;
+}
+
+void OutputQueue::completeZeroCopy(uint32_t lo, uint32_t hi, bool copied)
+{
+  if (copied)
+  {
+    zeroCopyCopied_ += hi - lo + 1;
+  }
+  // completions come in order on a stream socket, numbers wrap around
+  while (!pinned_.empty() && static_cast<int32_t>(pinned_.front().first - hi) <= 0)
+  {
+    pinned_.pop_front();
+  }
+}
@@ -0,0 +1,204 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_OUTPUTQUEUE_H
+#define MUDUO_NET_OUTPUTQUEUE_H
+
+#include "muduo/base/noncopyable.h"
+#include "muduo/base/Types.h"
+#include "muduo/net/Buffer.h"
+#include "muduo/net/ChainBuffer.h"
+
+#include <deque>
+#include <memory>
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// Data waiting to be written to a TcpConnection, in order.
+///
+/// Each chunk is either a Buffer moved in, a slice of a refcounted
+/// immutable string shared by many connections, or a range of a file,
+/// none is copied.  Bytes which must be copied, too many for the tail,
+/// go to a ChainBuffer chunk, which grows without moving them.
+/// Memory chunks are gathered with writev(2),
+/// files are sent with sendfile(2).
+/// A memory chunk appended with @c zerocopy is sent alone with MSG_ZEROCOPY
+/// and kept after written until the kernel reports it completed.
+/// The connection's output buffer is the tail of the queue,
+/// small messages are still appended there.
+///
+class OutputQueue : noncopyable
+{
+ public:
+  OutputQueue();
+  ~OutputQueue();
+
+  /// Bytes in queued chunks, not counting the tail.
+  size_t readableBytes() const
+  { return bytes_; }
+
+  bool empty() const
+  { return chunks_.empty(); }
+
+  size_t numChunks() const
+  { return chunks_.size(); }
+
+  void append(Buffer&& buf, bool zerocopy = false);
+  /// Copies @c data, into the last chunk if it is a ChainBuffer.
+  void append(const char* data, size_t len);
+  /// Bytes of @c data from @c offset on.
+  void append(const std::shared_ptr<const string>& data, size_t offset,
+              bool zerocopy = false);
+  /// @c length bytes of file @c fd from @c offset on,
+  /// takes the ownership of @c fd, which is closed when done.
+  void appendFile(int fd, off_t offset, size_t length);
+
+  /// Writes queued chunks and then @c tail with writev(2),
+  /// or the file chunk at the front with sendfile(2),
+  /// retrieves what was written from both.
+  /// A file chunk is dropped if sendfile(2) fails other than with EAGAIN,
+  /// or if the file ends early, which fails with EIO.
+  /// @return result of write(2), @c errno is saved
+  ssize_t writeFd(int fd, Buffer* tail, int* savedErrno);
+
+  /// Drops what is not written, for a closed connection, but pins
+  /// the front chunk if it was partly written with MSG_ZEROCOPY.
+  void dropUnwritten();
+
+  /// Releases chunks of MSG_ZEROCOPY sends numbered up to @c hi.
+  void completeZeroCopy(uint32_t lo, uint32_t hi, bool copied);
+
+  /// Written chunks waiting for MSG_ZEROCOPY completion.
+  size_t numPinned() const
+  { return pinned_.size(); }
+
+  /// MSG_ZEROCOPY sends which the kernel copied after all, eg. over loopback.
+  int64_t numZeroCopyCopied() const
+  { return zeroCopyCopied_; }
+
+ private:
+  struct Chunk : noncopyable
+  {
+    Chunk(Buffer&& buf, bool zc)
+      : buffer(std::move(buf)),
+        offset(0),
+        fd(-1),
+        fileOffset(0),
+        fileBytes(0),
+        zerocopy(zc),
+        pinned(false),
+        lastSeq(0),
+        chained(false)
+    {
+    }
+
+    Chunk(const std::shared_ptr<const string>& data, size_t off, bool zc)
+      : buffer(0, true),
+        shared(data),
+        offset(off),
+        fd(-1),
+        fileOffset(0),
+        fileBytes(0),
+        zerocopy(zc),
+        pinned(false),
+        lastSeq(0),
+        chained(false)
+    {
+    }
+
+    Chunk(int fileFd, off_t off, size_t length)
+      : buffer(0, true),
+        offset(0),
+        fd(fileFd),
+        fileOffset(off),
+        fileBytes(length),
+        zerocopy(false),
+        pinned(false),
+        lastSeq(0),
+        chained(false)
+    {
+    }
+
+    Chunk()
+      : buffer(0, true),
+        offset(0),
+        fd(-1),
+        fileOffset(0),
+        fileBytes(0),
+        zerocopy(false),
+        pinned(false),
+        lastSeq(0),
+        chained(true)
+    {
+    }
+
+    Chunk(Chunk&& rhs) noexcept;
+    ~Chunk();
+
+    bool isFile() const
+    { return fd >= 0; }
+
+    const char* data() const
+    {
+      assert(!isFile() && !chained);
+      return (shared ? shared->data() : buffer.peek()) + offset;
+    }
+
+    size_t size() const
+    {
+      if (isFile())
+      {
+        return fileBytes;
+      }
+      if (chained)
+      {
+        return chain.readableBytes();
+      }
+      return (shared ? shared->size() : buffer.readableBytes()) - offset;
+    }
+
+    void retrieve(size_t len);
+
+    Buffer buffer;
+    std::shared_ptr<const string> shared;
+    // of shared, or of buffer if zerocopy, which keeps its bytes until released
+    size_t offset;
+    int fd;
+    off_t fileOffset;
+    size_t fileBytes;
+    bool zerocopy;
+    // some bytes went with MSG_ZEROCOPY, the last send is numbered lastSeq
+    bool pinned;
+    uint32_t lastSeq;
+    // copied bytes are in chain, not buffer
+    bool chained;
+    ChainBuffer chain;
+  };
+
+  ssize_t writeFile(int sockfd, int* savedErrno);
+  ssize_t writeZeroCopy(int sockfd, int* savedErrno);
+  void retrieve(size_t len, Buffer* tail);
+
+  std::deque<Chunk> chunks_;
+  size_t bytes_;
+  // written MSG_ZEROCOPY chunks, by the number of their last send
+  std::deque<std::pair<uint32_t, Chunk>> pinned_;
+  uint32_t nextSeq_;
+  int64_t zeroCopyCopied_;
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_OUTPUTQUEUE_H
@@ -10,11 +10,16 @@
 
 #include "muduo/net/Channel.h"
 
+#include <assert.h>
+
+#include <algorithm>
+
 using namespace muduo;
 using namespace muduo::net;
 
 Poller::Poller(EventLoop* loop)
-    : ownerLoop_(loop)
+    : numChannels_(0),
+      ownerLoop_(loop)
 {
 }
 
@@ -23,6 +28,25 @@ Poller::~Poller() = default;
 bool Poller::hasChannel(Channel* channel) const
 {
     assertInLoopThread();
-    ChannelMap::const_iterator it = channels_.find(channel->fd());
-    return it != channels_.end() && it->second == channel;
+    return findChannel(channel->fd()) == channel;
+}
+
+void Poller::addChannel(Channel* channel)
+{
+    const size_t fd = implicit_cast<size_t>(channel->fd());
+    if (fd >= channels_.size())
+    {
+        channels_.resize(std::max(fd + 1, channels_.size() * 2));
+    }
+    assert(channels_[fd] == NULL);
+    channels_[fd] = channel;
+    ++numChannels_;
+}
+
+void Poller::eraseChannel(Channel* channel)
+{
+    const size_t fd = implicit_cast<size_t>(channel->fd());
+    assert(fd < channels_.size() && channels_[fd] == channel);
+    channels_[fd] = NULL;
+    --numChannels_;
 }
@@ -11,7 +11,6 @@
 #ifndef MUDUO_NET_POLLER_H
 #define MUDUO_NET_POLLER_H
 
-#include <map>
 #include <vector>
 
 #include "muduo/base/Timestamp.h"
@@ -49,6 +48,13 @@ namespace muduo
 
             virtual bool hasChannel(Channel* channel) const;
 
+            /// Whether Channel::enableEdgeTriggered() is honoured.
+            virtual bool supportsEdgeTriggered() const { return false; }
+
+            /// Channel updates that needed no system call, as they were
+            /// coalesced with others or changed nothing.  Thread safe.
+            virtual int64_t numSkippedUpdates() const { return 0; }
+
             static Poller* newDefaultPoller(EventLoop* loop);
 
             void assertInLoopThread() const
@@ -57,10 +63,20 @@ namespace muduo
             }
 
         protected:
-            typedef std::map<int, Channel*> ChannelMap;
-            ChannelMap channels_;
+            /// The channel of fd, NULL if none.
+            Channel* findChannel(int fd) const
+            {
+                return implicit_cast<size_t>(fd) < channels_.size() ? channels_[fd] : NULL;
+            }
+
+            void addChannel(Channel* channel);
+            void eraseChannel(Channel* channel);
+            size_t numChannels() const { return numChannels_; }
 
         private:
+            // indexed by fd, as fds are small integers, grown on demand
+            std::vector<Channel*> channels_;
+            size_t numChannels_;
             EventLoop* ownerLoop_;
         };
     } // namespace net
@@ -12,6 +12,7 @@
 #include "muduo/net/InetAddress.h"
 #include "muduo/net/SocketsOps.h"
 
+#include <linux/filter.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <stdio.h>  // snprintf
@@ -126,3 +127,64 @@ void Socket::setKeepAlive(bool on)
   // FIXME CHECK
 }
 
+bool Socket::setZeroCopy(bool on)
+{
+#ifdef SO_ZEROCOPY
+  int optval = on ? 1 : 0;
+  int ret = ::setsockopt(sockfd_, SOL_SOCKET, SO_ZEROCOPY,
+                         &optval, static_cast<socklen_t>(sizeof optval));
+  if (ret < 0 && on)
+  {
+    LOG_SYSERR << "SO_ZEROCOPY failed.";
+  }
+  return ret == 0;
+#else
+  if (on)
+  {
+    LOG_ERROR << "SO_ZEROCOPY is not supported.";
+  }
+  return !on;
+#endif
+}
+
+bool Socket::attachReusePortCpuFilter(int numSockets)
+{
+#ifdef SO_ATTACH_REUSEPORT_CBPF
+  struct sock_filter code[] = {
+    // A = raw_smp_processor_id()
+    { BPF_LD | BPF_W | BPF_ABS, 0, 0, static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU) },
+    // A = A % numSockets
+    { BPF_ALU | BPF_MOD | BPF_K, 0, 0, static_cast<uint32_t>(numSockets) },
+    // return A
+    { BPF_RET | BPF_A, 0, 0, 0 },
+  };
+  struct sock_fprog prog = { static_cast<unsigned short>(sizeof code / sizeof code[0]), code };
+  int ret = ::setsockopt(sockfd_, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF,
+                         &prog, static_cast<socklen_t>(sizeof prog));
+  if (ret < 0)
+  {
+    LOG_SYSERR << "SO_ATTACH_REUSEPORT_CBPF failed.";
+  }
+  return ret == 0;
+#else
+  (void)numSockets;
+  LOG_ERROR << "SO_ATTACH_REUSEPORT_CBPF is not supported.";
+  return false;
+#endif
+}
+
+int Socket::incomingCpu() const
+{
+#ifdef SO_INCOMING_CPU
+  int cpu = -1;
+  socklen_t len = static_cast<socklen_t>(sizeof cpu);
+  if (::getsockopt(sockfd_, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) < 0)
+  {
+    return -1;
+  }
+  return cpu;
+#else
+  return -1;
+#endif
+}
+
@@ -78,6 +78,24 @@ namespace muduo {
             ///
             void setKeepAlive(bool on);
 
+            ///
+            /// Enable/disable SO_ZEROCOPY, for sends with MSG_ZEROCOPY.
+            /// @return false if not supported
+            bool setZeroCopy(bool on);
+
+            ///
+            /// Attaches a classic BPF program to the SO_REUSEPORT group of
+            /// this socket, which picks the listening socket by the CPU that
+            /// received the connection, the (cpu % numSockets)-th one
+            /// in the order they listened.
+            /// @return false if not supported
+            bool attachReusePortCpuFilter(int numSockets);
+
+            ///
+            /// The CPU that last processed packets of this socket, SO_INCOMING_CPU.
+            /// @return -1 if not supported
+            int incomingCpu() const;
+
         private:
             const int sockfd_;
         };
@@ -14,7 +14,10 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <linux/errqueue.h>
+#include <netinet/in.h>
 #include <stdio.h>  // snprintf
+#include <sys/sendfile.h>
 #include <sys/socket.h>
 #include <sys/uio.h>  // readv
 #include <unistd.h>
@@ -125,7 +128,11 @@ int sockets::accept(int sockfd, struct sockaddr_in6* addr)
   if (connfd < 0)
   {
     int savedErrno = errno;
-    LOG_SYSERR << "Socket::accept";
+    // EAGAIN ends a batch of accepts, see Acceptor::handleRead()
+    if (savedErrno != EAGAIN)
+    {
+      LOG_SYSERR << "Socket::accept";
+    }
     switch (savedErrno)
     {
       case EAGAIN:
@@ -176,6 +183,54 @@ ssize_t sockets::write(int sockfd, const void *buf, size_t count)
   return ::write(sockfd, buf, count);
 }
 
+ssize_t sockets::writev(int sockfd, const struct iovec *iov, int iovcnt)
+{
+  return ::writev(sockfd, iov, iovcnt);
+}
+
+ssize_t sockets::sendfile(int sockfd, int fd, off_t* offset, size_t count)
+{
+  return ::sendfile(sockfd, fd, offset, count);
+}
+
+ssize_t sockets::sendZeroCopy(int sockfd, const void* buf, size_t count)
+{
+  return ::send(sockfd, buf, count, MSG_ZEROCOPY | MSG_DONTWAIT);
+}
+
+int sockets::readZeroCopyCompletion(int sockfd, uint32_t* lo, uint32_t* hi, bool* copied)
+{
+  while (true)
+  {
+    char control[128];
+    struct msghdr msg;
+    memZero(&msg, sizeof msg);
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof control;
+    if (::recvmsg(sockfd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+    {
+      return errno == EAGAIN ? 0 : -1;
+    }
+    for (struct cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm != NULL; cm = CMSG_NXTHDR(&msg, cm))
+    {
+      if ((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR)
+          || (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))
+      {
+        struct sock_extended_err err;
+        memcpy(&err, CMSG_DATA(cm), sizeof err);
+        if (err.ee_errno == 0 && err.ee_origin == SO_EE_ORIGIN_ZEROCOPY)
+        {
+          *lo = err.ee_info;
+          *hi = err.ee_data;
+          *copied = (err.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0;
+          return 1;
+        }
+      }
+    }
+    // not ours, eg. an ICMP error with IP_RECVERR, try the next one
+  }
+}
+
 void sockets::close(int sockfd)
 {
   if (::close(sockfd) < 0)
@@ -32,6 +32,15 @@ int  accept(int sockfd, struct sockaddr_in6* addr);
 ssize_t read(int sockfd, void *buf, size_t count);
 ssize_t readv(int sockfd, const struct iovec *iov, int iovcnt);
 ssize_t write(int sockfd, const void *buf, size_t count);
+ssize_t writev(int sockfd, const struct iovec *iov, int iovcnt);
+ssize_t sendfile(int sockfd, int fd, off_t* offset, size_t count);
+/// write(2) with MSG_ZEROCOPY, needs SO_ZEROCOPY on the socket.
+/// @c buf must stay unchanged until the send is reported completed.
+ssize_t sendZeroCopy(int sockfd, const void* buf, size_t count);
+/// Reads a MSG_ZEROCOPY notification from the error queue:
+/// sends numbered [*lo, *hi] are completed, *copied if the kernel copied them.
+/// @return 1 if one was read, 0 if none is pending, -1 on error.
+int readZeroCopyCompletion(int sockfd, uint32_t* lo, uint32_t* hi, bool* copied);
 void close(int sockfd);
 void shutdownWrite(int sockfd);
 
@@ -10,16 +10,138 @@
 
 #include "muduo/base/Logging.h"
 #include "muduo/base/WeakCallback.h"
+#include "muduo/net/BufferPool.h"
+#include "muduo/net/ChainBuffer.h"
 #include "muduo/net/Channel.h"
 #include "muduo/net/EventLoop.h"
+#include "muduo/net/OutputQueue.h"
 #include "muduo/net/Socket.h"
 #include "muduo/net/SocketsOps.h"
 
 #include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 using namespace muduo;
 using namespace muduo::net;
 
+namespace
+{
+    const size_t kMaxReadSizeHint = 65536;
+    // shared messages smaller than this are cheaper to copy.
+    const size_t kMinSharedBytes = 256;
+    // copied output beyond this, the largest buffer of the BufferPool,
+    // goes to a ChainBuffer rather than growing the output buffer.
+    const size_t kMaxOutputBufferBytes = 64 * 1024;
+
+    // an edge-triggered connection reads or writes at most this much
+    // before other connections have their turn
+    const size_t kEdgeTriggeredBudget = 256 * 1024;
+
+    // hands the storage of a grown and drained buffer back to the loop's BufferPool,
+    // keeping room for @c reserve bytes.
+    void releaseIfDrained(Buffer* buf, size_t reserve = 0)
+    {
+        if (buf->readableBytes() == 0
+            && buf->internalCapacity() >
+               BufferPool::roundUp(Buffer::kCheapPrepend + std::max(reserve, Buffer::kInitialSize)))
+        {
+            buf->shrink(reserve);
+        }
+    }
+
+    // follows a burst at once, calms down slowly.
+    size_t nextReadSizeHint(size_t hint, size_t n)
+    {
+        if (n >= hint)
+        {
+            return std::min(n, kMaxReadSizeHint);
+        }
+        return hint - (hint - n) / 4;
+    }
+
+    // a file descriptor on its way to the loop, closed unless taken,
+    // eg. if the loop quits before running the functor holding it.
+    class FileOwner : noncopyable
+    {
+    public:
+        explicit FileOwner(int fd) : fd_(fd) {}
+        ~FileOwner()
+        {
+            if (fd_ >= 0)
+            {
+                sockets::close(fd_);
+            }
+        }
+
+        int release()
+        {
+            int fd = fd_;
+            fd_ = -1;
+            return fd;
+        }
+
+    private:
+        int fd_;
+    };
+
+    // reads the MSG_ZEROCOPY completions waiting on @c sockfd,
+    // returns false if there was none.
+    bool drainZeroCopyCompletions(int sockfd, OutputQueue* queue)
+    {
+        uint32_t lo = 0;
+        uint32_t hi = 0;
+        bool copied = false;
+        bool read = false;
+        int ret = 0;
+        while ((ret = sockets::readZeroCopyCompletion(sockfd, &lo, &hi, &copied)) > 0)
+        {
+            read = true;
+            if (queue)
+            {
+                queue->completeZeroCopy(lo, hi, copied);
+            }
+        }
+        if (ret < 0)
+        {
+            LOG_SYSERR << "TcpConnection::readZeroCopyCompletions";
+        }
+        return read;
+    }
+
+    // output of a destroyed connection which the kernel may still send from,
+    // kept with the socket open, as its completions come on the socket.
+    struct PinnedOutput : noncopyable
+    {
+        PinnedOutput(int fd, std::unique_ptr<OutputQueue> q)
+            : sockfd(fd), queue(std::move(q)), delay(0.001)
+        {
+        }
+
+        ~PinnedOutput()
+        {
+            sockets::close(sockfd);
+        }
+
+        int sockfd;
+        std::unique_ptr<OutputQueue> queue;
+        double delay;  // till the next check, doubles up to a second
+    };
+
+    void checkPinnedOutput(EventLoop* loop, const std::shared_ptr<PinnedOutput>& pinned)
+    {
+        drainZeroCopyCompletions(pinned->sockfd, get_pointer(pinned->queue));
+        if (pinned->queue->numPinned() > 0)
+        {
+            loop->runAfter(pinned->delay, std::bind(&checkPinnedOutput, loop, pinned));
+            pinned->delay = std::min(pinned->delay * 2, 1.0);
+        }
+    }
+} // namespace
+
 void muduo::net::defaultConnectionCallback(const TcpConnectionPtr& conn)
 {
     LOG_TRACE << conn->localAddress().toIpPort() << " -> "
@@ -39,16 +161,55 @@ TcpConnection::TcpConnection(EventLoop* loop,
                              const string& nameArg,
                              int sockfd,
                              const InetAddress& localAddr,
-                             const InetAddress& peerAddr)
+                             const InetAddress& peerAddr,
+                             bool lazyBuffers)
+    : TcpConnection(loop, nameArg, 0, std::shared_ptr<const string>(),
+                    sockfd, localAddr, peerAddr, lazyBuffers)
+{
+}
+
+TcpConnection::TcpConnection(EventLoop* loop,
+                             int64_t id,
+                             const std::shared_ptr<const string>& namePrefix,
+                             int sockfd,
+                             const InetAddress& localAddr,
+                             const InetAddress& peerAddr,
+                             bool lazyBuffers)
+    : TcpConnection(loop, string(), id, namePrefix,
+                    sockfd, localAddr, peerAddr, lazyBuffers)
+{
+}
+
+TcpConnection::TcpConnection(EventLoop* loop,
+                             const string& nameArg,
+                             int64_t id,
+                             const std::shared_ptr<const string>& namePrefix,
+                             int sockfd,
+                             const InetAddress& localAddr,
+                             const InetAddress& peerAddr,
+                             bool lazyBuffers)
     : loop_(CHECK_NOTNULL(loop)),
+      id_(id),
+      namePrefix_(namePrefix),
       name_(nameArg),
       state_(kConnecting),
       reading_(true),
+      autoCork_(false),
+      corkScheduled_(false),
+      edgeTriggered_(false),
+      writeWaiting_(false),
+      socketFull_(false),
+      readScheduled_(false),
+      writeScheduled_(false),
       socket_(new Socket(sockfd)),
       channel_(new Channel(loop, sockfd)),
       localAddr_(localAddr),
       peerAddr_(peerAddr),
-      highWaterMark_(64 * 1024 * 1024)
+      highWaterMark_(64 * 1024 * 1024),
+      zeroCopyThreshold_(0),
+      readSizeHint_(0),
+      inputBuffer_(Buffer::kInitialSize, lazyBuffers),
+      outputBuffer_(Buffer::kInitialSize, lazyBuffers)
 {
     channel_->setReadCallback(
         std::bind(&TcpConnection::handleRead, this, _1));
@@ -58,19 +219,50 @@ TcpConnection::TcpConnection(EventLoop* loop,
         std::bind(&TcpConnection::handleClose, this));
     channel_->setErrorCallback(
         std::bind(&TcpConnection::handleError, this));
-    LOG_DEBUG << "TcpConnection::ctor[" << name_ << "] at " << this
+    LOG_DEBUG << "TcpConnection::ctor[" << name() << "] at " << this
             << " fd=" << sockfd;
     socket_->setKeepAlive(true);
+    // counted from now on, for choosing the least loaded loop
+    loop_->addConnections(1);
 }
 
 TcpConnection::~TcpConnection()
 {
-    LOG_DEBUG << "TcpConnection::dtor[" << name_ << "] at " << this
+    LOG_DEBUG << "TcpConnection::dtor[" << name() << "] at " << this
             << " fd=" << channel_->fd()
             << " state=" << stateToString();
     assert(state_ == kDisconnected);
 }
 
+void TcpConnection::setChainMessageCallback(const ChainMessageCallback& cb)
+{
+    chainMessageCallback_ = cb;
+    if (cb && !inputChain_)
+    {
+        inputChain_.reset(new ChainBuffer);
+    }
+    else if (!cb)
+    {
+        inputChain_.reset();
+    }
+}
+
+const string& TcpConnection::name() const
+{
+    if (namePrefix_)
+    {
+        std::call_once(nameFormatted_, &TcpConnection::formatName, this);
+    }
+    return name_;
+}
+
+void TcpConnection::formatName() const
+{
+    char buf[32];
+    snprintf(buf, sizeof buf, "%" PRId64, id_);
+    name_ = *namePrefix_ + buf;
+}
+
 bool TcpConnection::getTcpInfo(struct tcp_info* tcpi) const
 {
     return socket_->getTcpInfo(tcpi);
@@ -84,6 +276,11 @@ string TcpConnection::getTcpInfoString() const
     return buf;
 }
 
+int TcpConnection::incomingCpu() const
+{
+    return socket_->incomingCpu();
+}
+
 void TcpConnection::send(const void* data, int len)
 {
     send(StringPiece(static_cast<const char*>(data), len));
@@ -109,7 +306,42 @@ void TcpConnection::send(const StringPiece& message)
     }
 }
 
-// FIXME efficiency!!!
+void TcpConnection::send(string&& message)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendStringInLoop(message);
+        }
+        else
+        {
+            loop_->runInLoop(
+                std::bind(&TcpConnection::sendStringInLoop,
+                          this, // FIXME
+                          std::move(message)));
+        }
+    }
+}
+
+void TcpConnection::send(Buffer&& message)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendBufferInLoop(message);
+        }
+        else
+        {
+            loop_->runInLoop(
+                std::bind(&TcpConnection::sendBufferInLoop,
+                          this, // FIXME
+                          std::move(message)));
+        }
+    }
+}
+
 void TcpConnection::send(Buffer* buf)
 {
     if (state_ == kConnected)
@@ -121,12 +353,8 @@ void TcpConnection::send(Buffer* buf)
         }
         else
         {
-            void (TcpConnection::*fp)(const StringPiece& message) = &TcpConnection::sendInLoop;
-            loop_->runInLoop(
-                std::bind(fp,
-                          this, // FIXME
-                          buf->retrieveAllAsString()));
-            //std::forward<string>(message)));
+            // the storage goes with the message, buf allocates anew when reused.
+            send(std::move(*buf));
         }
     }
 }
@@ -139,58 +367,401 @@ void TcpConnection::sendInLoop(const StringPiece& message)
 void TcpConnection::sendInLoop(const void* data, size_t len)
 {
     loop_->assertInLoopThread();
-    ssize_t nwrote = 0;
-    size_t remaining = len;
-    bool faultError = false;
+    size_t nwrote = 0;
+    if (state_ == kDisconnected)
+    {
+        LOG_WARN << "disconnected, give up writing";
+        return;
+    }
+    if (!writeDirectly(data, len, &nwrote))
+    {
+        return;
+    }
+
+    assert(nwrote <= len);
+    size_t remaining = len - nwrote;
+    if (remaining > 0)
+    {
+        queueForWriting(remaining);
+        const char* rest = static_cast<const char*>(data) + nwrote;
+        if (outputBuffer_.readableBytes() + remaining > kMaxOutputBufferBytes)
+        {
+            queueBehindBuffer()->append(rest, remaining);
+        }
+        else
+        {
+            outputBuffer_.append(rest, remaining);
+        }
+    }
+}
+
+void TcpConnection::sendStringInLoop(string& message)
+{
+    if (message.size() < kMinSharedBytes)
+    {
+        sendInLoop(message.data(), message.size());
+        return;
+    }
+    loop_->assertInLoopThread();
+    size_t nwrote = 0;
     if (state_ == kDisconnected)
     {
         LOG_WARN << "disconnected, give up writing";
         return;
     }
+    if (useZeroCopy(message.size()))
+    {
+        queueForWriting(message.size());
+        queueBehindBuffer()->append(std::make_shared<const string>(std::move(message)), 0, true);
+        return;
+    }
+    if (!writeDirectly(message.data(), message.size(), &nwrote))
+    {
+        return;
+    }
+
+    size_t remaining = message.size() - nwrote;
+    if (remaining > 0)
+    {
+        queueForWriting(remaining);
+        // moves the bytes, only the refcount is allocated
+        queueBehindBuffer()->append(std::make_shared<const string>(std::move(message)), nwrote);
+    }
+}
+
+void TcpConnection::sendBufferInLoop(Buffer& message)
+{
+    if (message.readableBytes() < kMinSharedBytes)
+    {
+        sendInLoop(message.peek(), message.readableBytes());
+        message.retrieveAll();
+        return;
+    }
+    loop_->assertInLoopThread();
+    size_t nwrote = 0;
+    if (state_ == kDisconnected)
+    {
+        LOG_WARN << "disconnected, give up writing";
+        return;
+    }
+    if (useZeroCopy(message.readableBytes()))
+    {
+        queueForWriting(message.readableBytes());
+        queueBehindBuffer()->append(std::move(message), true);
+        return;
+    }
+    if (!writeDirectly(message.peek(), message.readableBytes(), &nwrote))
+    {
+        return;
+    }
+
+    message.retrieve(nwrote);
+    if (message.readableBytes() > 0)
+    {
+        queueForWriting(message.readableBytes());
+        queueBehindBuffer()->append(std::move(message));
+    }
+}
+
+void TcpConnection::send(const std::shared_ptr<const string>& message)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendSharedInLoop(message);
+        }
+        else
+        {
+            loop_->runInLoop(
+                std::bind(&TcpConnection::sendSharedInLoop,
+                          this, // FIXME
+                          message));
+        }
+    }
+}
+
+void TcpConnection::sendSharedInLoop(const std::shared_ptr<const string>& message)
+{
+    if (message->size() < kMinSharedBytes)
+    {
+        sendInLoop(message->data(), message->size());
+        return;
+    }
+    loop_->assertInLoopThread();
+    size_t nwrote = 0;
+    if (state_ == kDisconnected)
+    {
+        LOG_WARN << "disconnected, give up writing";
+        return;
+    }
+    if (useZeroCopy(message->size()))
+    {
+        queueForWriting(message->size());
+        queueBehindBuffer()->append(message, 0, true);
+        return;
+    }
+    if (!writeDirectly(message->data(), message->size(), &nwrote))
+    {
+        return;
+    }
+
+    size_t remaining = message->size() - nwrote;
+    if (remaining > 0)
+    {
+        queueForWriting(remaining);
+        queueBehindBuffer()->append(message, nwrote);
+    }
+}
+
+void TcpConnection::sendFile(int fd, off_t offset, size_t length)
+{
+    if (state_ == kConnected)
+    {
+        int dupfd = ::dup(fd);
+        if (dupfd < 0)
+        {
+            LOG_SYSERR << "TcpConnection::sendFile";
+            return;
+        }
+        std::shared_ptr<FileOwner> file(std::make_shared<FileOwner>(dupfd));
+        TcpConnectionPtr self(shared_from_this());
+        loop_->runInLoop([self, file, offset, length] {
+            self->sendFileInLoop(file->release(), offset, length);
+        });
+    }
+}
+
+void TcpConnection::sendFileInLoop(int fd, off_t offset, size_t length)
+{
+    loop_->assertInLoopThread();
+    if (state_ == kDisconnected)
+    {
+        LOG_WARN << "disconnected, give up writing";
+        sockets::close(fd);
+        return;
+    }
+    size_t nwrote = 0;
+    if (!autoCork_ && !isWaitingToWrite() && bytesToWrite() == 0)
+    {
+        off_t off = offset;
+        ssize_t n = sockets::sendfile(channel_->fd(), fd, &off, length);
+        int savedErrno = errno;
+        if (n >= 0 && implicit_cast<size_t>(n) == length)
+        {
+            sockets::close(fd);
+            if (writeCompleteCallback_)
+            {
+                loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+            }
+            return;
+        }
+        else if (n > 0)
+        {
+            nwrote = n;
+            // short, the socket may be full or the file may end,
+            // the queued rest is tried again, rather than waiting for EPOLLOUT.
+            socketFull_ = false;
+        }
+        else if (n == 0)
+        {
+            // the file ends before offset, the peer won't get what it expects,
+            // nor what is sent before the connection is closed.
+            LOG_ERROR << "TcpConnection::sendFileInLoop file ended with "
+                      << length << " bytes unsent";
+            sockets::close(fd);
+            socket_->shutdownWrite();
+            forceClose();
+            return;
+        }
+        else if (savedErrno == EWOULDBLOCK)
+        {
+            socketFull_ = true;
+        }
+        else
+        {
+            errno = savedErrno;
+            LOG_SYSERR << "TcpConnection::sendFileInLoop";
+            sockets::close(fd);
+            // the file can't be read, eg. a pipe or write-only,
+            // the peer won't get what comes after it as expected.
+            if (savedErrno != EPIPE && savedErrno != ECONNRESET)
+            {
+                forceClose();
+            }
+            return;
+        }
+    }
+
+    size_t remaining = length - nwrote;
+    queueForWriting(remaining);
+    queueBehindBuffer()->appendFile(fd, offset + static_cast<off_t>(nwrote), remaining);
+}
+
+bool TcpConnection::writeDirectly(const void* data, size_t len, size_t* nwrote)
+{
+    *nwrote = 0;
     // if no thing in output queue, try writing directly
-    if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0)
+    if (!autoCork_ && !isWaitingToWrite() && bytesToWrite() == 0)
     {
-        nwrote = sockets::write(channel_->fd(), data, len);
-        if (nwrote >= 0)
+        ssize_t n = sockets::write(channel_->fd(), data, len);
+        if (n >= 0)
         {
-            remaining = len - nwrote;
-            if (remaining == 0 && writeCompleteCallback_)
+            *nwrote = n;
+            if (*nwrote == len && writeCompleteCallback_)
             {
                 loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
             }
+            // a short write to a stream socket fills it up, as EAGAIN
+            socketFull_ = *nwrote < len;
         }
-        else // nwrote < 0
+        else // n < 0
         {
-            nwrote = 0;
-            if (errno != EWOULDBLOCK)
+            if (errno == EWOULDBLOCK)
+            {
+                socketFull_ = true;
+            }
+            else
             {
                 LOG_SYSERR << "TcpConnection::sendInLoop";
                 if (errno == EPIPE || errno == ECONNRESET) // FIXME: any others?
                 {
-                    faultError = true;
+                    return false;
                 }
             }
         }
     }
+    return true;
+}
 
-    assert(remaining <= len);
-    if (!faultError && remaining > 0)
+OutputQueue* TcpConnection::queueBehindBuffer()
+{
+    if (!outputQueue_)
+    {
+        outputQueue_.reset(new OutputQueue);
+    }
+    // what's in the tail goes first, it's written after all chunks
+    outputQueue_->append(std::move(outputBuffer_));
+    return get_pointer(outputQueue_);
+}
+
+void TcpConnection::queueForWriting(size_t len)
+{
+    size_t oldLen = bytesToWrite();
+    if (oldLen + len >= highWaterMark_
+        && oldLen < highWaterMark_
+        && highWaterMarkCallback_)
     {
-        size_t oldLen = outputBuffer_.readableBytes();
-        if (oldLen + remaining >= highWaterMark_
-            && oldLen < highWaterMark_
-            && highWaterMarkCallback_)
+        loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + len));
+    }
+    if (autoCork_ && !isWaitingToWrite())
+    {
+        if (!corkScheduled_)
         {
-            loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
+            corkScheduled_ = true;
+            loop_->runAfterIteration(std::bind(&TcpConnection::flushCorked, shared_from_this()));
         }
-        outputBuffer_.append(static_cast<const char*>(data) + nwrote, remaining);
+    }
+    else
+    {
+        waitToWrite();
+    }
+}
+
+bool TcpConnection::isWaitingToWrite() const
+{
+    return edgeTriggered_ ? writeWaiting_ : channel_->isWriting();
+}
+
+void TcpConnection::waitToWrite()
+{
+    if (!edgeTriggered_)
+    {
         if (!channel_->isWriting())
         {
             channel_->enableWriting();
         }
+        return;
+    }
+    writeWaiting_ = true;
+    // no EPOLLOUT is coming unless a write has got EAGAIN
+    if (!socketFull_)
+    {
+        scheduleWrite();
+    }
+}
+
+void TcpConnection::stopWaitingToWrite()
+{
+    if (edgeTriggered_)
+    {
+        writeWaiting_ = false;
+    }
+    else if (channel_->isWriting())
+    {
+        channel_->disableWriting();
+    }
+}
+
+void TcpConnection::scheduleRead(Timestamp receiveTime)
+{
+    if (!readScheduled_)
+    {
+        readScheduled_ = true;
+        loop_->queueInLoop(std::bind(&TcpConnection::resumeRead, shared_from_this(), receiveTime));
+    }
+}
+
+void TcpConnection::resumeRead(Timestamp receiveTime)
+{
+    readScheduled_ = false;
+    if (state_ != kDisconnected && channel_->isReading())
+    {
+        handleRead(receiveTime);
+    }
+}
+
+void TcpConnection::scheduleWrite()
+{
+    if (!writeScheduled_)
+    {
+        writeScheduled_ = true;
+        loop_->queueInLoop(std::bind(&TcpConnection::resumeWrite, shared_from_this()));
+    }
+}
+
+void TcpConnection::resumeWrite()
+{
+    writeScheduled_ = false;
+    if (state_ != kDisconnected && writeWaiting_ && !socketFull_)
+    {
+        writeOutput();
+    }
+}
+
+void TcpConnection::flushCorked()
+{
+    loop_->assertInLoopThread();
+    corkScheduled_ = false;
+    if (state_ == kDisconnected || isWaitingToWrite())
+    {
+        return;
+    }
+    if (bytesToWrite() > 0)
+    {
+        writeOutput();
+    }
+    else if (state_ == kDisconnecting)
+    {
+        shutdownInLoop();
     }
 }
 
+size_t TcpConnection::bytesToWrite() const
+{
+    return outputBuffer_.readableBytes() + (outputQueue_ ? outputQueue_->readableBytes() : 0);
+}
+
 void TcpConnection::shutdown()
 {
     // FIXME: use compare and swap
@@ -205,7 +776,7 @@ void TcpConnection::shutdown()
 void TcpConnection::shutdownInLoop()
 {
     loop_->assertInLoopThread();
-    if (!channel_->isWriting())
+    if (!isWaitingToWrite() && !corkScheduled_)
     {
         // we are not writing
         socket_->shutdownWrite();
@@ -290,6 +861,17 @@ void TcpConnection::setTcpNoDelay(bool on)
     socket_->setTcpNoDelay(on);
 }
 
+void TcpConnection::setZeroCopyThreshold(size_t bytes)
+{
+    if (bytes > 0 && zeroCopyThreshold_ == 0 && !socket_->setZeroCopy(true))
+    {
+        LOG_WARN << "TcpConnection::setZeroCopyThreshold [" << name()
+                 << "] - sends are copied";
+        return;
+    }
+    zeroCopyThreshold_ = bytes;
+}
+
 void TcpConnection::startRead()
 {
     loop_->runInLoop(std::bind(&TcpConnection::startReadInLoop, this));
@@ -302,6 +884,12 @@ void TcpConnection::startReadInLoop()
     {
         channel_->enableReading();
         reading_ = true;
+        // edge-triggered, data left since reading stopped brings no new edge,
+        // nor does the Poller re-arm the fd if stopped in this iteration too.
+        if (edgeTriggered_)
+        {
+            scheduleRead(loop_->pollReturnTime());
+        }
     }
 }
 
@@ -326,7 +914,20 @@ void TcpConnection::connectEstablished()
     assert(state_ == kConnecting);
     setState(kConnected);
     channel_->tie(shared_from_this());
-    channel_->enableReading();
+    if (edgeTriggered_ && !loop_->supportsEdgeTriggered())
+    {
+        LOG_DEBUG << "TcpConnection::connectEstablished [" << name()
+                  << "] - level-triggered, not supported by the Poller";
+        edgeTriggered_ = false;
+    }
+    if (edgeTriggered_)
+    {
+        channel_->enableEdgeTriggered();
+    }
+    else
+    {
+        channel_->enableReading();
+    }
 
     connectionCallback_(shared_from_this());
 }
@@ -342,43 +943,116 @@ void TcpConnection::connectDestroyed()
         connectionCallback_(shared_from_this());
     }
     channel_->remove();
+    if (outputQueue_)
+    {
+        outputQueue_->dropUnwritten();
+        if (outputQueue_->numPinned() > 0)
+        {
+            keepPinnedOutput();
+        }
+    }
+    loop_->addConnections(-1);
 }
 
 void TcpConnection::handleRead(Timestamp receiveTime)
 {
     loop_->assertInLoopThread();
-    int savedErrno = 0;
-    ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
-    if (n > 0)
+    // level-triggered reads once, the Poller tells if there is more.
+    // edge-triggered reads until EAGAIN.
+    size_t total = 0;
+    for (;;)
     {
-        messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+        int savedErrno = 0;
+        ssize_t n = inputChain_
+                    ? inputChain_->readFd(channel_->fd(), &savedErrno)
+                    : inputBuffer_.readFd(channel_->fd(), &savedErrno, readSizeHint_);
+        if (n > 0)
+        {
+            if (inputChain_)
+            {
+                chainMessageCallback_(shared_from_this(), get_pointer(inputChain_), receiveTime);
+            }
+            else
+            {
+                readSizeHint_ = nextReadSizeHint(readSizeHint_, n);
+                messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+                releaseIfDrained(&inputBuffer_, readSizeHint_);
+            }
+            total += n;
+            if (!edgeTriggered_ || state_ == kDisconnected || !channel_->isReading())
+            {
+                break;
+            }
+            if (total >= kEdgeTriggeredBudget)
+            {
+                scheduleRead(receiveTime);
+                break;
+            }
+        }
+        else if (n == 0)
+        {
+            handleClose();
+            break;
+        }
+        else
+        {
+            if (!edgeTriggered_ || savedErrno != EWOULDBLOCK)
+            {
+                errno = savedErrno;
+                LOG_SYSERR << "TcpConnection::handleRead";
+                handleError();
+            }
+            break;
+        }
     }
-    else if (n == 0)
+}
+
+void TcpConnection::handleWrite()
+{
+    loop_->assertInLoopThread();
+    socketFull_ = false;
+    if (isWaitingToWrite())
     {
-        handleClose();
+        writeOutput();
     }
     else
     {
-        errno = savedErrno;
-        LOG_SYSERR << "TcpConnection::handleRead";
-        handleError();
+        LOG_TRACE << "Connection fd = " << channel_->fd()
+              << " is down, no more writing";
     }
 }
 
-void TcpConnection::handleWrite()
+void TcpConnection::writeOutput()
 {
-    loop_->assertInLoopThread();
-    if (channel_->isWriting())
+    // level-triggered writes once, edge-triggered until EAGAIN
+    size_t total = 0;
+    for (;;)
     {
-        ssize_t n = sockets::write(channel_->fd(),
-                                   outputBuffer_.peek(),
-                                   outputBuffer_.readableBytes());
-        if (n > 0)
+        int savedErrno = 0;
+        ssize_t n = 0;
+        if (outputQueue_ && !outputQueue_->empty())
+        {
+            n = outputQueue_->writeFd(channel_->fd(), &outputBuffer_, &savedErrno);
+        }
+        else
+        {
+            const size_t len = outputBuffer_.readableBytes();
+            n = sockets::write(channel_->fd(), outputBuffer_.peek(), len);
+            savedErrno = errno;
+            if (n > 0)
+            {
+                outputBuffer_.retrieve(n);
+                // short, the socket is full as if EAGAIN
+                socketFull_ = implicit_cast<size_t>(n) < len;
+            }
+        }
+        if (n >= 0)
         {
-            outputBuffer_.retrieve(n);
-            if (outputBuffer_.readableBytes() == 0)
+            total += n;
+            if (bytesToWrite() == 0)
             {
-                channel_->disableWriting();
+                releaseIfDrained(&outputBuffer_);
+                stopWaitingToWrite();
                 if (writeCompleteCallback_)
                 {
                     loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
@@ -387,22 +1061,37 @@ void TcpConnection::handleWrite()
                 {
                     shutdownInLoop();
                 }
+                break;
             }
+            if (!edgeTriggered_ || n == 0 || socketFull_)
+            {
+                waitToWrite();
+                break;
+            }
+            if (total >= kEdgeTriggeredBudget)
+            {
+                writeWaiting_ = true;
+                scheduleWrite();
+                break;
+            }
+        }
+        else if (savedErrno == EWOULDBLOCK)
+        {
+            socketFull_ = true;
+            waitToWrite();
+            break;
         }
         else
         {
+            errno = savedErrno;
             LOG_SYSERR << "TcpConnection::handleWrite";
-            // if (state_ == kDisconnecting)
-            // {
-            //   shutdownInLoop();
-            // }
+            // nothing more can be written in order, or the socket has failed,
+            // don't wait for a writable socket again and again.
+            stopWaitingToWrite();
+            forceClose();
+            break;
         }
     }
-    else
-    {
-        LOG_TRACE << "Connection fd = " << channel_->fd()
-              << " is down, no more writing";
-    }
 }
 
 void TcpConnection::handleClose()
@@ -422,7 +1111,34 @@ void TcpConnection::handleClose()
 
 void TcpConnection::handleError()
 {
+    // completions of MSG_ZEROCOPY sends are reported as errors
+    if (zeroCopyThreshold_ > 0 && readZeroCopyCompletions())
+    {
+        return;
+    }
     int err = sockets::getSocketError(channel_->fd());
-    LOG_ERROR << "TcpConnection::handleError [" << name_
+    LOG_ERROR << "TcpConnection::handleError [" << name()
         << "] - SO_ERROR = " << err << " " << strerror_tl(err);
 }
+
+bool TcpConnection::readZeroCopyCompletions()
+{
+    return drainZeroCopyCompletions(channel_->fd(), get_pointer(outputQueue_));
+}
+
+void TcpConnection::keepPinnedOutput()
+{
+    // the pages must not be reused before the kernel is done with them
+    int sockfd = ::fcntl(channel_->fd(), F_DUPFD_CLOEXEC, 0);
+    if (sockfd < 0)
+    {
+        LOG_SYSERR << "TcpConnection::keepPinnedOutput";
+        // leaks it, rather than handing it out again
+        outputQueue_.release();
+        return;
+    }
+    // the peer gets EOF after what was sent, as if the socket was closed,
+    // no error if it's gone already.
+    ::shutdown(sockfd, SHUT_WR);
+    checkPinnedOutput(loop_, std::make_shared<PinnedOutput>(sockfd, std::move(outputQueue_)));
+}
@@ -19,6 +19,7 @@
 #include "muduo/net/InetAddress.h"
 
 #include <memory>
+#include <mutex>
 
 #include <boost/any.hpp>
 
@@ -29,8 +30,10 @@ namespace muduo
 {
     namespace net
     {
+        class ChainBuffer;
         class Channel;
         class EventLoop;
+        class OutputQueue;
         class Socket;
 
         ///
@@ -44,15 +47,28 @@ namespace muduo
             /// Constructs a TcpConnection with a connected sockfd
             ///
             /// User should not create this object.
+            /// With @c lazyBuffers, input and output buffers only hold
+            /// storage while they have data, see Buffer.
             TcpConnection(EventLoop* loop,
                           const string& name,
                           int sockfd,
                           const InetAddress& localAddr,
-                          const InetAddress& peerAddr);
+                          const InetAddress& peerAddr,
+                          bool lazyBuffers = false);
+            /// Named @c namePrefix followed by @c id, formatted on first use of name().
+            TcpConnection(EventLoop* loop,
+                          int64_t id,
+                          const std::shared_ptr<const string>& namePrefix,
+                          int sockfd,
+                          const InetAddress& localAddr,
+                          const InetAddress& peerAddr,
+                          bool lazyBuffers = false);
             ~TcpConnection();
 
             EventLoop* getLoop() const { return loop_; }
-            const string& name() const { return name_; }
+            /// Positive if given by a TcpServer, unique among its connections.
+            int64_t id() const { return id_; }
+            const string& name() const;
             const InetAddress& localAddress() const { return localAddr_; }
             const InetAddress& peerAddress() const { return peerAddr_; }
             bool connected() const { return state_ == kConnected; }
@@ -60,17 +76,40 @@ namespace muduo
             // return true if success.
             bool getTcpInfo(struct tcp_info*) const;
             string getTcpInfoString() const;
+            /// The CPU that last processed packets of this connection,
+            /// -1 if unknown.
+            int incomingCpu() const;
 
-            // void send(string&& message); // C++11
             void send(const void* message, int len);
             void send(const StringPiece& message);
-            // void send(Buffer&& message); // C++11
+            void send(const char* message) { send(StringPiece(message)); } // not ambiguous with string&&
+            // takes the message over, no copy even from other threads.
+            void send(string&& message);
+            void send(Buffer&& message);
             void send(Buffer* message); // this one will swap data
+            // the bytes are queued by reference, not copied, so one large
+            // body can go to many connections. Must not be modified after.
+            void send(const std::shared_ptr<const string>& message);
+            // sends @c length bytes of file @c fd from @c offset on with sendfile(2),
+            // in order with other sends. @c fd is dup()ed, caller may close it on return.
+            void sendFile(int fd, off_t offset, size_t length);
             void shutdown(); // NOT thread safe, no simultaneous calling
             // void shutdownAndForceCloseAfter(double seconds); // NOT thread safe, no simultaneous calling
             void forceClose();
             void forceCloseWithDelay(double seconds);
             void setTcpNoDelay(bool on);
+            // sends are not written right away but once at the end of
+            // the loop iteration, one write(2) for pipelined responses.
+            void setAutoCork(bool on) { autoCork_ = on; } // NOT thread safe
+            // the socket is registered once for both directions, edge-triggered,
+            // reads and writes go on until EAGAIN, yielding to other connections
+            // every kEdgeTriggeredBudget bytes. Level-triggered if the Poller can't.
+            // Must be called before connectEstablished()
+            void setEdgeTriggered(bool on) { edgeTriggered_ = on; }
+            // messages of at least @c bytes passed by shared_ptr, string&& or Buffer&&
+            // are sent with MSG_ZEROCOPY, and kept until the kernel is done with them.
+            // 0 turns it off. NOT thread safe
+            void setZeroCopyThreshold(size_t bytes);
             // reading or not
             void startRead();
             void stopRead();
@@ -101,6 +140,12 @@ namespace muduo
                 messageCallback_ = cb;
             }
 
+            /// Reads into a ChainBuffer instead of inputBuffer(), and calls
+            /// @c cb instead of the message callback.  For large messages,
+            /// which the ChainBuffer holds without moving or reallocating.
+            /// Set before connectEstablished().
+            void setChainMessageCallback(const ChainMessageCallback& cb);
+
             void setWriteCompleteCallback(const WriteCompleteCallback& cb)
             {
                 writeCompleteCallback_ = cb;
@@ -118,11 +163,16 @@ namespace muduo
                 return &inputBuffer_;
             }
 
+            /// Tail of the output queue, what's appended here is
+            /// written after everything sent before.
             Buffer* outputBuffer()
             {
                 return &outputBuffer_;
             }
 
+            /// Bytes sent but not written to the socket yet.
+            size_t bytesToWrite() const;
+
             /// Internal use only.
             void setCloseCallback(const CloseCallback& cb)
             {
@@ -137,13 +187,50 @@ namespace muduo
         private:
             enum StateE { kDisconnected, kConnecting, kConnected, kDisconnecting };
 
+            TcpConnection(EventLoop* loop,
+                          const string& name,
+                          int64_t id,
+                          const std::shared_ptr<const string>& namePrefix,
+                          int sockfd,
+                          const InetAddress& localAddr,
+                          const InetAddress& peerAddr,
+                          bool lazyBuffers);
+            void formatName() const;
+
             void handleRead(Timestamp receiveTime);
             void handleWrite();
+            // writes what's queued, drained or not
+            void writeOutput();
+            void flushCorked();
+            // output is waiting for the socket to become writable
+            bool isWaitingToWrite() const;
+            void waitToWrite();
+            void stopWaitingToWrite();
+            // edge-triggered, continues after other connections had their turn
+            void scheduleRead(Timestamp receiveTime);
+            void resumeRead(Timestamp receiveTime);
+            void scheduleWrite();
+            void resumeWrite();
+            bool useZeroCopy(size_t len) const
+            { return zeroCopyThreshold_ > 0 && len >= zeroCopyThreshold_; }
+            // returns false if none was pending
+            bool readZeroCopyCompletions();
+            // after connectDestroyed(), until MSG_ZEROCOPY sends complete
+            void keepPinnedOutput();
             void handleClose();
             void handleError();
-            // void sendInLoop(string&& message);
             void sendInLoop(const StringPiece& message);
             void sendInLoop(const void* message, size_t len);
+            void sendStringInLoop(string& message);
+            void sendBufferInLoop(Buffer& message);
+            void sendSharedInLoop(const std::shared_ptr<const string>& message);
+            void sendFileInLoop(int fd, off_t offset, size_t length);
+            // writes right away if nothing is waiting, returns false on a fatal error.
+            bool writeDirectly(const void* data, size_t len, size_t* nwrote);
+            void queueForWriting(size_t len);
+            // the output queue, with outputBuffer_ moved in,
+            // so chunks appended next are written after it.
+            OutputQueue* queueBehindBuffer();
             void shutdownInLoop();
             // void shutdownAndForceCloseInLoop(double seconds);
             void forceCloseInLoop();
@@ -153,9 +240,23 @@ namespace muduo
             void stopReadInLoop();
 
             EventLoop* loop_;
-            const string name_;
+            const int64_t id_;
+            // with name_, formatted once, by the first thread asking for it
+            const std::shared_ptr<const string> namePrefix_;
+            mutable std::once_flag nameFormatted_;
+            mutable string name_;
             StateE state_; // FIXME: use atomic variable
             bool reading_;
+            bool autoCork_;
+            // a flush is scheduled for the end of this iteration
+            bool corkScheduled_;
+            bool edgeTriggered_;
+            // edge-triggered only, see isWaitingToWrite()
+            bool writeWaiting_;
+            // edge-triggered only, the last write got EAGAIN, EPOLLOUT will come
+            bool socketFull_;
+            bool readScheduled_;
+            bool writeScheduled_;
             // we don't expose those classes to client.
             std::unique_ptr<Socket> socket_;
             std::unique_ptr<Channel> channel_;
@@ -163,12 +264,20 @@ namespace muduo
             const InetAddress peerAddr_;
             ConnectionCallback connectionCallback_;
             MessageCallback messageCallback_;
+            ChainMessageCallback chainMessageCallback_;
             WriteCompleteCallback writeCompleteCallback_;
             HighWaterMarkCallback highWaterMarkCallback_;
             CloseCallback closeCallback_;
             size_t highWaterMark_;
+            size_t zeroCopyThreshold_;
+            // expected size of next read, adapts to recent reads
+            size_t readSizeHint_;
             Buffer inputBuffer_;
-            Buffer outputBuffer_; // FIXME: use list<Buffer> as output buffer.
+            // instead of inputBuffer_, with chainMessageCallback_
+            std::unique_ptr<ChainBuffer> inputChain_;
+            Buffer outputBuffer_;
+            // chunks to write before outputBuffer_, created on first use.
+            std::unique_ptr<OutputQueue> outputQueue_;
             boost::any context_;
             // FIXME: creationTime_, lastReceiveTime_
             //        bytesReceived_, bytesSent_
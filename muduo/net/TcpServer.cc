@@ -8,17 +8,45 @@
 
 #include "muduo/net/TcpServer.h"
 
+#include "muduo/base/CountDownLatch.h"
 #include "muduo/base/Logging.h"
 #include "muduo/net/Acceptor.h"
+#include "muduo/net/ConnectionTable.h"
 #include "muduo/net/EventLoop.h"
 #include "muduo/net/EventLoopThreadPool.h"
 #include "muduo/net/SocketsOps.h"
 
-#include <stdio.h>  // snprintf
+#include <algorithm>
 
 using namespace muduo;
 using namespace muduo::net;
 
+namespace
+{
+    void establishConnections(const std::vector<TcpConnectionPtr>& conns)
+    {
+        for (const TcpConnectionPtr& conn : conns)
+        {
+            conn->connectEstablished();
+        }
+    }
+
+    void destroyConnections(ConnectionTable* connections)
+    {
+        connections->forEach([](TcpConnectionPtr& item) {
+            TcpConnectionPtr conn(item);
+            item.reset();
+            conn->getLoop()->runInLoop(
+                std::bind(&TcpConnection::connectDestroyed, conn));
+        });
+    }
+
+    bool lessLoop(const TcpConnectionPtr& lhs, const TcpConnectionPtr& rhs)
+    {
+        return std::less<EventLoop*>()(lhs->getLoop(), rhs->getLoop());
+    }
+} // namespace
+
 TcpServer::TcpServer(EventLoop* loop,
                      const InetAddress& listenAddr,
                      const string& nameArg,
@@ -26,14 +54,23 @@ TcpServer::TcpServer(EventLoop* loop,
     : loop_(CHECK_NOTNULL(loop)),
       ipPort_(listenAddr.toIpPort()),
       name_(nameArg),
-      acceptor_(new Acceptor(loop, listenAddr, option == kReusePort)),
+      option_(option),
+      acceptor_(new Acceptor(loop, listenAddr, option != kNoReusePort)),
       threadPool_(new EventLoopThreadPool(loop, name_)),
       connectionCallback_(defaultConnectionCallback),
       messageCallback_(defaultMessageCallback),
-      nextConnId_(1)
+      lazyBuffers_(false),
+      autoCork_(false),
+      edgeTriggered_(false),
+      acceptBatch_(1),
+      cpuSteering_(false),
+      connNamePrefix_(std::make_shared<const string>(name_ + "-" + ipPort_ + "#")),
+      connections_(new ConnectionTable)
 {
     acceptor_->setNewConnectionCallback(
         std::bind(&TcpServer::newConnection, this, _1, _2));
+    acceptor_->setBatchCallback(
+        std::bind(&TcpServer::handOffConnections, this));
 }
 
 TcpServer::~TcpServer()
@@ -41,13 +78,32 @@ TcpServer::~TcpServer()
     loop_->assertInLoopThread();
     LOG_TRACE << "TcpServer::~TcpServer [" << name_ << "] destructing";
 
-    for (auto& item : connections_)
+    // stops accepting in I/O loops first
+    for (std::unique_ptr<Acceptor>& acceptor : loopAcceptors_)
     {
-        TcpConnectionPtr conn(item.second);
-        item.second.reset();
-        conn->getLoop()->runInLoop(
-            std::bind(&TcpConnection::connectDestroyed, conn));
+        CountDownLatch latch(1);
+        acceptor->getLoop()->runInLoop([&acceptor, &latch] {
+            acceptor.reset();
+            latch.countDown();
+        });
+        latch.wait();
     }
+
+    // each table is torn down in its own loop
+    std::vector<EventLoop*> loops(threadPool_->getAllLoops());
+    for (size_t i = 0; i < loopConnections_.size(); ++i)
+    {
+        std::unique_ptr<ConnectionTable>& connections = loopConnections_[i];
+        CountDownLatch latch(1);
+        loops[i]->runInLoop([&connections, &latch] {
+            destroyConnections(connections.get());
+            connections.reset();
+            latch.countDown();
+        });
+        latch.wait();
+    }
+
+    destroyConnections(get_pointer(connections_));
 }
 
 void TcpServer::setThreadNum(int numThreads)
@@ -56,15 +112,68 @@ void TcpServer::setThreadNum(int numThreads)
     threadPool_->setThreadNum(numThreads);
 }
 
+void TcpServer::setLoopStrategy(EventLoopThreadPool::Strategy strategy)
+{
+    threadPool_->setStrategy(strategy);
+}
+
+void TcpServer::setAcceptBatch(int n)
+{
+    acceptBatch_ = n;
+    acceptor_->setAcceptBatch(n);
+}
+
 void TcpServer::start()
 {
     if (started_.getAndSet(1) == 0)
     {
+        threadPool_->setCpuAffinity(cpuSteering_ && option_ == kReusePortPerLoop);
         threadPool_->start(threadInitCallback_);
 
         assert(!acceptor_->listening());
-        loop_->runInLoop(
-            std::bind(&Acceptor::listen, get_pointer(acceptor_)));
+        if (option_ == kReusePortPerLoop)
+        {
+            loop_->runInLoop(
+                std::bind(&TcpServer::startLoopAcceptors, this));
+        }
+        else
+        {
+            loop_->runInLoop(
+                std::bind(&Acceptor::listen, get_pointer(acceptor_)));
+        }
+    }
+}
+
+void TcpServer::startLoopAcceptors()
+{
+    loop_->assertInLoopThread();
+    // on the port acceptor_ is bound to, in case it was chosen by the kernel
+    InetAddress listenAddr(acceptor_->localAddress());
+    for (EventLoop* ioLoop : threadPool_->getAllLoops())
+    {
+        loopConnections_.emplace_back(new ConnectionTable);
+        ConnectionTable* connections = get_pointer(loopConnections_.back());
+        Acceptor* acceptor = get_pointer(acceptor_);
+        if (ioLoop != loop_)
+        {
+            loopAcceptors_.emplace_back(new Acceptor(ioLoop, listenAddr, true));
+            acceptor = get_pointer(loopAcceptors_.back());
+            acceptor->setAcceptBatch(acceptBatch_);
+        }
+        acceptor->setNewConnectionCallback(
+            std::bind(&TcpServer::newConnectionInLoop, this, ioLoop, connections, _1, _2));
+        acceptor->setBatchCallback(Acceptor::BatchCallback());
+        // one by one, so the i-th socket listening on the port is in the i-th loop
+        CountDownLatch latch(1);
+        ioLoop->runInLoop([acceptor, &latch] {
+            acceptor->listen();
+            latch.countDown();
+        });
+        latch.wait();
+    }
+    if (cpuSteering_ && !loopAcceptors_.empty())
+    {
+        loopAcceptors_.front()->steerByCpu(static_cast<int>(loopAcceptors_.size()));
     }
 }
 
@@ -72,45 +181,107 @@ void TcpServer::newConnection(int sockfd, const InetAddress& peerAddr)
 {
     loop_->assertInLoopThread();
     EventLoop* ioLoop = threadPool_->getNextLoop();
-    char buf[64];
-    snprintf(buf, sizeof buf, "-%s#%d", ipPort_.c_str(), nextConnId_);
-    ++nextConnId_;
-    string connName = name_ + buf;
+    TcpConnectionPtr conn = createConnection(ioLoop, get_pointer(connections_), sockfd, peerAddr);
+    if (ioLoop == loop_)
+    {
+        ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
+    }
+    else
+    {
+        // with the rest of this batch, see handOffConnections()
+        newConnections_.push_back(conn);
+    }
+}
 
-    LOG_INFO << "TcpServer::newConnection [" << name_
-           << "] - new connection [" << connName
-           << "] from " << peerAddr.toIpPort();
+void TcpServer::handOffConnections()
+{
+    loop_->assertInLoopThread();
+    // one functor and wakeup for each I/O loop, not for each connection
+    std::stable_sort(newConnections_.begin(), newConnections_.end(), lessLoop);
+    std::vector<TcpConnectionPtr>::const_iterator first = newConnections_.begin();
+    while (first != newConnections_.end())
+    {
+        EventLoop* ioLoop = (*first)->getLoop();
+        std::vector<TcpConnectionPtr>::const_iterator last = first;
+        while (last != newConnections_.end() && (*last)->getLoop() == ioLoop)
+        {
+            ++last;
+        }
+        ioLoop->queueInLoop(
+            std::bind(&establishConnections, std::vector<TcpConnectionPtr>(first, last)));
+        first = last;
+    }
+    newConnections_.clear();
+}
+
+void TcpServer::newConnectionInLoop(EventLoop* ioLoop, ConnectionTable* connections,
+                                    int sockfd, const InetAddress& peerAddr)
+{
+    ioLoop->assertInLoopThread();
+    createConnection(ioLoop, connections, sockfd, peerAddr)->connectEstablished();
+}
+
+TcpConnectionPtr TcpServer::createConnection(EventLoop* ioLoop, ConnectionTable* connections,
+                                             int sockfd, const InetAddress& peerAddr)
+{
+    const int64_t connId = nextConnId_.incrementAndGet();
     InetAddress localAddr(sockets::getLocalAddr(sockfd));
     // FIXME poll with zero timeout to double confirm the new connection
     // FIXME use make_shared if necessary
     TcpConnectionPtr conn(new TcpConnection(ioLoop,
-                                            connName,
+                                            connId,
+                                            connNamePrefix_,
                                             sockfd,
                                             localAddr,
-                                            peerAddr));
-    connections_[connName] = conn;
+                                            peerAddr,
+                                            lazyBuffers_));
     conn->setConnectionCallback(connectionCallback_);
     conn->setMessageCallback(messageCallback_);
+    if (chainMessageCallback_)
+    {
+        conn->setChainMessageCallback(chainMessageCallback_);
+    }
     conn->setWriteCompleteCallback(writeCompleteCallback_);
+    conn->setAutoCork(autoCork_);
+    conn->setEdgeTriggered(edgeTriggered_);
     conn->setCloseCallback(
-        std::bind(&TcpServer::removeConnection, this, _1)); // FIXME: unsafe
-    ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
+        std::bind(&TcpServer::removeConnection, this, connections, _1)); // FIXME: unsafe
+    // the name is only formatted if logged
+    LOG_INFO << "TcpServer::newConnection [" << name_
+           << "] - new connection [" << conn->name()
+           << "] from " << peerAddr.toIpPort();
+    connections->insert(connId, conn);
+    return conn;
 }
 
-void TcpServer::removeConnection(const TcpConnectionPtr& conn)
+void TcpServer::removeConnection(ConnectionTable* connections, const TcpConnectionPtr& conn)
 {
     // FIXME: unsafe
-    loop_->runInLoop(std::bind(&TcpServer::removeConnectionInLoop, this, conn));
+    if (option_ == kReusePortPerLoop)
+    {
+        removeConnectionInLoop(connections, conn);
+    }
+    else
+    {
+        loop_->runInLoop(std::bind(&TcpServer::removeConnectionInLoop, this, connections, conn));
+    }
 }
 
-void TcpServer::removeConnectionInLoop(const TcpConnectionPtr& conn)
+void TcpServer::removeConnectionInLoop(ConnectionTable* connections, const TcpConnectionPtr& conn)
 {
-    loop_->assertInLoopThread();
+    if (option_ != kReusePortPerLoop)
+    {
+        loop_->assertInLoopThread();
+    }
+    else
+    {
+        conn->getLoop()->assertInLoopThread();
+    }
     LOG_INFO << "TcpServer::removeConnectionInLoop [" << name_
            << "] - connection " << conn->name();
-    size_t n = connections_.erase(conn->name());
-    (void)n;
-    assert(n == 1);
+    bool erased = connections->erase(conn->id());
+    (void)erased;
+    assert(erased);
     EventLoop* ioLoop = conn->getLoop();
     ioLoop->queueInLoop(
         std::bind(&TcpConnection::connectDestroyed, conn));
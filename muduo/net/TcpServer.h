@@ -13,15 +13,17 @@
 
 #include "muduo/base/Atomic.h"
 #include "muduo/base/Types.h"
+#include "muduo/net/EventLoopThreadPool.h"
 #include "muduo/net/TcpConnection.h"
 
-#include <map>
+#include <vector>
 
 namespace muduo
 {
     namespace net
     {
         class Acceptor;
+        class ConnectionTable;
         class EventLoop;
         class EventLoopThreadPool;
 
@@ -38,6 +40,11 @@ namespace muduo
             {
                 kNoReusePort,
                 kReusePort,
+                /// Each I/O loop listens on its own SO_REUSEPORT socket,
+                /// and serves the connections it accepts, the kernel
+                /// spreads connections over them.  The base loop only
+                /// accepts if there is no I/O thread.
+                kReusePortPerLoop,
             };
 
             //TcpServer(EventLoop* loop, const InetAddress& listenAddr);
@@ -60,14 +67,61 @@ namespace muduo
             ///   this is the default value.
             /// - 1 means all I/O in another thread.
             /// - N means a thread pool with N threads, new connections
-            ///   are assigned on a round-robin basis.
+            ///   are assigned on a round-robin basis, or accepted by each
+            ///   thread with kReusePortPerLoop.
             void setThreadNum(int numThreads);
 
+            /// How new connections are assigned to the I/O threads, such as
+            /// to the one with fewest connections, for connections that
+            /// differ in lifetime or load.  Round-robin by default.
+            /// Not used with kReusePortPerLoop, where each thread accepts its own.
+            /// Must be called before @c start
+            void setLoopStrategy(EventLoopThreadPool::Strategy strategy);
+
             void setThreadInitCallback(const ThreadInitCallback& cb)
             {
                 threadInitCallback_ = cb;
             }
 
+            /// Connections hold no buffer storage while idle,
+            /// for servers with many mostly silent connections.
+            /// Must be called before @c start
+            void setLazyBuffers(bool on)
+            {
+                lazyBuffers_ = on;
+            }
+
+            /// Sends of a connection are written once per loop iteration,
+            /// see TcpConnection::setAutoCork.
+            /// Must be called before @c start
+            void setAutoCork(bool on)
+            {
+                autoCork_ = on;
+            }
+
+            /// Connections are edge-triggered, see TcpConnection::setEdgeTriggered.
+            /// Must be called before @c start
+            void setEdgeTriggered(bool on)
+            {
+                edgeTriggered_ = on;
+            }
+
+            /// Accepts up to @c n connections each time the listening socket
+            /// is readable, and hands each batch to an I/O thread at once,
+            /// for bursts of new connections.  1 by default.
+            /// Must be called before @c start
+            void setAcceptBatch(int n);
+
+            /// With kReusePortPerLoop, pins the i-th I/O thread to CPU i, and
+            /// steers each connection to the thread on the CPU that received
+            /// it, so that its packets, accepting and serving it stay on one
+            /// CPU.  Best with one I/O thread for each CPU.
+            /// Must be called before @c start
+            void setCpuSteering(bool on)
+            {
+                cpuSteering_ = on;
+            }
+
             /// valid after calling start()
             std::shared_ptr<EventLoopThreadPool> threadPool()
             {
@@ -94,6 +148,14 @@ namespace muduo
                 messageCallback_ = cb;
             }
 
+            /// Set chained message callback, used instead of the message
+            /// callback if set, see TcpConnection::setChainMessageCallback().
+            /// Not thread safe.
+            void setChainMessageCallback(const ChainMessageCallback& cb)
+            {
+                chainMessageCallback_ = cb;
+            }
+
             /// Set write complete callback.
             /// Not thread safe.
             void setWriteCompleteCallback(const WriteCompleteCallback& cb)
@@ -104,26 +166,51 @@ namespace muduo
         private:
             /// Not thread safe, but in loop
             void newConnection(int sockfd, const InetAddress& peerAddr);
+            /// Not thread safe, but in loop
+            void handOffConnections();
+            /// In ioLoop, with kReusePortPerLoop
+            void newConnectionInLoop(EventLoop* ioLoop, ConnectionTable* connections,
+                                     int sockfd, const InetAddress& peerAddr);
+            /// Thread safe, but in the loop of @c connections
+            TcpConnectionPtr createConnection(EventLoop* ioLoop, ConnectionTable* connections,
+                                              int sockfd, const InetAddress& peerAddr);
             /// Thread safe.
-            void removeConnection(const TcpConnectionPtr& conn);
+            void removeConnection(ConnectionTable* connections, const TcpConnectionPtr& conn);
+            /// Not thread safe, but in the loop of @c connections, which is
+            /// the connection's loop with kReusePortPerLoop
+            void removeConnectionInLoop(ConnectionTable* connections, const TcpConnectionPtr& conn);
             /// Not thread safe, but in loop
-            void removeConnectionInLoop(const TcpConnectionPtr& conn);
-
-            typedef std::map<string, TcpConnectionPtr> ConnectionMap;
+            void startLoopAcceptors();
 
             EventLoop* loop_; // the acceptor loop
             const string ipPort_;
             const string name_;
+            const Option option_;
             std::unique_ptr<Acceptor> acceptor_; // avoid revealing Acceptor
+            // one in each I/O loop, with kReusePortPerLoop
+            std::vector<std::unique_ptr<Acceptor>> loopAcceptors_;
             std::shared_ptr<EventLoopThreadPool> threadPool_;
             ConnectionCallback connectionCallback_;
             MessageCallback messageCallback_;
+            ChainMessageCallback chainMessageCallback_;
             WriteCompleteCallback writeCompleteCallback_;
             ThreadInitCallback threadInitCallback_;
             AtomicInt32 started_;
+            bool lazyBuffers_;
+            bool autoCork_;
+            bool edgeTriggered_;
+            int acceptBatch_;
+            bool cpuSteering_;
             // always in loop thread
-            int nextConnId_;
-            ConnectionMap connections_;
+            std::vector<TcpConnectionPtr> newConnections_;
+            // "name-ip:port#", followed by the id in connection names
+            const std::shared_ptr<const string> connNamePrefix_;
+            AtomicInt64 nextConnId_;
+            // always in loop thread, unless kReusePortPerLoop
+            std::unique_ptr<ConnectionTable> connections_;
+            // one in each I/O loop, with kReusePortPerLoop,
+            // each only touched in its own loop
+            std::vector<std::unique_ptr<ConnectionTable>> loopConnections_;
         };
     } // namespace net
 } // namespace muduo
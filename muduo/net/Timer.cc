@@ -14,9 +14,27 @@ using namespace muduo::net;
 AtomicInt64 Timer::s_numCreated_;
 
 void Timer::restart(Timestamp now) {
+    postponed_ = Timestamp();
     if (repeat_) {
         expiration_ = addTime(now, interval_);
     } else {
         expiration_ = Timestamp::invalid();
     }
 }
+
+void Timer::reset(TimerCallback cb, Timestamp when, double interval,
+                  int64_t sequence, bool coarse) {
+    callback_ = std::move(cb);
+    expiration_ = when;
+    interval_ = interval;
+    repeat_ = interval > 0.0;
+    coarse_ = coarse;
+    sequence_ = sequence;
+    state_ = kIdle;
+    postponed_ = Timestamp();
+}
+
+void Timer::release() {
+    callback_ = TimerCallback();
+    state_ = kIdle;
+}
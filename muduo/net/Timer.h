@@ -20,14 +20,26 @@ namespace muduo {
         ///
         /// Internal class for timer event.
         ///
+        /// A TimerQueue recycles its timers instead of deleting them, so a
+        /// TimerId always points to a live Timer, that matches if the
+        /// sequence does.
+        ///
         class Timer : noncopyable {
         public:
+            enum State { kIdle, kQueued, kExpired, kRunning, kCanceled };
+
             Timer(TimerCallback cb, Timestamp when, double interval)
                 : callback_(std::move(cb)),
                   expiration_(when),
                   interval_(interval),
+                  sequence_(s_numCreated_.incrementAndGet()),
+                  postponed_(),
+                  prev_(NULL),
+                  next_(NULL),
+                  index_(-1),
+                  state_(kIdle),
                   repeat_(interval > 0.0),
-                  sequence_(s_numCreated_.incrementAndGet()) {
+                  coarse_(false) {
             }
 
             void run() const {
@@ -36,18 +48,56 @@ namespace muduo {
 
             Timestamp expiration() const { return expiration_; }
             bool repeat() const { return repeat_; }
+            /// Checked on loop wakeups instead of by the timerfd.
+            bool coarse() const { return coarse_; }
             int64_t sequence() const { return sequence_; }
 
             void restart(Timestamp now);
 
+            /// Expires at 'when' instead, must not be in a TimerStore.
+            void moveTo(Timestamp when) {
+                expiration_ = when;
+                postponed_ = Timestamp();
+            }
+
+            /// A later expiration, to be queued for when the current one comes.
+            Timestamp postponed() const { return postponed_; }
+            void postpone(Timestamp when) { postponed_ = when; }
+
+            /// Reuses this timer for another callback, with a sequence
+            /// from newSequence().
+            void reset(TimerCallback cb, Timestamp when, double interval,
+                       int64_t sequence, bool coarse);
+            /// Drops the callback, and what it holds.
+            void release();
+
+            // for TimerQueue
+            State state() const { return state_; }
+            void set_state(State state) { state_ = state; }
+
+            // for the TimerStore holding it
+            int index() const { return index_; }
+            void set_index(int idx) { index_ = idx; }
+            Timer* prev() const { return prev_; }
+            void set_prev(Timer* timer) { prev_ = timer; }
+            Timer* next() const { return next_; }
+            void set_next(Timer* timer) { next_ = timer; }
+
             static int64_t numCreated() { return s_numCreated_.get(); }
+            static int64_t newSequence() { return s_numCreated_.incrementAndGet(); }
 
         private:
-            const TimerCallback callback_;
+            TimerCallback callback_;
             Timestamp expiration_;
-            const double interval_;
-            const bool repeat_;
-            const int64_t sequence_;
+            double interval_;
+            int64_t sequence_;
+            Timestamp postponed_;
+            Timer* prev_;
+            Timer* next_;
+            int index_;
+            State state_;
+            bool repeat_;
+            bool coarse_;
 
             static AtomicInt64 s_numCreated_;
         };
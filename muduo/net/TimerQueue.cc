@@ -16,6 +16,10 @@
 #include "muduo/net/EventLoop.h"
 #include "muduo/net/Timer.h"
 #include "muduo/net/TimerId.h"
+#include "muduo/net/TimerStore.h"
+
+#include <new>
+#include <type_traits>
 
 #include <sys/timerfd.h>
 #include <unistd.h>
@@ -88,12 +92,23 @@ using namespace muduo;
 using namespace muduo::net;
 using namespace muduo::net::detail;
 
+struct TimerQueue::Slab
+{
+  static const int kTimers = 128;
+  typedef std::aligned_storage<sizeof(Timer), alignof(Timer)>::type Storage;
+
+  Timer* at(int i) { return reinterpret_cast<Timer*>(&timers[i]); }
+
+  Storage timers[kTimers];
+};
+
 TimerQueue::TimerQueue(EventLoop* loop)
   : loop_(loop),
     timerfd_(createTimerfd()),
     timerfdChannel_(loop, timerfd_),
-    timers_(),
-    callingExpiredTimers_(false)
+    store_(TimerStore::newTimerStore(EventLoop::kTimerTree)),
+    coarseStore_(TimerStore::newCoarseTimerStore()),
+    freeTimers_(NULL)
 {
   timerfdChannel_.setReadCallback(
       std::bind(&TimerQueue::handleRead, this));
@@ -107,20 +122,35 @@ TimerQueue::~TimerQueue()
   timerfdChannel_.remove();
   ::close(timerfd_);
   // do not remove channel, since we're in EventLoop::dtor();
-  for (const Entry& timer : timers_)
+  MutexLockGuard lock(mutex_);
+  for (const std::unique_ptr<Slab>& slab : slabs_)
   {
-    delete timer.second;
+    for (int i = 0; i < Slab::kTimers; ++i)
+    {
+      slab->at(i)->~Timer();
+    }
   }
 }
 
 TimerId TimerQueue::addTimer(TimerCallback cb,
                              Timestamp when,
-                             double interval)
+                             double interval,
+                             bool coarse)
 {
-  Timer* timer = new Timer(std::move(cb), when, interval);
-  loop_->runInLoop(
-      std::bind(&TimerQueue::addTimerInLoop, this, timer));
-  return TimerId(timer, timer->sequence());
+  Timer* timer = newTimer();
+  const int64_t sequence = Timer::newSequence();
+  if (loop_->isInLoopThread())
+  {
+    addTimerInLoop(timer, cb, when, interval, sequence, coarse);
+  }
+  else
+  {
+    // set up in the loop thread, where a TimerId to it may be looked at
+    loop_->queueInLoop(
+        std::bind(&TimerQueue::addTimerInLoop, this, timer, std::move(cb),
+                  when, interval, sequence, coarse));
+  }
+  return TimerId(timer, sequence);
 }
 
 void TimerQueue::cancel(TimerId timerId)
@@ -129,132 +159,231 @@ void TimerQueue::cancel(TimerId timerId)
       std::bind(&TimerQueue::cancelInLoop, this, timerId));
 }
 
-void TimerQueue::addTimerInLoop(Timer* timer)
+void TimerQueue::resetTimer(TimerId timerId, Timestamp when, bool lazy)
 {
-  loop_->assertInLoopThread();
-  bool earliestChanged = insert(timer);
+  loop_->runInLoop(
+      std::bind(&TimerQueue::resetTimerInLoop, this, timerId, when, lazy));
+}
 
-  if (earliestChanged)
+void TimerQueue::setStructure(EventLoop::TimerStructure structure)
+{
+  loop_->assertInLoopThread();
+  std::unique_ptr<TimerStore> store(TimerStore::newTimerStore(structure));
+  std::vector<Timer*> timers;
+  store_->popExpired(Timestamp(INT64_MAX), &timers);
+  for (Timer* timer : timers)
   {
-    resetTimerfd(timerfd_, timer->expiration());
+    store->insert(timer);
   }
+  store_.swap(store);
+  armed_ = Timestamp();
+  armTimerfd();
 }
 
-void TimerQueue::cancelInLoop(TimerId timerId)
+int TimerQueue::pollTimeoutMs(int timeoutMs) const
 {
-  loop_->assertInLoopThread();
-  assert(timers_.size() == activeTimers_.size());
-  ActiveTimer timer(timerId.timer_, timerId.sequence_);
-  ActiveTimerSet::iterator it = activeTimers_.find(timer);
-  if (it != activeTimers_.end())
+  Timestamp nextExpire = coarseStore_->nextExpiration();
+  if (!nextExpire.valid())
   {
-    size_t n = timers_.erase(Entry(it->first->expiration(), it->first));
-    assert(n == 1); (void)n;
-    delete it->first; // FIXME: no delete please
-    activeTimers_.erase(it);
+    return timeoutMs;
   }
-  else if (callingExpiredTimers_)
+  int64_t microseconds = nextExpire.microSecondsSinceEpoch()
+                         - Timestamp::now().microSecondsSinceEpoch();
+  if (microseconds <= 0)
   {
-    cancelingTimers_.insert(timer);
+    return 0;
   }
-  assert(timers_.size() == activeTimers_.size());
+  // rounds up, not to wake up just before it
+  int64_t milliseconds = (microseconds + 999) / 1000;
+  return milliseconds < timeoutMs ? static_cast<int>(milliseconds) : timeoutMs;
 }
 
-void TimerQueue::handleRead()
+void TimerQueue::runCoarse(Timestamp now)
 {
   loop_->assertInLoopThread();
-  Timestamp now(Timestamp::now());
-  readTimerfd(timerfd_, now);
-
-  std::vector<Entry> expired = getExpired(now);
-
-  callingExpiredTimers_ = true;
-  cancelingTimers_.clear();
-  // safe to callback outside critical section
-  for (const Entry& it : expired)
+  Timestamp nextExpire = coarseStore_->nextExpiration();
+  if (nextExpire.valid() && !(now < nextExpire))
   {
-    it.second->run();
+    runExpired(coarseStore_.get(), now);
   }
-  callingExpiredTimers_ = false;
+}
 
-  reset(expired, now);
+void TimerQueue::addTimerInLoop(Timer* timer, TimerCallback& cb, Timestamp when,
+                                double interval, int64_t sequence, bool coarse)
+{
+  loop_->assertInLoopThread();
+  timer->reset(std::move(cb), when, interval, sequence, coarse);
+  insert(timer);
+  armTimerfd();
 }
 
-std::vector<TimerQueue::Entry> TimerQueue::getExpired(Timestamp now)
+void TimerQueue::cancelInLoop(TimerId timerId)
 {
-  assert(timers_.size() == activeTimers_.size());
-  std::vector<Entry> expired;
-  Entry sentry(now, reinterpret_cast<Timer*>(UINTPTR_MAX));
-  TimerList::iterator end = timers_.lower_bound(sentry);
-  assert(end == timers_.end() || now < end->first);
-  std::copy(timers_.begin(), end, back_inserter(expired));
-  timers_.erase(timers_.begin(), end);
-
-  for (const Entry& it : expired)
+  loop_->assertInLoopThread();
+  // timers are not deleted, so the sequence tells if it's the same one
+  Timer* timer = timerId.timer_;
+  if (timer == NULL || timer->sequence() != timerId.sequence_)
+  {
+    return;
+  }
+  if (timer->state() == Timer::kQueued)
   {
-    ActiveTimer timer(it.second, it.second->sequence());
-    size_t n = activeTimers_.erase(timer);
-    assert(n == 1); (void)n;
+    storeOf(timer)->erase(timer);
+    recycle(timer);
   }
+  else if (timer->state() == Timer::kExpired || timer->state() == Timer::kRunning)
+  {
+    // not to run, or not to restart
+    timer->set_state(Timer::kCanceled);
+  }
+}
 
-  assert(timers_.size() == activeTimers_.size());
-  return expired;
+void TimerQueue::resetTimerInLoop(TimerId timerId, Timestamp when, bool lazy)
+{
+  loop_->assertInLoopThread();
+  Timer* timer = timerId.timer_;
+  if (timer == NULL || timer->sequence() != timerId.sequence_)
+  {
+    return;
+  }
+  if (timer->state() == Timer::kQueued)
+  {
+    if (lazy && !(when < timer->expiration()))
+    {
+      // queued again when it comes up, see handleRead()
+      timer->postpone(when);
+    }
+    else
+    {
+      storeOf(timer)->erase(timer);
+      timer->moveTo(when);
+      insert(timer);
+      armTimerfd();
+    }
+  }
+  else if (timer->state() == Timer::kExpired || timer->state() == Timer::kRunning)
+  {
+    // queued again instead of, or after running, see reset()
+    timer->postpone(when);
+  }
 }
 
-void TimerQueue::reset(const std::vector<Entry>& expired, Timestamp now)
+void TimerQueue::handleRead()
 {
-  Timestamp nextExpire;
+  loop_->assertInLoopThread();
+  Timestamp now(Timestamp::now());
+  readTimerfd(timerfd_, now);
+  armed_ = Timestamp();
+  runExpired(store_.get(), now);
+}
 
-  for (const Entry& it : expired)
+void TimerQueue::runExpired(TimerStore* store, Timestamp now)
+{
+  std::vector<Timer*> expired;
+  store->popExpired(now, &expired);
+  size_t numExpired = 0;
+  for (Timer* timer : expired)
   {
-    ActiveTimer timer(it.second, it.second->sequence());
-    if (it.second->repeat()
-        && cancelingTimers_.find(timer) == cancelingTimers_.end())
+    Timestamp postponed = timer->postponed();
+    if (postponed.valid() && now < postponed)
     {
-      it.second->restart(now);
-      insert(it.second);
+      // reset lazily, not due yet
+      timer->moveTo(postponed);
+      insert(timer);
     }
     else
     {
-      // FIXME move to a free list
-      delete it.second; // FIXME: no delete please
+      timer->postpone(Timestamp());
+      timer->set_state(Timer::kExpired);
+      expired[numExpired++] = timer;
     }
   }
+  expired.resize(numExpired);
 
-  if (!timers_.empty())
+  // safe to callback outside critical section
+  for (Timer* timer : expired)
   {
-    nextExpire = timers_.begin()->second->expiration();
+    // unless canceled or reset by an earlier one
+    if (timer->state() == Timer::kExpired && !timer->postponed().valid())
+    {
+      timer->set_state(Timer::kRunning);
+      timer->run();
+    }
   }
 
-  if (nextExpire.valid())
+  reset(expired, now);
+}
+
+void TimerQueue::reset(const std::vector<Timer*>& expired, Timestamp now)
+{
+  for (Timer* timer : expired)
   {
-    resetTimerfd(timerfd_, nextExpire);
+    if (timer->state() != Timer::kCanceled && timer->postponed().valid())
+    {
+      // reset by a callback
+      timer->moveTo(timer->postponed());
+      insert(timer);
+    }
+    else if (timer->repeat() && timer->state() == Timer::kRunning)
+    {
+      timer->restart(now);
+      insert(timer);
+    }
+    else
+    {
+      recycle(timer);
+    }
   }
+
+  armTimerfd();
 }
 
-bool TimerQueue::insert(Timer* timer)
+void TimerQueue::insert(Timer* timer)
 {
   loop_->assertInLoopThread();
-  assert(timers_.size() == activeTimers_.size());
-  bool earliestChanged = false;
-  Timestamp when = timer->expiration();
-  TimerList::iterator it = timers_.begin();
-  if (it == timers_.end() || when < it->first)
-  {
-    earliestChanged = true;
-  }
+  timer->set_state(Timer::kQueued);
+  storeOf(timer)->insert(timer);
+}
+
+TimerStore* TimerQueue::storeOf(Timer* timer) const
+{
+  return timer->coarse() ? coarseStore_.get() : store_.get();
+}
+
+void TimerQueue::armTimerfd()
+{
+  Timestamp nextExpire = store_->nextExpiration();
+  if (nextExpire.valid() && (!armed_.valid() || nextExpire < armed_))
   {
-    std::pair<TimerList::iterator, bool> result
-      = timers_.insert(Entry(when, timer));
-    assert(result.second); (void)result;
+    resetTimerfd(timerfd_, nextExpire);
+    armed_ = nextExpire;
   }
+}
+
+Timer* TimerQueue::newTimer()
+{
+  MutexLockGuard lock(mutex_);
+  if (freeTimers_ == NULL)
   {
-    std::pair<ActiveTimerSet::iterator, bool> result
-      = activeTimers_.insert(ActiveTimer(timer, timer->sequence()));
-    assert(result.second); (void)result;
+    std::unique_ptr<Slab> slab(new Slab);
+    for (int i = Slab::kTimers - 1; i >= 0; --i)
+    {
+      Timer* timer = new (slab->at(i)) Timer(TimerCallback(), Timestamp(), 0.0);
+      timer->set_next(freeTimers_);
+      freeTimers_ = timer;
+    }
+    slabs_.push_back(std::move(slab));
   }
-
-  assert(timers_.size() == activeTimers_.size());
-  return earliestChanged;
+  Timer* timer = freeTimers_;
+  freeTimers_ = timer->next();
+  timer->set_next(NULL);
+  return timer;
 }
 
+void TimerQueue::recycle(Timer* timer)
+{
+  timer->release();
+  MutexLockGuard lock(mutex_);
+  timer->set_next(freeTimers_);
+  freeTimers_ = timer;
+}
@@ -11,27 +11,32 @@
 #ifndef MUDUO_NET_TIMERQUEUE_H
 #define MUDUO_NET_TIMERQUEUE_H
 
-#include <set>
+#include <memory>
 #include <vector>
 
 #include "muduo/base/Mutex.h"
 #include "muduo/base/Timestamp.h"
 #include "muduo/net/Callbacks.h"
 #include "muduo/net/Channel.h"
+#include "muduo/net/EventLoop.h"
 
 namespace muduo
 {
 namespace net
 {
 
-class EventLoop;
 class Timer;
 class TimerId;
+class TimerStore;
 
 ///
 /// A best efforts timer queue.
 /// No guarantee that the callback will be on time.
 ///
+/// Timers are ordered by a TimerStore.  They are constructed in slabs,
+/// recycled after they expire or are canceled, and destroyed with the
+/// queue, so that a TimerId always points to a Timer.
+///
 class TimerQueue : noncopyable
 {
  public:
@@ -43,42 +48,59 @@ class TimerQueue : noncopyable
   /// repeats if @c interval > 0.0.
   ///
   /// Must be thread safe. Usually be called from other threads.
+  ///
+  /// A coarse timer doesn't arm the timerfd, it is run by runCoarse()
+  /// when the loop wakes up, see pollTimeoutMs().
   TimerId addTimer(TimerCallback cb,
                    Timestamp when,
-                   double interval);
+                   double interval,
+                   bool coarse = false);
 
   void cancel(TimerId timerId);
 
- private:
+  /// Moves the timer to expire at 'when', see EventLoop::resetTimer().
+  void resetTimer(TimerId timerId, Timestamp when, bool lazy);
 
-  // FIXME: use unique_ptr<Timer> instead of raw pointers.
-  // This requires heterogeneous comparison lookup (N3465) from C++14
-  // so that we can find an T* in a set<unique_ptr<T>>.
-  typedef std::pair<Timestamp, Timer*> Entry;
-  typedef std::set<Entry> TimerList;
-  typedef std::pair<Timer*, int64_t> ActiveTimer;
-  typedef std::set<ActiveTimer> ActiveTimerSet;
+  /// Moves the timers into another structure.
+  /// Must be called in the loop thread.
+  void setStructure(EventLoop::TimerStructure structure);
 
-  void addTimerInLoop(Timer* timer);
+  /// How long the loop may wait in poll, at most 'timeoutMs',
+  /// so that it wakes up for the next coarse timer.
+  int pollTimeoutMs(int timeoutMs) const;
+  /// Runs the coarse timers expired at 'now'.
+  void runCoarse(Timestamp now);
+
+ private:
+  void addTimerInLoop(Timer* timer, TimerCallback& cb, Timestamp when,
+                      double interval, int64_t sequence, bool coarse);
   void cancelInLoop(TimerId timerId);
+  void resetTimerInLoop(TimerId timerId, Timestamp when, bool lazy);
   // called when timerfd alarms
   void handleRead();
-  // move out all expired timers
-  std::vector<Entry> getExpired(Timestamp now);
-  void reset(const std::vector<Entry>& expired, Timestamp now);
+  void runExpired(TimerStore* store, Timestamp now);
+  void reset(const std::vector<Timer*>& expired, Timestamp now);
+
+  // into the store for the timer
+  void insert(Timer* timer);
+  TimerStore* storeOf(Timer* timer) const;
+  // arms timerfd, if the next expiration is earlier than it is armed for
+  void armTimerfd();
+  Timer* newTimer();
+  void recycle(Timer* timer);
 
-  bool insert(Timer* timer);
+  struct Slab;
 
   EventLoop* loop_;
   const int timerfd_;
   Channel timerfdChannel_;
-  // Timer list sorted by expiration
-  TimerList timers_;
+  std::unique_ptr<TimerStore> store_;
+  Timestamp armed_;
+  std::unique_ptr<TimerStore> coarseStore_;
 
-  // for cancel()
-  ActiveTimerSet activeTimers_;
-  bool callingExpiredTimers_; /* atomic */
-  ActiveTimerSet cancelingTimers_;
+  MutexLock mutex_;
+  Timer* freeTimers_ GUARDED_BY(mutex_);  // linked by Timer::next()
+  std::vector<std::unique_ptr<Slab>> slabs_ GUARDED_BY(mutex_);
 };
 
 }  // namespace net
@@ -0,0 +1,54 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_TIMERSTORE_H
+#define MUDUO_NET_TIMERSTORE_H
+
+#include <vector>
+
+#include "muduo/base/Timestamp.h"
+#include "muduo/net/EventLoop.h"
+
+namespace muduo
+{
+    namespace net
+    {
+        class Timer;
+
+        ///
+        /// Base class for ordering the timers of a TimerQueue.
+        ///
+        /// This class doesn't own the Timer objects.
+        class TimerStore : noncopyable
+        {
+        public:
+            virtual ~TimerStore() {}
+
+            /// Adds a timer, to expire at timer->expiration().
+            virtual void insert(Timer* timer) = 0;
+
+            /// Removes a timer inserted and not expired.
+            virtual void erase(Timer* timer) = 0;
+
+            /// Moves out the timers expired at 'now'.
+            virtual void popExpired(Timestamp now, std::vector<Timer*>* expired) = 0;
+
+            /// When to check again for expired timers, invalid if there is no timer.
+            /// May be before the earliest expiration, or after it as much as
+            /// the store rounds expirations up, eg. to its ticks.
+            virtual Timestamp nextExpiration() const = 0;
+
+            virtual size_t size() const = 0;
+
+            static TimerStore* newTimerStore(EventLoop::TimerStructure structure);
+            /// For coarse timers, in buckets of 10ms.
+            static TimerStore* newCoarseTimerStore();
+        };
+    } // namespace net
+} // namespace muduo
+
+#endif  // MUDUO_NET_TIMERSTORE_H
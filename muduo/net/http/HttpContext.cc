@@ -44,13 +44,25 @@ bool HttpContext::processRequestLine(const char *begin, const char *end) {
     return succeed;
 }
 
+const char *HttpContext::findLine(Buffer *buf) {
+    assert(scanned_ <= buf->readableBytes());
+    const char *crlf = buf->findCRLF(buf->peek() + scanned_);
+    if (crlf) {
+        scanned_ = 0;
+    } else if (buf->readableBytes() > 0) {
+        // the last byte may be the CR of a CRLF not received yet
+        scanned_ = buf->readableBytes() - 1;
+    }
+    return crlf;
+}
+
 // return false if any error
 bool HttpContext::parseRequest(Buffer *buf, Timestamp receiveTime) {
     bool ok = true;
     bool hasMore = true;
     while (hasMore) {
         if (state_ == kExpectRequestLine) {
-            const char *crlf = buf->findCRLF();
+            const char *crlf = findLine(buf);
             if (crlf) {
                 ok = processRequestLine(buf->peek(), crlf);
                 if (ok) {
@@ -64,7 +76,7 @@ bool HttpContext::parseRequest(Buffer *buf, Timestamp receiveTime) {
                 hasMore = false;
             }
         } else if (state_ == kExpectHeaders) {
-            const char *crlf = buf->findCRLF();
+            const char *crlf = findLine(buf);
             if (crlf) {
                 const char *colon = std::find(buf->peek(), crlf, ':');
                 if (colon != crlf) {
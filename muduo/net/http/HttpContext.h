@@ -29,7 +29,8 @@ namespace muduo {
             };
 
             HttpContext()
-                : state_(kExpectRequestLine) {
+                : state_(kExpectRequestLine),
+                  scanned_(0) {
             }
 
             // default copy-ctor, dtor and assignment are fine
@@ -41,6 +42,7 @@ namespace muduo {
 
             void reset() {
                 state_ = kExpectRequestLine;
+                scanned_ = 0;
                 HttpRequest dummy;
                 request_.swap(dummy);
             }
@@ -51,8 +53,12 @@ namespace muduo {
 
         private:
             bool processRequestLine(const char *begin, const char *end);
+            const char *findLine(Buffer *buf);
 
             HttpRequestParseState state_;
+            // readable bytes already searched for CRLF, so that a partial
+            // line is not scanned again from the start on the next read.
+            size_t scanned_;
             HttpRequest request_;
         };
     } // namespace net
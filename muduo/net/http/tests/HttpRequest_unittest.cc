@@ -77,3 +77,25 @@ BOOST_AUTO_TEST_CASE(testParseRequestEmptyHeaderValue)
   BOOST_CHECK_EQUAL(request.getHeader("User-Agent"), string(""));
   BOOST_CHECK_EQUAL(request.getHeader("Accept-Encoding"), string(""));
 }
+
+BOOST_AUTO_TEST_CASE(testParseRequestByteByByte)
+{
+  string all("GET /index.html HTTP/1.1\r\n"
+       "Host: www.chenshuo.com\r\n"
+       "User-Agent: curl/7.58.0\r\n"
+       "\r\n");
+
+  HttpContext context;
+  Buffer input;
+  for (size_t i = 0; i < all.size(); ++i)
+  {
+    BOOST_CHECK(!context.gotAll());
+    input.append(all.data() + i, 1);
+    BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+  }
+  BOOST_CHECK(context.gotAll());
+  const HttpRequest& request = context.request();
+  BOOST_CHECK_EQUAL(request.path(), string("/index.html"));
+  BOOST_CHECK_EQUAL(request.getHeader("Host"), string("www.chenshuo.com"));
+  BOOST_CHECK_EQUAL(request.getHeader("User-Agent"), string("curl/7.58.0"));
+}
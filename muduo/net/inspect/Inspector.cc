@@ -14,6 +14,7 @@
 #include "muduo/net/EventLoop.h"
 #include "muduo/net/http/HttpRequest.h"
 #include "muduo/net/http/HttpResponse.h"
+#include "muduo/net/inspect/NetInspector.h"
 #include "muduo/net/inspect/ProcessInspector.h"
 #include "muduo/net/inspect/PerformanceInspector.h"
 #include "muduo/net/inspect/SystemInspector.h"
@@ -64,6 +65,7 @@ Inspector::Inspector(EventLoop* loop,
                      const string& name)
     : server_(loop, httpAddr, "Inspector:"+name),
       processInspector_(new ProcessInspector),
+      netInspector_(new NetInspector),
       systemInspector_(new SystemInspector)
 {
   assert(CurrentThread::isMainThread());
@@ -71,6 +73,7 @@ Inspector::Inspector(EventLoop* loop,
   g_globalInspector = this;
   server_.setHttpCallback(std::bind(&Inspector::onRequest, this, _1, _2));
   processInspector_->registerCommands(this);
+  netInspector_->registerCommands(this);
   systemInspector_->registerCommands(this);
 #ifdef HAVE_TCMALLOC
   performanceInspector_.reset(new PerformanceInspector);
@@ -22,6 +22,7 @@ namespace muduo
 namespace net
 {
 
+class NetInspector;
 class ProcessInspector;
 class PerformanceInspector;
 class SystemInspector;
@@ -54,6 +55,7 @@ class Inspector : noncopyable
 
   HttpServer server_;
   std::unique_ptr<ProcessInspector> processInspector_;
+  std::unique_ptr<NetInspector> netInspector_;
   std::unique_ptr<PerformanceInspector> performanceInspector_;
   std::unique_ptr<SystemInspector> systemInspector_;
   MutexLock mutex_;
@@ -0,0 +1,39 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+
+#include "muduo/net/inspect/NetInspector.h"
+
+#include "muduo/net/Acceptor.h"
+#include "muduo/net/BufferPool.h"
+#include "muduo/net/EventLoop.h"
+
+using namespace muduo;
+using namespace muduo::net;
+
+void NetInspector::registerCommands(Inspector* ins)
+{
+  ins->add("net", "acceptor", NetInspector::acceptor, "print accepted connections, their rate since last time, and EMFILE errors of each Acceptor");
+  ins->add("net", "bufferpool", NetInspector::bufferPool, "print buffer pool of each EventLoop");
+  ins->add("net", "loops", NetInspector::loops, "print queued functors, wakeups, connections and skipped poller updates of each EventLoop");
+}
+
+string NetInspector::acceptor(HttpRequest::Method, const Inspector::ArgList&)
+{
+  return Acceptor::allStatsString();
+}
+
+string NetInspector::bufferPool(HttpRequest::Method, const Inspector::ArgList&)
+{
+  return BufferPool::allStatsString();
+}
+
+string NetInspector::loops(HttpRequest::Method, const Inspector::ArgList&)
+{
+  return EventLoop::allStatsString();
+}
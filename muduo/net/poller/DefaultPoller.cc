@@ -7,8 +7,10 @@
 // Author: Shuo Chen (chenshuo at chenshuo dot com)
 
 #include "muduo/net/Poller.h"
-#include "muduo/net/poller/PollPoller.h"
+#include "muduo/base/Logging.h"
 #include "muduo/net/poller/EPollPoller.h"
+#include "muduo/net/poller/IoUringPoller.h"
+#include "muduo/net/poller/PollPoller.h"
 
 #include <stdlib.h>
 
@@ -20,6 +22,15 @@ Poller* Poller::newDefaultPoller(EventLoop* loop)
   {
     return new PollPoller(loop);
   }
+  else if (::getenv("MUDUO_USE_IOURING"))
+  {
+    if (IoUringPoller::available())
+    {
+      return new IoUringPoller(loop);
+    }
+    LOG_WARN << "io_uring is not available, uses epoll";
+    return new EPollPoller(loop);
+  }
   else
   {
     return new EPollPoller(loop);
@@ -33,13 +33,24 @@ namespace
 {
     const int kNew = -1;
     const int kAdded = 1;
-    const int kDeleted = 2;
+
+    uint32_t epollEvents(const Channel* channel)
+    {
+        uint32_t events = channel->events();
+        if (events != 0 && channel->isEdgeTriggered())
+        {
+            events |= EPOLLET;
+        }
+        return events;
+    }
 }
 
 EPollPoller::EPollPoller(EventLoop* loop)
     : Poller(loop),
       epollfd_(::epoll_create1(EPOLL_CLOEXEC)),
-      events_(kInitEventListSize)
+      events_(kInitEventListSize),
+      numUpdates_(0),
+      numControls_(0)
 {
     if (epollfd_ < 0)
     {
@@ -54,7 +65,8 @@ EPollPoller::~EPollPoller()
 
 Timestamp EPollPoller::poll(int timeoutMs, ChannelList* activeChannels)
 {
-    LOG_TRACE << "fd total count " << channels_.size();
+    LOG_TRACE << "fd total count " << numChannels();
+    applyChanges();
     int numEvents = ::epoll_wait(epollfd_,
                                  &*events_.begin(),
                                  static_cast<int>(events_.size()),
@@ -93,12 +105,7 @@ void EPollPoller::fillActiveChannels(int numEvents,
     for (int i = 0; i < numEvents; ++i)
     {
         Channel* channel = static_cast<Channel*>(events_[i].data.ptr);
-#ifndef NDEBUG
-        int fd = channel->fd();
-        ChannelMap::const_iterator it = channels_.find(fd);
-        assert(it != channels_.end());
-        assert(it->second == channel);
-#endif
+        assert(findChannel(channel->fd()) == channel);
         channel->set_revents(events_[i].events);
         activeChannels->push_back(channel);
     }
@@ -108,43 +115,31 @@ void EPollPoller::updateChannel(Channel* channel)
 {
     Poller::assertInLoopThread();
     const int index = channel->index();
-    LOG_TRACE << "fd = " << channel->fd()
+    const int fd = channel->fd();
+    LOG_TRACE << "fd = " << fd
     << " events = " << channel->events() << " index = " << index;
-    if (index == kNew || index == kDeleted)
+    if (index == kNew)
     {
-        // a new one, add with EPOLL_CTL_ADD
-        int fd = channel->fd();
-        if (index == kNew)
-        {
-            assert(channels_.find(fd) == channels_.end());
-            channels_[fd] = channel;
-        }
-        else // index == kDeleted
-        {
-            assert(channels_.find(fd) != channels_.end());
-            assert(channels_[fd] == channel);
-        }
-
+        assert(findChannel(fd) == NULL);
+        addChannel(channel);
         channel->set_index(kAdded);
-        update(EPOLL_CTL_ADD, channel);
     }
     else
     {
-        // update existing one with EPOLL_CTL_MOD/DEL
-        int fd = channel->fd();
-        (void)fd;
-        assert(channels_.find(fd) != channels_.end());
-        assert(channels_[fd] == channel);
+        assert(findChannel(fd) == channel);
         assert(index == kAdded);
-        if (channel->isNoneEvent())
-        {
-            update(EPOLL_CTL_DEL, channel);
-            channel->set_index(kDeleted);
-        }
-        else
-        {
-            update(EPOLL_CTL_MOD, channel);
-        }
+    }
+
+    // applied by applyChanges(), before the next epoll_wait
+    numUpdates_.fetch_add(1, std::memory_order_relaxed);
+    if (implicit_cast<size_t>(fd) >= interests_.size())
+    {
+        interests_.resize(fd + 1, Interest{ 0, false });
+    }
+    if (!interests_[fd].pending)
+    {
+        interests_[fd].pending = true;
+        changes_.push_back(fd);
     }
 }
 
@@ -153,31 +148,74 @@ void EPollPoller::removeChannel(Channel* channel)
     Poller::assertInLoopThread();
     int fd = channel->fd();
     LOG_TRACE << "fd = " << fd;
-    assert(channels_.find(fd) != channels_.end());
-    assert(channels_[fd] == channel);
+    assert(findChannel(fd) == channel);
     assert(channel->isNoneEvent());
     int index = channel->index();
-    assert(index == kAdded || index == kDeleted);
-    size_t n = channels_.erase(fd);
-    (void)n;
-    assert(n == 1);
-
-    if (index == kAdded)
+    assert(index == kAdded);
+    (void)index;
+
+    // the fd is about to be closed, or handed to another channel,
+    // so it can't wait for the next epoll_wait
+    Interest& interest = interests_[fd];
+    interest.pending = false;
+    if (interest.events != 0)
     {
         update(EPOLL_CTL_DEL, channel);
     }
+    eraseChannel(channel);
     channel->set_index(kNew);
 }
 
+int64_t EPollPoller::numSkippedUpdates() const
+{
+    // every epoll_ctl follows the update it applies
+    const int64_t controls = numControls_.load(std::memory_order_relaxed);
+    return numUpdates_.load(std::memory_order_relaxed) - controls;
+}
+
+void EPollPoller::applyChanges()
+{
+    for (int fd : changes_)
+    {
+        Interest& interest = interests_[fd];
+        if (!interest.pending)
+        {
+            continue;  // removed since
+        }
+        interest.pending = false;
+        Channel* channel = findChannel(fd);
+        assert(channel != NULL);
+        uint32_t events = epollEvents(channel);
+        if (events != interest.events)
+        {
+            if (interest.events == 0)
+            {
+                update(EPOLL_CTL_ADD, channel);
+            }
+            else if (events == 0)
+            {
+                update(EPOLL_CTL_DEL, channel);
+            }
+            else
+            {
+                update(EPOLL_CTL_MOD, channel);
+            }
+        }
+    }
+    changes_.clear();
+}
+
 void EPollPoller::update(int operation, Channel* channel)
 {
     struct epoll_event event;
     memZero(&event, sizeof event);
-    event.events = channel->events();
+    event.events = epollEvents(channel);
     event.data.ptr = channel;
     int fd = channel->fd();
     LOG_TRACE << "epoll_ctl op = " << operationToString(operation)
     << " fd = " << fd << " event = { " << channel->eventsToString() << " }";
+    numControls_.fetch_add(1, std::memory_order_relaxed);
+    interests_[fd].events = operation == EPOLL_CTL_DEL ? 0 : event.events;
     if (::epoll_ctl(epollfd_, operation, fd, &event) < 0)
     {
         if (operation == EPOLL_CTL_DEL)
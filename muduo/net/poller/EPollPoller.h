@@ -13,8 +13,11 @@
 
 #include "muduo/net/Poller.h"
 
+#include <atomic>
 #include <vector>
 
+#include <stdint.h>
+
 struct epoll_event;
 
 namespace muduo
@@ -24,6 +27,10 @@ namespace muduo
         ///
         /// IO Multiplexing with epoll(4).
         ///
+        /// Changes of interest are recorded per fd and applied before the
+        /// next wait, so a channel enabled and disabled several times in one
+        /// loop iteration costs at most one epoll_ctl(2).
+        ///
         class EPollPoller : public Poller
         {
         public:
@@ -33,6 +40,8 @@ namespace muduo
             Timestamp poll(int timeoutMs, ChannelList* activeChannels) override;
             void updateChannel(Channel* channel) override;
             void removeChannel(Channel* channel) override;
+            bool supportsEdgeTriggered() const override { return true; }
+            int64_t numSkippedUpdates() const override;
 
         private:
             static const int kInitEventListSize = 16;
@@ -41,12 +50,23 @@ namespace muduo
 
             void fillActiveChannels(int numEvents,
                                     ChannelList* activeChannels) const;
+            void applyChanges();
             void update(int operation, Channel* channel);
 
             typedef std::vector<struct epoll_event> EventList;
 
+            struct Interest
+            {
+                uint32_t events;  // as registered with epoll, 0 if not
+                bool pending;     // in changes_
+            };
+
             int epollfd_;
             EventList events_;
+            std::vector<Interest> interests_;  // indexed by fd
+            std::vector<int> changes_;  // fds to apply before the next wait
+            std::atomic<int64_t> numUpdates_;
+            std::atomic<int64_t> numControls_;
         };
     } // namespace net
 } // namespace muduo
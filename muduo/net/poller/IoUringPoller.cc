@@ -0,0 +1,371 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include "muduo/net/poller/IoUringPoller.h"
+
+#include "muduo/base/Logging.h"
+#include "muduo/net/Channel.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+    const unsigned kRequiredFeatures =
+        IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+
+    int ioUringSetup(unsigned entries, struct io_uring_params* params)
+    {
+        return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    // Only the loop thread submits, completions are reaped in io_uring_enter(2),
+    // fall back to plain flags on older kernels.
+    int createRing(unsigned entries, struct io_uring_params* params)
+    {
+        const unsigned flagsToTry[] = {
+            IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN,
+            IORING_SETUP_COOP_TASKRUN,
+            0,
+        };
+        int fd = -1;
+        for (unsigned flags : flagsToTry)
+        {
+            memZero(params, sizeof *params);
+            params->flags = flags;
+            fd = ioUringSetup(entries, params);
+            if (fd >= 0 || errno != EINVAL)
+            {
+                break;
+            }
+        }
+        return fd;
+    }
+
+    uint64_t packUserData(uint32_t generation, int slot)
+    {
+        return static_cast<uint64_t>(generation) << 32 | static_cast<uint32_t>(slot);
+    }
+}
+
+bool IoUringPoller::available()
+{
+    static const bool supported = [] {
+        struct io_uring_params params;
+        int fd = createRing(4, &params);
+        if (fd < 0)
+        {
+            return false;
+        }
+        ::close(fd);
+        return (params.features & kRequiredFeatures) == kRequiredFeatures;
+    }();
+    return supported;
+}
+
+IoUringPoller::IoUringPoller(EventLoop* loop)
+    : Poller(loop),
+      ringfd_(-1),
+      features_(0),
+      ring_(NULL),
+      ringSize_(0),
+      sqes_(NULL),
+      sqesSize_(0),
+      nextGeneration_(0),
+      numPolls_(0)
+{
+    struct io_uring_params params;
+    ringfd_ = createRing(kRingEntries, &params);
+    if (ringfd_ < 0)
+    {
+        LOG_SYSFATAL << "IoUringPoller::IoUringPoller";
+    }
+    features_ = params.features;
+    if ((features_ & kRequiredFeatures) != kRequiredFeatures)
+    {
+        LOG_FATAL << "IoUringPoller::IoUringPoller - io_uring features " << features_;
+    }
+
+    // one mapping for both rings with IORING_FEAT_SINGLE_MMAP
+    ringSize_ = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                         params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe));
+    ring_ = ::mmap(NULL, ringSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   ringfd_, IORING_OFF_SQ_RING);
+    sqesSize_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqes = ::mmap(NULL, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ringfd_, IORING_OFF_SQES);
+    if (ring_ == MAP_FAILED || sqes == MAP_FAILED)
+    {
+        LOG_SYSFATAL << "IoUringPoller::IoUringPoller - mmap";
+    }
+    sqes_ = static_cast<struct io_uring_sqe*>(sqes);
+
+    char* ring = static_cast<char*>(ring_);
+    sqHead_ = reinterpret_cast<unsigned*>(ring + params.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned*>(ring + params.sq_off.tail);
+    sqMask_ = *reinterpret_cast<unsigned*>(ring + params.sq_off.ring_mask);
+    sqEntries_ = params.sq_entries;
+    sqArray_ = reinterpret_cast<unsigned*>(ring + params.sq_off.array);
+    cqHead_ = reinterpret_cast<unsigned*>(ring + params.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned*>(ring + params.cq_off.tail);
+    cqMask_ = *reinterpret_cast<unsigned*>(ring + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<struct io_uring_cqe*>(ring + params.cq_off.cqes);
+}
+
+IoUringPoller::~IoUringPoller()
+{
+    ::munmap(sqes_, sqesSize_);
+    ::munmap(ring_, ringSize_);
+    ::close(ringfd_);
+}
+
+Timestamp IoUringPoller::poll(int timeoutMs, ChannelList* activeChannels)
+{
+    LOG_TRACE << "fd total count " << numChannels();
+    for (int slot : fired_)
+    {
+        const Registration& reg = registrations_[slot];
+        if (reg.channel && reg.armedEvents == 0 && !reg.channel->isNoneEvent())
+        {
+            arm(slot);
+        }
+    }
+    fired_.clear();
+
+    int ret = enter(timeoutMs == 0 ? 0 : 1, timeoutMs);
+    int savedErrno = errno;
+    Timestamp now(Timestamp::now());
+    fillActiveChannels(activeChannels);
+    if (!activeChannels->empty())
+    {
+        LOG_TRACE << activeChannels->size() << " events happened";
+    }
+    else if (ret >= 0 || savedErrno == ETIME)
+    {
+        LOG_TRACE << "nothing happened";
+    }
+    if (ret < 0 && savedErrno != EINTR && savedErrno != ETIME)
+    {
+        errno = savedErrno;
+        LOG_SYSERR << "IoUringPoller::poll()";
+    }
+    return now;
+}
+
+void IoUringPoller::fillActiveChannels(ChannelList* activeChannels)
+{
+    ++numPolls_;
+    unsigned head = *cqHead_;
+    const unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head)
+    {
+        const struct io_uring_cqe& cqe = cqes_[head & cqMask_];
+        const uint32_t generation = static_cast<uint32_t>(cqe.user_data >> 32);
+        const size_t slot = static_cast<uint32_t>(cqe.user_data);
+        // cancellations, and polls cancelled or re-armed since
+        if (generation == 0
+            || slot >= registrations_.size()
+            || registrations_[slot].generation != generation)
+        {
+            continue;
+        }
+        Registration& reg = registrations_[slot];
+        int revents = cqe.res;
+        if (cqe.res < 0)
+        {
+            LOG_ERROR << "IoUringPoller poll fd = " << reg.channel->fd()
+                      << " error = " << strerror_tl(-cqe.res);
+            revents = cqe.res == -EBADF ? POLLNVAL : POLLERR;
+        }
+        // a multishot poll may complete more than once
+        if (reg.lastPoll != numPolls_)
+        {
+            reg.lastPoll = numPolls_;
+            reg.revents = 0;
+            activeChannels->push_back(reg.channel);
+        }
+        reg.revents |= revents;
+        if (!(cqe.flags & IORING_CQE_F_MORE))
+        {
+            // one-shot, or a multishot poll which has ended
+            reg.generation = 0;
+            reg.armedEvents = 0;
+            fired_.push_back(static_cast<int>(slot));
+        }
+    }
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+    for (Channel* channel : *activeChannels)
+    {
+        channel->set_revents(registrations_[channel->index()].revents);
+    }
+}
+
+void IoUringPoller::updateChannel(Channel* channel)
+{
+    Poller::assertInLoopThread();
+    int slot = channel->index();
+    LOG_TRACE << "fd = " << channel->fd()
+    << " events = " << channel->events() << " index = " << slot;
+    if (slot < 0)
+    {
+        // a new one, takes a free slot
+        assert(findChannel(channel->fd()) == NULL);
+        addChannel(channel);
+        if (freeSlots_.empty())
+        {
+            slot = static_cast<int>(registrations_.size());
+            registrations_.push_back(Registration());
+        }
+        else
+        {
+            slot = freeSlots_.back();
+            freeSlots_.pop_back();
+        }
+        Registration& reg = registrations_[slot];
+        reg.channel = channel;
+        reg.generation = 0;
+        reg.armedEvents = 0;
+        reg.revents = 0;
+        reg.lastPoll = 0;
+        channel->set_index(slot);
+    }
+    else
+    {
+        assert(findChannel(channel->fd()) == channel);
+        assert(implicit_cast<size_t>(slot) < registrations_.size());
+        assert(registrations_[slot].channel == channel);
+    }
+
+    if (registrations_[slot].armedEvents != channel->events())
+    {
+        disarm(slot);
+        if (!channel->isNoneEvent())
+        {
+            arm(slot);
+        }
+    }
+}
+
+void IoUringPoller::removeChannel(Channel* channel)
+{
+    Poller::assertInLoopThread();
+    int fd = channel->fd();
+    LOG_TRACE << "fd = " << fd;
+    assert(findChannel(fd) == channel);
+    assert(channel->isNoneEvent());
+    int slot = channel->index();
+    assert(0 <= slot && implicit_cast<size_t>(slot) < registrations_.size());
+    eraseChannel(channel);
+
+    disarm(slot);
+    registrations_[slot].channel = NULL;
+    freeSlots_.push_back(slot);
+    channel->set_index(-1);
+    // an armed poll holds the file, which is about to be closed,
+    // a listening socket would stay bound, a connection not see FIN.
+    submit();
+}
+
+void IoUringPoller::arm(int slot)
+{
+    Registration& reg = registrations_[slot];
+    assert(reg.armedEvents == 0);
+    if (++nextGeneration_ == 0)
+    {
+        ++nextGeneration_;
+    }
+    reg.generation = nextGeneration_;
+    reg.armedEvents = reg.channel->events();
+
+    struct io_uring_sqe sqe;
+    memZero(&sqe, sizeof sqe);
+    sqe.opcode = IORING_OP_POLL_ADD;
+    sqe.fd = reg.channel->fd();
+    sqe.poll32_events = static_cast<uint32_t>(reg.armedEvents);
+    if (reg.channel->isEdgeTriggered())
+    {
+        sqe.len = IORING_POLL_ADD_MULTI;
+    }
+    sqe.user_data = packUserData(reg.generation, slot);
+    LOG_TRACE << "arm fd = " << sqe.fd << " event = { " << reg.channel->eventsToString() << " }";
+    queue(sqe);
+}
+
+void IoUringPoller::disarm(int slot)
+{
+    Registration& reg = registrations_[slot];
+    if (reg.armedEvents == 0)
+    {
+        return;
+    }
+    struct io_uring_sqe sqe;
+    memZero(&sqe, sizeof sqe);
+    sqe.opcode = IORING_OP_POLL_REMOVE;
+    sqe.fd = -1;
+    sqe.addr = packUserData(reg.generation, slot);
+    sqe.user_data = 0;  // fails if the poll has fired, ignored either way
+    if (features_ & IORING_FEAT_CQE_SKIP)
+    {
+        sqe.flags = IOSQE_CQE_SKIP_SUCCESS;
+    }
+    queue(sqe);
+    reg.generation = 0;
+    reg.armedEvents = 0;
+}
+
+unsigned IoUringPoller::numUnsubmitted() const
+{
+    return *sqTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+}
+
+void IoUringPoller::submit()
+{
+    const unsigned n = numUnsubmitted();
+    // GETEVENTS runs the deferred task work, which completes the cancellations
+    if (n > 0 && ::syscall(__NR_io_uring_enter, ringfd_, n, 0, IORING_ENTER_GETEVENTS, NULL, 0) < 0)
+    {
+        LOG_SYSERR << "IoUringPoller::submit - io_uring_enter";
+    }
+}
+
+void IoUringPoller::queue(const struct io_uring_sqe& sqe)
+{
+    if (numUnsubmitted() == sqEntries_)
+    {
+        // full, submit without waiting
+        submit();
+    }
+    const unsigned tail = *sqTail_;
+    const unsigned index = tail & sqMask_;
+    sqes_[index] = sqe;
+    sqArray_[index] = index;
+    __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+}
+
+int IoUringPoller::enter(unsigned minComplete, int timeoutMs)
+{
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    memZero(&arg, sizeof arg);
+    if (timeoutMs >= 0)
+    {
+        ts.tv_sec = timeoutMs / 1000;
+        ts.tv_nsec = static_cast<long long>(timeoutMs % 1000) * 1000 * 1000;
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+    }
+    return static_cast<int>(::syscall(__NR_io_uring_enter, ringfd_, numUnsubmitted(), minComplete,
+                                      IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                                      &arg, sizeof arg));
+}
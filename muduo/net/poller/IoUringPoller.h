@@ -0,0 +1,92 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_POLLER_IOURINGPOLLER_H
+#define MUDUO_NET_POLLER_IOURINGPOLLER_H
+
+#include "muduo/net/Poller.h"
+
+#include <stdint.h>
+
+#include <vector>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace muduo
+{
+    namespace net
+    {
+        ///
+        /// IO Multiplexing with io_uring(7) poll requests.
+        ///
+        /// Changes of interest are queued as submissions and go to the kernel
+        /// with the wait, one io_uring_enter(2) per loop iteration.
+        ///
+        /// Polls are one-shot and re-armed after the channel is handled, which
+        /// gives level-triggered semantics as the other pollers. Edge-triggered
+        /// channels get multishot polls, armed once.
+        ///
+        class IoUringPoller : public Poller
+        {
+        public:
+            IoUringPoller(EventLoop* loop);
+            ~IoUringPoller() override;
+
+            Timestamp poll(int timeoutMs, ChannelList* activeChannels) override;
+            void updateChannel(Channel* channel) override;
+            void removeChannel(Channel* channel) override;
+            bool supportsEdgeTriggered() const override { return true; }
+
+            /// Whether the kernel supports what this poller needs, checked once.
+            static bool available();
+
+        private:
+            static const unsigned kRingEntries = 1024;
+
+            struct Registration
+            {
+                Channel* channel;
+                uint32_t generation;  // of the armed poll, 0 if none
+                int armedEvents;
+                int revents;
+                uint64_t lastPoll;  // when it was made active
+            };
+
+            void arm(int slot);
+            void disarm(int slot);
+            void queue(const struct io_uring_sqe& sqe);
+            void submit();
+            unsigned numUnsubmitted() const;
+            int enter(unsigned minComplete, int timeoutMs);
+            void fillActiveChannels(ChannelList* activeChannels);
+
+            int ringfd_;
+            unsigned features_;
+            void* ring_;
+            size_t ringSize_;
+            struct io_uring_sqe* sqes_;
+            size_t sqesSize_;
+            unsigned* sqHead_;
+            unsigned* sqTail_;
+            unsigned sqMask_;
+            unsigned sqEntries_;
+            unsigned* sqArray_;
+            unsigned* cqHead_;
+            unsigned* cqTail_;
+            unsigned cqMask_;
+            struct io_uring_cqe* cqes_;
+
+            uint32_t nextGeneration_;
+            uint64_t numPolls_;
+            std::vector<Registration> registrations_;  // indexed by Channel::index()
+            std::vector<int> freeSlots_;
+            std::vector<int> fired_;  // to re-arm before the next wait
+        };
+    } // namespace net
+} // namespace muduo
+#endif  // MUDUO_NET_POLLER_IOURINGPOLLER_H
@@ -61,9 +61,8 @@ void PollPoller::fillActiveChannels(int numEvents,
     if (pfd->revents > 0)
     {
       --numEvents;
-      ChannelMap::const_iterator ch = channels_.find(pfd->fd);
-      assert(ch != channels_.end());
-      Channel* channel = ch->second;
+      Channel* channel = findChannel(pfd->fd);
+      assert(channel != NULL);
       assert(channel->fd() == pfd->fd);
       channel->set_revents(pfd->revents);
       // pfd->revents = 0;
@@ -79,7 +78,7 @@ void PollPoller::updateChannel(Channel* channel)
   if (channel->index() < 0)
   {
     // a new one, add to pollfds_
-    assert(channels_.find(channel->fd()) == channels_.end());
+    assert(findChannel(channel->fd()) == NULL);
     struct pollfd pfd;
     pfd.fd = channel->fd();
     pfd.events = static_cast<short>(channel->events());
@@ -87,13 +86,12 @@ void PollPoller::updateChannel(Channel* channel)
     pollfds_.push_back(pfd);
     int idx = static_cast<int>(pollfds_.size())-1;
     channel->set_index(idx);
-    channels_[pfd.fd] = channel;
+    addChannel(channel);
   }
   else
   {
     // update existing one
-    assert(channels_.find(channel->fd()) != channels_.end());
-    assert(channels_[channel->fd()] == channel);
+    assert(findChannel(channel->fd()) == channel);
     int idx = channel->index();
     assert(0 <= idx && idx < static_cast<int>(pollfds_.size()));
     struct pollfd& pfd = pollfds_[idx];
@@ -113,15 +111,13 @@ void PollPoller::removeChannel(Channel* channel)
 {
   Poller::assertInLoopThread();
   LOG_TRACE << "fd = " << channel->fd();
-  assert(channels_.find(channel->fd()) != channels_.end());
-  assert(channels_[channel->fd()] == channel);
+  assert(findChannel(channel->fd()) == channel);
   assert(channel->isNoneEvent());
   int idx = channel->index();
   assert(0 <= idx && idx < static_cast<int>(pollfds_.size()));
   const struct pollfd& pfd = pollfds_[idx]; (void)pfd;
   assert(pfd.fd == -channel->fd()-1 && pfd.events == channel->events());
-  size_t n = channels_.erase(channel->fd());
-  assert(n == 1); (void)n;
+  eraseChannel(channel);
   if (implicit_cast<size_t>(idx) == pollfds_.size()-1)
   {
     pollfds_.pop_back();
@@ -134,7 +130,7 @@ void PollPoller::removeChannel(Channel* channel)
     {
       channelAtEnd = -channelAtEnd-1;
     }
-    channels_[channelAtEnd]->set_index(idx);
+    findChannel(channelAtEnd)->set_index(idx);
     pollfds_.pop_back();
   }
 }
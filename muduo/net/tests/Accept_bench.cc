@@ -0,0 +1,163 @@
+#include "muduo/net/TcpServer.h"
+
+#include "muduo/base/CountDownLatch.h"
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThread.h"
+#include "muduo/net/EventLoopThreadPool.h"
+#include "muduo/net/InetAddress.h"
+
+#include <atomic>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// Connection bursts: client threads connect many sockets back to back,
+// to a TcpServer with I/O threads, for each accept batch size, then with
+// an SO_REUSEPORT acceptor in each I/O loop, spread by hash or by CPU.
+// Reports how fast the server establishes them, how many iterations
+// of the base loop it took, how many times the I/O loops were woken up
+// to take them over, and the share of the busiest I/O loop.
+//
+// usage: accept_bench [connections [threads [port]]]
+
+struct Counters
+{
+  int64_t iterations;  // of the base loop
+  int64_t wakeups;     // of the I/O loops
+};
+
+Counters snapshot(EventLoop* loop, TcpServer* server)
+{
+  Counters counters = { 0, 0 };
+  CountDownLatch latch(1);
+  loop->runInLoop([&] {
+    counters.iterations = loop->iteration();
+    for (EventLoop* ioLoop : server->threadPool()->getAllLoops())
+    {
+      counters.wakeups += ioLoop->numWakeups();
+    }
+    latch.countDown();
+  });
+  latch.wait();
+  return counters;
+}
+
+void bench(TcpServer::Option option, bool steer, int batch, int numConnections,
+           int numThreads, uint16_t port)
+{
+  EventLoopThread serverThread;
+  EventLoop* serverLoop = serverThread.startLoop();
+  std::unique_ptr<TcpServer> server;
+  std::atomic<int> connected(0);
+  MutexLock mutex;
+  std::map<EventLoop*, int> connectionsOfLoop;
+  CountDownLatch started(1);
+  serverLoop->runInLoop([&] {
+    server.reset(new TcpServer(serverLoop, InetAddress(port), "Accept", option));
+    server->setThreadNum(numThreads);
+    server->setAcceptBatch(batch);
+    server->setCpuSteering(steer);
+    server->setConnectionCallback([&](const TcpConnectionPtr& conn) {
+      if (conn->connected())
+      {
+        MutexLockGuard lock(mutex);
+        ++connectionsOfLoop[conn->getLoop()];
+      }
+      connected.fetch_add(conn->connected() ? 1 : -1, std::memory_order_relaxed);
+    });
+    server->start();
+    started.countDown();
+  });
+  started.wait();
+  const Counters before = snapshot(serverLoop, get_pointer(server));
+
+  struct sockaddr_in addr;
+  memZero(&addr, sizeof addr);
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  const int kClients = 4;
+  std::vector<int> fds(numConnections, -1);
+  Timestamp start(Timestamp::now());
+  std::vector<std::thread> clients;
+  for (int c = 0; c < kClients; ++c)
+  {
+    clients.emplace_back([&, c] {
+      for (int i = c; i < numConnections; i += kClients)
+      {
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (::connect(fd, reinterpret_cast<const struct sockaddr*>(&addr), sizeof addr) < 0)
+        {
+          perror("connect");
+          ::close(fd);
+          break;
+        }
+        fds[i] = fd;
+      }
+    });
+  }
+  for (std::thread& client : clients)
+  {
+    client.join();
+  }
+  while (connected.load() < numConnections)
+  {
+    ::usleep(100);
+  }
+  double elapsed = timeDifference(Timestamp::now(), start);
+  const Counters after = snapshot(serverLoop, get_pointer(server));
+  int busiest = 0;
+  {
+    MutexLockGuard lock(mutex);
+    for (const auto& item : connectionsOfLoop)
+    {
+      busiest = std::max(busiest, item.second);
+    }
+  }
+  printf("%-8s batch %3d %8.0f connections/s %6lld base loop iterations %6lld I/O wakeups"
+         " %5.1f%% in busiest loop\n",
+         steer ? "by CPU" : option == TcpServer::kReusePortPerLoop ? "per-loop" : "handoff",
+         batch, numConnections / elapsed,
+         static_cast<long long>(after.iterations - before.iterations),
+         static_cast<long long>(after.wakeups - before.wakeups),
+         100.0 * busiest / numConnections);
+
+  for (int fd : fds)
+  {
+    ::close(fd);
+  }
+  while (connected.load() > 0)
+  {
+    ::usleep(1000);
+  }
+  CountDownLatch stopped(1);
+  serverLoop->runInLoop([&] { server.reset(); stopped.countDown(); });
+  stopped.wait();
+}
+
+int main(int argc, char* argv[])
+{
+  Logger::setLogLevel(Logger::WARN);
+  int numConnections = argc > 1 ? atoi(argv[1]) : 2000;
+  int numThreads = argc > 2 ? atoi(argv[2]) : 4;
+  uint16_t port = static_cast<uint16_t>(argc > 3 ? atoi(argv[3]) : 9996);
+
+  printf("%d connections, %d threads\n", numConnections, numThreads);
+  for (int batch : { 1, 16, 64 })
+  {
+    bench(TcpServer::kNoReusePort, false, batch, numConnections, numThreads, port);
+  }
+  bench(TcpServer::kReusePortPerLoop, false, 16, numConnections, numThreads, port);
+  bench(TcpServer::kReusePortPerLoop, true, 16, numConnections, numThreads, port);
+}
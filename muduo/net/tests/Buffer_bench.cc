@@ -0,0 +1,124 @@
+#include "muduo/net/Buffer.h"
+#include "muduo/net/ByteScan.h"
+#include "muduo/base/Timestamp.h"
+
+#include <algorithm>
+
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int kRounds = 2000;
+
+// what Buffer::findCRLF() used to do
+const char* findCRLFBySearch(const char* begin, const char* end)
+{
+  static const char kCRLF[] = "\r\n";
+  const char* crlf = std::search(begin, end, kCRLF, kCRLF+2);
+  return crlf == end ? NULL : crlf;
+}
+
+template<typename FIND>
+void bench(const char* name, const Buffer& buf, FIND find)
+{
+  const char* begin = buf.peek();
+  const char* end = buf.beginWrite();
+  size_t found = 0;
+  Timestamp start(Timestamp::now());
+  for (int i = 0; i < kRounds; ++i)
+  {
+    const char* p = find(begin, end);
+    found += p ? p - begin : 0;
+  }
+  double seconds = timeDifference(Timestamp::now(), start);
+  double bytes = static_cast<double>(buf.readableBytes()) * kRounds;
+  printf("%-24s %-7s %8.2f GB/s  %zu\n", name, scan::kernelName(),
+         bytes / seconds / 1e9, found / kRounds);
+}
+
+// finds every line, as HttpContext does for a header block
+template<typename FIND>
+void benchLines(const char* name, const Buffer& buf, FIND find)
+{
+  const char* end = buf.beginWrite();
+  size_t found = 0;
+  Timestamp start(Timestamp::now());
+  for (int i = 0; i < kRounds; ++i)
+  {
+    for (const char* p = find(buf.peek(), end); p != NULL; p = find(p + 2, end))
+    {
+      ++found;
+    }
+  }
+  double seconds = timeDifference(Timestamp::now(), start);
+  double bytes = static_cast<double>(buf.readableBytes()) * kRounds;
+  printf("%-24s %-7s %8.2f GB/s  %zu lines\n", name, scan::kernelName(),
+         bytes / seconds / 1e9, found / kRounds);
+}
+
+// a header block with the terminator at its end, what a parser scans
+// when a large request arrives in pieces.
+void fill(Buffer* buf, size_t size)
+{
+  const string line = "X-Forwarded-For: 192.168.0.1, 10.0.0.1, 172.16.0.1   ";
+  while (buf->readableBytes() + line.size() < size)
+  {
+    buf->append(line);
+  }
+  buf->append(string(size - buf->readableBytes() - 4, 'x'));
+  buf->append("\r\n\r\n");
+}
+
+// a typical request header block
+void fillHeaders(Buffer* buf)
+{
+  buf->append("GET /index.html?user=muduo&lang=en HTTP/1.1\r\n"
+              "Host: www.chenshuo.com\r\n"
+              "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:109.0) Gecko/20100101 Firefox/115.0\r\n"
+              "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+              "Accept-Language: en-US,en;q=0.5\r\n"
+              "Accept-Encoding: gzip, deflate, br\r\n"
+              "Connection: keep-alive\r\n"
+              "Cookie: session=0123456789abcdef0123456789abcdef; theme=dark\r\n"
+              "Upgrade-Insecure-Requests: 1\r\n"
+              "Cache-Control: max-age=0\r\n"
+              "\r\n");
+}
+
+int main()
+{
+  const size_t sizes[] = { 256, 4096, 65536 };
+  const char* kernels[] = { "scalar", "sse2", "avx2" };
+  {
+    Buffer buf;
+    fillHeaders(&buf);
+    printf("header lines, %zu bytes\n", buf.readableBytes());
+    benchLines("std::search CRLF", buf, findCRLFBySearch);
+    for (const char* kernel : kernels)
+    {
+      if (scan::setKernel(kernel))
+      {
+        benchLines("findCRLF", buf, scan::findCRLF);
+      }
+    }
+  }
+  for (size_t size : sizes)
+  {
+    Buffer buf;
+    fill(&buf, size);
+    printf("%zu bytes\n", size);
+    bench("std::search CRLF", buf, findCRLFBySearch);
+    for (const char* kernel : kernels)
+    {
+      if (!scan::setKernel(kernel))
+      {
+        continue;
+      }
+      bench("findCRLF", buf, scan::findCRLF);
+      bench("findCRLFCRLF", buf, scan::findCRLFCRLF);
+      bench("findAnyOf(\"\\r\\n\")", buf,
+            [](const char* b, const char* e) { return scan::findAnyOf(b, e, "\r\n", 2); });
+    }
+  }
+}
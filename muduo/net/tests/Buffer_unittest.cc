@@ -1,12 +1,18 @@
 #include "muduo/net/Buffer.h"
+#include "muduo/net/BufferPool.h"
+#include "muduo/net/ByteScan.h"
 
 //#define BOOST_TEST_MODULE BufferTest
 #define BOOST_TEST_MAIN
 #define BOOST_TEST_DYN_LINK
 #include <boost/test/unit_test.hpp>
 
+#include <sys/socket.h>
+#include <unistd.h>
+
 using muduo::string;
 using muduo::net::Buffer;
+using muduo::net::BufferPool;
 
 BOOST_AUTO_TEST_CASE(testBufferAppendRetrieve)
 {
@@ -168,3 +174,184 @@ BOOST_AUTO_TEST_CASE(testMove)
   // printf("Buffer at %p, inner %p\n", &buf, inner);
   output(std::move(buf), inner);
 }
+
+BOOST_AUTO_TEST_CASE(testBufferPool)
+{
+  BufferPool pool;
+  BOOST_CHECK_EQUAL(BufferPool::current(), &pool);
+  {
+    Buffer buf;
+    BOOST_CHECK_EQUAL(buf.internalCapacity(), Buffer::kCheapPrepend + Buffer::kInitialSize);
+    buf.append(string(3000, 'x'));
+    BOOST_CHECK_EQUAL(buf.internalCapacity(), BufferPool::roundUp(Buffer::kCheapPrepend + 3000));
+  }
+  BOOST_CHECK_EQUAL(pool.numGets(), 2);
+  BOOST_CHECK_EQUAL(pool.numHits(), 0);
+  BOOST_CHECK_EQUAL(pool.numPuts(), 2);
+  BOOST_CHECK_EQUAL(pool.heldBytes(), 4104 + 1032);
+
+  Buffer buf;
+  Buffer copy(buf);
+  BOOST_CHECK_EQUAL(pool.numHits(), 1);
+  copy.append(string(2000, 'y'));
+  BOOST_CHECK_EQUAL(pool.numHits(), 1);
+  BOOST_CHECK_EQUAL(pool.heldBytes(), 4104 + 1032);
+  BOOST_CHECK_EQUAL(copy.retrieveAllAsString(), string(2000, 'y'));
+  copy.shrink(0);
+  BOOST_CHECK_EQUAL(copy.internalCapacity(), Buffer::kCheapPrepend + Buffer::kInitialSize);
+  BOOST_CHECK_EQUAL(pool.heldBytes(), 4104 + 2056);
+}
+
+BOOST_AUTO_TEST_CASE(testLazyBuffer)
+{
+  Buffer buf(Buffer::kInitialSize, true);
+  BOOST_CHECK(buf.lazy());
+  BOOST_CHECK_EQUAL(buf.internalCapacity(), 0);
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 0);
+  BOOST_CHECK_EQUAL(buf.writableBytes(), 0);
+  BOOST_CHECK_EQUAL(buf.prependableBytes(), Buffer::kCheapPrepend);
+
+  buf.append(string(200, 'x'));
+  BOOST_CHECK(buf.internalCapacity() >= Buffer::kCheapPrepend + 200);
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 200);
+  buf.prependInt32(-1);
+  BOOST_CHECK_EQUAL(buf.readInt32(), -1);
+
+  buf.retrieve(100);
+  BOOST_CHECK(buf.internalCapacity() > 0);
+  buf.retrieve(100);
+  BOOST_CHECK_EQUAL(buf.internalCapacity(), 0);
+  BOOST_CHECK_EQUAL(buf.writableBytes(), 0);
+
+  Buffer buf2(Buffer::kInitialSize, true);
+  buf2.prependInt8(42);
+  BOOST_CHECK(buf2.internalCapacity() > 0);
+  Buffer buf3(buf2);
+  BOOST_CHECK(buf3.lazy());
+  BOOST_CHECK_EQUAL(buf3.readInt8(), 42);
+  BOOST_CHECK_EQUAL(buf3.internalCapacity(), 0);
+  BOOST_CHECK_EQUAL(buf2.retrieveAllAsString(), string(1, 42));
+  BOOST_CHECK_EQUAL(buf2.internalCapacity(), 0);
+}
+
+// lazy or moved-from, no storage, but valid pointers
+BOOST_AUTO_TEST_CASE(testBufferWithoutStorage)
+{
+  Buffer lazy(Buffer::kInitialSize, true);
+  Buffer moved;
+  moved.append("muduo");
+  Buffer other(std::move(moved));
+  for (Buffer* buf : { &lazy, &moved })
+  {
+    BOOST_CHECK_EQUAL(buf->internalCapacity(), 0);
+    BOOST_CHECK(buf->peek() != NULL);
+    BOOST_CHECK(buf->peek() == buf->beginWrite());
+    BOOST_CHECK(buf->findCRLF() == NULL);
+    BOOST_CHECK(buf->findEOL() == NULL);
+    BOOST_CHECK_EQUAL(buf->toStringPiece().size(), 0);
+    BOOST_CHECK_EQUAL(buf->retrieveAllAsString(), "");
+    buf->ensureWritableBytes(0);
+    buf->append("", 0);
+    Buffer copy(*buf);
+    BOOST_CHECK_EQUAL(copy.readableBytes(), 0);
+
+    buf->append("hello\r\n");
+    BOOST_CHECK(buf->internalCapacity() > 0);
+    BOOST_CHECK(buf->findCRLF() == buf->peek() + 5);
+    BOOST_CHECK_EQUAL(buf->retrieveAllAsString(), "hello\r\n");
+  }
+  BOOST_CHECK_EQUAL(other.retrieveAllAsString(), "muduo");
+}
+
+BOOST_AUTO_TEST_CASE(testReadFdScratch)
+{
+  BufferPool pool;
+  int fds[2];
+  BOOST_REQUIRE_EQUAL(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  int savedErrno = 0;
+
+  // small read is copied, the buffer keeps its storage
+  Buffer buf;
+  BOOST_REQUIRE_EQUAL(::write(fds[0], "hello", 5), 5);
+  BOOST_CHECK_EQUAL(buf.readFd(fds[1], &savedErrno, 65536), 5);
+  BOOST_CHECK_EQUAL(buf.internalCapacity(), Buffer::kCheapPrepend + Buffer::kInitialSize);
+  BOOST_CHECK_EQUAL(buf.retrieveAllAsString(), "hello");
+
+  // large read into an empty buffer takes over the scratch block
+  const string str(20000, 'x');
+  BOOST_REQUIRE_EQUAL(::write(fds[0], str.data(), str.size()), static_cast<ssize_t>(str.size()));
+  size_t capacity = 0;
+  const char* scratch = pool.scratch(&capacity);
+  BOOST_CHECK_EQUAL(buf.readFd(fds[1], &savedErrno, 65536), static_cast<ssize_t>(str.size()));
+  BOOST_CHECK_EQUAL(buf.peek(), scratch + Buffer::kCheapPrepend);
+  BOOST_CHECK_EQUAL(buf.internalCapacity(), capacity);
+  BOOST_CHECK(pool.scratch(&capacity) != scratch);
+
+  // non-empty buffer grows to the hint, then reads in place
+  BOOST_REQUIRE_EQUAL(::write(fds[0], str.data(), str.size()), static_cast<ssize_t>(str.size()));
+  buf.retrieve(10000);
+  Buffer buf2;
+  buf2.append("y", 1);
+  BOOST_CHECK_EQUAL(buf2.readFd(fds[1], &savedErrno, 30000), static_cast<ssize_t>(str.size()));
+  BOOST_CHECK(buf2.internalCapacity() >= 30000);
+  BOOST_CHECK_EQUAL(buf2.retrieveAllAsString(), "y" + str);
+  BOOST_CHECK_EQUAL(buf.retrieveAllAsString(), string(10000, 'x'));
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
+
+BOOST_AUTO_TEST_CASE(testFindDelimiters)
+{
+  namespace scan = muduo::net::scan;
+  const string saved = scan::kernelName();
+  const char* kernels[] = { "scalar", "sse2", "avx2" };
+  for (const char* kernel : kernels)
+  {
+    if (!scan::setKernel(kernel))
+    {
+      continue;
+    }
+    BOOST_TEST_MESSAGE("kernel " << kernel);
+    {
+      // past the vector scan, with a lone CR on the way
+      string str(3000, 'x');
+      str[700] = '\r';
+      str.replace(1500, 4, "\r\n\r\n");
+      Buffer buf;
+      buf.append(str);
+      BOOST_CHECK_EQUAL(buf.findCRLF() - buf.peek(), 1500);
+      BOOST_CHECK_EQUAL(buf.findCRLFCRLF() - buf.peek(), 1500);
+      BOOST_CHECK_EQUAL(buf.findAnyOf("\n\t") - buf.peek(), 1501);
+    }
+    for (size_t len = 0; len < 100; ++len)
+    {
+      for (size_t pos = 0; pos + 4 <= len; ++pos)
+      {
+        string str(len, 'x');
+        str[len-1] = '\r';
+        str.replace(pos, 4, "\r\n\r\n");
+        Buffer buf;
+        buf.append(str);
+        const char* crlf = buf.findCRLF();
+        BOOST_REQUIRE(crlf != NULL);
+        BOOST_CHECK_EQUAL(crlf - buf.peek(), static_cast<ptrdiff_t>(pos));
+        BOOST_CHECK_EQUAL(buf.findCRLFCRLF() - buf.peek(), static_cast<ptrdiff_t>(pos));
+        BOOST_CHECK_EQUAL(buf.findCRLF(crlf + 1) - buf.peek(), static_cast<ptrdiff_t>(pos + 2));
+        BOOST_CHECK(buf.findCRLFCRLF(crlf + 1) == NULL);
+        BOOST_CHECK_EQUAL(buf.findAnyOf(":\n") - buf.peek(), static_cast<ptrdiff_t>(pos + 1));
+        BOOST_CHECK(buf.findAnyOf(crlf + 4, "\n:") == NULL);
+      }
+      Buffer buf;
+      buf.append(string(len, 'a'));
+      BOOST_CHECK(buf.findCRLF() == NULL);
+      BOOST_CHECK(buf.findCRLFCRLF() == NULL);
+      BOOST_CHECK(buf.findAnyOf("bcdefghijklmnopqrstuvwxyz") == NULL);
+      if (len > 0)
+      {
+        BOOST_CHECK_EQUAL(buf.findAnyOf("bcdefghijklmnopqrstuvwxyza"), buf.peek());
+        BOOST_CHECK_EQUAL(buf.findAnyOf("zyxa"), buf.peek());
+      }
+    }
+  }
+  BOOST_CHECK(scan::setKernel(saved.c_str()));
+}
@@ -0,0 +1,128 @@
+#include "muduo/net/ChainBuffer.h"
+
+//#define BOOST_TEST_MODULE ChainBufferTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+using muduo::string;
+using muduo::net::ChainBuffer;
+
+BOOST_AUTO_TEST_CASE(testChainBufferAppendRetrieve)
+{
+  ChainBuffer buf(64);
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 0);
+  BOOST_CHECK_EQUAL(buf.numBlocks(), 0);
+
+  const string str(200, 'x');
+  buf.append(str);
+  BOOST_CHECK_EQUAL(buf.readableBytes(), str.size());
+  BOOST_CHECK_EQUAL(buf.numBlocks(), 4);
+  BOOST_CHECK_EQUAL(buf.contiguousBytes(), 64 - ChainBuffer::kCheapPrepend);
+
+  const string str2 = buf.retrieveAsString(100);
+  BOOST_CHECK_EQUAL(str2, string(100, 'x'));
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 100);
+  BOOST_CHECK_EQUAL(buf.numBlocks(), 3);
+
+  buf.append(string(50, 'y'));
+  const string str3 = buf.retrieveAllAsString();
+  BOOST_CHECK_EQUAL(str3, string(100, 'x') + string(50, 'y'));
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 0);
+  BOOST_CHECK_EQUAL(buf.numBlocks(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(testChainBufferPullup)
+{
+  ChainBuffer buf(64);
+  string str;
+  for (int i = 0; i < 300; ++i)
+  {
+    str.push_back(static_cast<char>('a' + i % 26));
+  }
+  buf.append(str);
+  BOOST_CHECK(buf.contiguousBytes() < 100);
+
+  const char* p = buf.pullup(100);
+  BOOST_CHECK_EQUAL(p, buf.peek());
+  BOOST_CHECK(buf.contiguousBytes() >= 100);
+  BOOST_CHECK_EQUAL(string(p, 100), str.substr(0, 100));
+  BOOST_CHECK_EQUAL(buf.readableBytes(), str.size());
+  BOOST_CHECK_EQUAL(buf.retrieveAllAsString(), str);
+}
+
+BOOST_AUTO_TEST_CASE(testChainBufferPrepend)
+{
+  ChainBuffer buf(64);
+  buf.append(string(200, 'y'));
+  buf.prependInt32(0x61626364);
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 204);
+  BOOST_CHECK_EQUAL(buf.numBlocks(), 4);
+
+  // no room left in front of the head block
+  buf.prepend("0123456789", 10);
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 214);
+  BOOST_CHECK_EQUAL(buf.numBlocks(), 5);
+  BOOST_CHECK_EQUAL(buf.retrieveAsString(10), "0123456789");
+  BOOST_CHECK_EQUAL(buf.readInt32(), 0x61626364);
+  BOOST_CHECK_EQUAL(buf.retrieveAllAsString(), string(200, 'y'));
+}
+
+BOOST_AUTO_TEST_CASE(testChainBufferReadInt)
+{
+  ChainBuffer buf(16);
+  buf.append(string(20, 'z'));
+  buf.appendInt64(-3);
+  buf.appendInt16(-2);
+  buf.appendInt8(-1);
+  buf.retrieve(20);
+  // spans two blocks
+  BOOST_CHECK_EQUAL(buf.peekInt64(), -3);
+  BOOST_CHECK_EQUAL(buf.readInt64(), -3);
+  BOOST_CHECK_EQUAL(buf.readInt16(), -2);
+  BOOST_CHECK_EQUAL(buf.readInt8(), -1);
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(testChainBufferFd)
+{
+  int fds[2];
+  BOOST_REQUIRE_EQUAL(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+  ChainBuffer output(1024);
+  string str;
+  for (int i = 0; i < 100000; ++i)
+  {
+    str.push_back(static_cast<char>(i % 251));
+  }
+  output.append(str);
+
+  ChainBuffer input(1024);
+  int savedErrno = 0;
+  while (output.readableBytes() > 0 || input.readableBytes() < str.size())
+  {
+    if (output.readableBytes() > 0)
+    {
+      BOOST_REQUIRE(output.writeFd(fds[0], &savedErrno) > 0);
+    }
+    BOOST_REQUIRE(input.readFd(fds[1], &savedErrno) > 0);
+  }
+  BOOST_CHECK_EQUAL(input.readableBytes(), str.size());
+  BOOST_CHECK(input.retrieveAllAsString() == str);
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
+
+BOOST_AUTO_TEST_CASE(testChainBufferMove)
+{
+  ChainBuffer buf;
+  buf.append("muduo", 5);
+  const char* inner = buf.peek();
+  ChainBuffer newbuf(std::move(buf));
+  BOOST_CHECK_EQUAL(inner, newbuf.peek());
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 0);
+  BOOST_CHECK_EQUAL(newbuf.retrieveAllAsString(), "muduo");
+}
@@ -0,0 +1,171 @@
+#include "muduo/net/TcpServer.h"
+
+#include "muduo/net/Channel.h"
+
+#include "muduo/base/CountDownLatch.h"
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThread.h"
+#include "muduo/net/InetAddress.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// Connection churn: a client thread connects and resets as fast as it can,
+// the server accepts, registers, then removes and closes each connection,
+// with idle connections held open so the Poller tracks many fds.
+// Then channels are added to and removed from the Poller in the loop
+// thread, without the TCP handshakes.
+//
+// usage: churn_bench [idle_connections [seconds [port]]]
+
+int connectTo(const struct sockaddr_in& addr, bool reset)
+{
+  int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (reset)
+  {
+    // no TIME_WAIT, or the ephemeral ports run out
+    struct linger lin = { 1, 0 };
+    ::setsockopt(fd, SOL_SOCKET, SO_LINGER, &lin, sizeof lin);
+  }
+  if (::connect(fd, reinterpret_cast<const struct sockaddr*>(&addr), sizeof addr) < 0)
+  {
+    ::close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+void startServer(EventLoop* loop, const InetAddress& listenAddr,
+                 std::atomic<int64_t>* accepted,
+                 std::unique_ptr<TcpServer>* server, CountDownLatch* latch)
+{
+  server->reset(new TcpServer(loop, listenAddr, "Churn"));
+  (*server)->setConnectionCallback([accepted](const TcpConnectionPtr& conn) {
+    if (conn->connected())
+    {
+      accepted->fetch_add(1, std::memory_order_relaxed);
+    }
+  });
+  (*server)->start();
+  latch->countDown();
+}
+
+// in the loop thread
+void registerChannels(EventLoop* loop, double seconds, CountDownLatch* latch)
+{
+  const int kFds = 64;
+  int efd = ::eventfd(0, EFD_CLOEXEC);
+  std::vector<int> fds;
+  for (int i = 0; i < kFds; ++i)
+  {
+    fds.push_back(::dup(efd));
+  }
+  int64_t count = 0;
+  Timestamp start(Timestamp::now());
+  double elapsed = 0;
+  while (elapsed < seconds)
+  {
+    for (int i = 0; i < 1024; ++i)
+    {
+      Channel channel(loop, fds[count % kFds]);
+      channel.enableReading();
+      channel.disableAll();
+      channel.remove();
+      ++count;
+    }
+    elapsed = timeDifference(Timestamp::now(), start);
+  }
+  printf("%-22s %10.0f channels/s\n", "  add+remove", static_cast<double>(count) / elapsed);
+  printf("%-22s %10lld\n", "  skipped updates", static_cast<long long>(loop->numSkippedPollerUpdates()));
+  for (int fd : fds)
+  {
+    ::close(fd);
+  }
+  ::close(efd);
+  latch->countDown();
+}
+
+int main(int argc, char* argv[])
+{
+  // every reset connection logs an error
+  Logger::setOutput([](const char*, int) {});
+  int numIdle = argc > 1 ? atoi(argv[1]) : 5000;
+  double seconds = argc > 2 ? atof(argv[2]) : 5;
+  uint16_t port = static_cast<uint16_t>(argc > 3 ? atoi(argv[3]) : 9997);
+
+  EventLoopThread serverThread;
+  EventLoop* serverLoop = serverThread.startLoop();
+  std::unique_ptr<TcpServer> server;
+  std::atomic<int64_t> accepted(0);
+  CountDownLatch started(1);
+  serverLoop->runInLoop(
+      std::bind(startServer, serverLoop, InetAddress(port), &accepted, &server, &started));
+  started.wait();
+
+  struct sockaddr_in addr;
+  memZero(&addr, sizeof addr);
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  std::vector<int> idle;
+  for (int i = 0; i < numIdle; ++i)
+  {
+    int fd = connectTo(addr, false);
+    if (fd < 0)
+    {
+      perror("connect");
+      break;
+    }
+    idle.push_back(fd);
+  }
+  while (accepted.load() < static_cast<int64_t>(idle.size()))
+  {
+    ::usleep(1000);
+  }
+
+  std::atomic<bool> running(true);
+  const int64_t base = accepted.load();
+  Timestamp start(Timestamp::now());
+  std::thread churner([&] {
+    while (running.load(std::memory_order_relaxed))
+    {
+      int fd = connectTo(addr, true);
+      if (fd >= 0)
+      {
+        ::close(fd);
+      }
+    }
+  });
+  ::usleep(static_cast<useconds_t>(seconds * 1000 * 1000));
+  int64_t churned = accepted.load() - base;
+  double elapsed = timeDifference(Timestamp::now(), start);
+  running = false;
+  churner.join();
+  printf("%zu idle connections\n", idle.size());
+  printf("%-22s %10.0f connections/s\n", "  accept+close", static_cast<double>(churned) / elapsed);
+
+  CountDownLatch registered(1);
+  serverLoop->runInLoop(std::bind(registerChannels, serverLoop, seconds, &registered));
+  registered.wait();
+
+  for (int fd : idle)
+  {
+    ::close(fd);
+  }
+  CountDownLatch stopped(1);
+  serverLoop->runInLoop([&] { server.reset(); stopped.countDown(); });
+  stopped.wait();
+}
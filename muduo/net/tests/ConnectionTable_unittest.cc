@@ -0,0 +1,143 @@
+#include "muduo/net/ConnectionTable.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/TcpConnection.h"
+
+//#define BOOST_TEST_MODULE ConnectionTableTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <map>
+#include <random>
+
+#include <sys/socket.h>
+
+using muduo::string;
+using muduo::net::ConnectionTable;
+using muduo::net::EventLoop;
+using muduo::net::InetAddress;
+using muduo::net::TcpConnection;
+using muduo::net::TcpConnectionPtr;
+
+namespace
+{
+
+TcpConnectionPtr newConnection(EventLoop* loop, int64_t id,
+                               const std::shared_ptr<const string>& namePrefix)
+{
+  int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  TcpConnectionPtr conn(new TcpConnection(loop, id, namePrefix, fd,
+                                          InetAddress(), InetAddress()));
+  conn->setConnectionCallback(muduo::net::defaultConnectionCallback);
+  conn->connectEstablished();
+  return conn;
+}
+
+void destroy(const TcpConnectionPtr& conn)
+{
+  conn->connectDestroyed();
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(testConnectionName)
+{
+  EventLoop loop;
+  std::shared_ptr<const string> prefix(new string("Server-0.0.0.0:2007#"));
+  TcpConnectionPtr conn = newConnection(&loop, 42, prefix);
+  BOOST_CHECK_EQUAL(conn->id(), 42);
+  BOOST_CHECK_EQUAL(conn->name(), "Server-0.0.0.0:2007#42");
+  BOOST_CHECK_EQUAL(&conn->name(), &conn->name());
+  destroy(conn);
+}
+
+BOOST_AUTO_TEST_CASE(testInsertEraseFind)
+{
+  EventLoop loop;
+  std::shared_ptr<const string> prefix(new string("Server#"));
+  ConnectionTable table;
+  BOOST_CHECK_EQUAL(table.size(), 0);
+  BOOST_CHECK(!table.erase(1));
+  BOOST_CHECK(!table.find(1));
+
+  std::vector<TcpConnectionPtr> conns;
+  for (int64_t id = 1; id <= 100; ++id)
+  {
+    conns.push_back(newConnection(&loop, id, prefix));
+    table.insert(id, conns.back());
+  }
+  BOOST_CHECK_EQUAL(table.size(), 100);
+  BOOST_CHECK(table.capacity() >= 200);
+  for (const TcpConnectionPtr& conn : conns)
+  {
+    BOOST_CHECK(table.find(conn->id()) == conn);
+  }
+  BOOST_CHECK(!table.find(101));
+
+  BOOST_CHECK(table.erase(50));
+  BOOST_CHECK(!table.erase(50));
+  BOOST_CHECK(!table.find(50));
+  BOOST_CHECK(table.find(51) == conns[50]);
+  BOOST_CHECK_EQUAL(table.size(), 99);
+
+  int count = 0;
+  table.forEach([&count](TcpConnectionPtr& conn) {
+    ++count;
+    conn.reset();
+  });
+  BOOST_CHECK_EQUAL(count, 99);
+  BOOST_CHECK(!table.find(1));
+  // the ids stay
+  BOOST_CHECK_EQUAL(table.size(), 99);
+  BOOST_CHECK(table.erase(1));
+
+  for (const TcpConnectionPtr& conn : conns)
+  {
+    destroy(conn);
+  }
+}
+
+// ids colliding in their home slots, erased in random order
+BOOST_AUTO_TEST_CASE(testCollisions)
+{
+  EventLoop loop;
+  std::shared_ptr<const string> prefix(new string("Server#"));
+  std::mt19937 rng(0);
+  for (int round = 0; round < 20; ++round)
+  {
+    ConnectionTable table;
+    std::map<int64_t, TcpConnectionPtr> expected;
+    const size_t capacity = table.capacity();
+    std::uniform_int_distribution<int> home(0, 3);
+    for (int i = 0; i < 7; ++i)
+    {
+      int64_t id = static_cast<int64_t>(capacity) * (i + 1) + home(rng);
+      if (i % 2 == 0)
+      {
+        id = static_cast<int64_t>(capacity) * (i + 1) - 1;  // wraps around
+      }
+      TcpConnectionPtr conn = newConnection(&loop, id, prefix);
+      table.insert(id, conn);
+      expected[id] = conn;
+    }
+    BOOST_REQUIRE_EQUAL(table.capacity(), capacity);
+
+    std::vector<int64_t> ids;
+    for (const auto& item : expected)
+    {
+      ids.push_back(item.first);
+    }
+    std::shuffle(ids.begin(), ids.end(), rng);
+    for (int64_t id : ids)
+    {
+      BOOST_CHECK(table.erase(id));
+      destroy(expected[id]);
+      expected.erase(id);
+      BOOST_CHECK_EQUAL(table.size(), expected.size());
+      for (const auto& item : expected)
+      {
+        BOOST_CHECK(table.find(item.first) == item.second);
+      }
+    }
+  }
+}
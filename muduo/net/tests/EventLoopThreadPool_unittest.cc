@@ -2,6 +2,8 @@
 #include "muduo/net/EventLoop.h"
 #include "muduo/base/Thread.h"
 
+#include <vector>
+
 #include <stdio.h>
 #include <unistd.h>
 
@@ -63,6 +65,51 @@ int main()
     assert(nextLoop == model.getNextLoop());
   }
 
+  {
+    printf("Least connections:\n");
+    EventLoopThreadPool model(&loop, "least");
+    model.setThreadNum(3);
+    model.setStrategy(EventLoopThreadPool::kLeastConnections);
+    model.start(init);
+    std::vector<EventLoop*> loops = model.getAllLoops();
+    // ties go in turn
+    assert(model.getNextLoop() == loops[0]);
+    assert(model.getNextLoop() == loops[1]);
+    assert(model.getNextLoop() == loops[2]);
+    loops[0]->addConnections(2);
+    loops[2]->addConnections(1);
+    assert(model.getNextLoop() == loops[1]);
+    loops[1]->addConnections(3);
+    assert(model.getNextLoop() == loops[2]);
+    loops[0]->addConnections(-2);
+    assert(model.getNextLoop() == loops[0]);
+    loops[1]->addConnections(-3);
+    loops[2]->addConnections(-1);
+  }
+
+  {
+    printf("Two choices:\n");
+    EventLoopThreadPool model(&loop, "two");
+    model.setThreadNum(3);
+    model.setStrategy(EventLoopThreadPool::kTwoChoices);
+    model.start(init);
+    std::vector<EventLoop*> loops = model.getAllLoops();
+    loops[0]->addConnections(10);
+    loops[1]->addConnections(5);
+    // the most loaded loop is never the lesser of two
+    int chosen[3] = { 0, 0, 0 };
+    for (int i = 0; i < 300; ++i)
+    {
+      EventLoop* nextLoop = model.getNextLoop();
+      assert(nextLoop != loops[0]);
+      ++chosen[nextLoop == loops[1] ? 1 : 2];
+    }
+    printf("chosen %d, %d, %d times\n", chosen[0], chosen[1], chosen[2]);
+    assert(chosen[2] > chosen[1]);
+    loops[0]->addConnections(-10);
+    loops[1]->addConnections(-5);
+  }
+
   loop.loop();
 }
 
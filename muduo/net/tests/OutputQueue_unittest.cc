@@ -0,0 +1,423 @@
+#include "muduo/net/OutputQueue.h"
+#include "muduo/net/SocketsOps.h"
+
+//#define BOOST_TEST_MODULE OutputQueueTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using muduo::string;
+using muduo::net::Buffer;
+using muduo::net::OutputQueue;
+namespace sockets = muduo::net::sockets;
+
+namespace
+{
+
+string readAll(int fd, size_t len)
+{
+  string result;
+  char buf[65536];
+  while (result.size() < len)
+  {
+    ssize_t n = ::read(fd, buf, sizeof buf);
+    BOOST_REQUIRE(n > 0);
+    result.append(buf, n);
+  }
+  return result;
+}
+
+// a connected TCP pair over loopback, MSG_ZEROCOPY needs a real stream socket
+bool tcpPair(int fds[2])
+{
+  int listenfd = ::socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof addr);
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof addr;
+  bool ok = ::bind(listenfd, reinterpret_cast<struct sockaddr*>(&addr), len) == 0
+            && ::listen(listenfd, 1) == 0
+            && ::getsockname(listenfd, reinterpret_cast<struct sockaddr*>(&addr), &len) == 0;
+  fds[0] = ::socket(AF_INET, SOCK_STREAM, 0);
+  ok = ok && ::connect(fds[0], reinterpret_cast<struct sockaddr*>(&addr), len) == 0;
+  fds[1] = ok ? ::accept(listenfd, NULL, NULL) : -1;
+  ::close(listenfd);
+  return ok && fds[1] >= 0;
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_CASE(testOutputQueueOrder)
+{
+  int fds[2];
+  BOOST_REQUIRE_EQUAL(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+  OutputQueue queue;
+  BOOST_CHECK(queue.empty());
+  Buffer first;
+  first.append("first,");
+  queue.append(std::move(first));
+  std::shared_ptr<const string> shared(new string("0123456789"));
+  queue.append(shared, 4);
+  queue.append(Buffer());
+  queue.append(shared, shared->size());
+  BOOST_CHECK_EQUAL(queue.numChunks(), 2);
+  BOOST_CHECK_EQUAL(queue.readableBytes(), 12);
+
+  Buffer tail;
+  tail.append(",tail");
+  int savedErrno = 0;
+  BOOST_CHECK_EQUAL(queue.writeFd(fds[0], &tail, &savedErrno), 17);
+  BOOST_CHECK(queue.empty());
+  BOOST_CHECK_EQUAL(queue.readableBytes(), 0);
+  BOOST_CHECK_EQUAL(tail.readableBytes(), 0);
+  BOOST_CHECK_EQUAL(readAll(fds[1], 17), "first,456789,tail");
+  BOOST_CHECK_EQUAL(shared.use_count(), 1);
+
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
+
+BOOST_AUTO_TEST_CASE(testOutputQueuePartialWrite)
+{
+  int fds[2];
+  BOOST_REQUIRE_EQUAL(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  ::fcntl(fds[0], F_SETFL, O_NONBLOCK);
+
+  string body;
+  for (int i = 0; i < 1000000; ++i)
+  {
+    body.push_back(static_cast<char>(i % 251));
+  }
+  std::shared_ptr<const string> shared(new string(body));
+  OutputQueue queue;
+  queue.append(shared, 0);
+  queue.append(shared, 0);
+  Buffer tail;
+  tail.append("end");
+
+  string received;
+  int savedErrno = 0;
+  while (queue.readableBytes() + tail.readableBytes() > 0)
+  {
+    size_t before = queue.readableBytes() + tail.readableBytes();
+    ssize_t n = queue.writeFd(fds[0], &tail, &savedErrno);
+    BOOST_REQUIRE(n > 0 || savedErrno == EAGAIN);
+    if (n < 0)
+    {
+      received += readAll(fds[1], 1);
+      continue;
+    }
+    BOOST_CHECK_EQUAL(queue.readableBytes() + tail.readableBytes(), before - n);
+    received += readAll(fds[1], n);
+  }
+  received += readAll(fds[1], body.size() * 2 + 3 - received.size());
+  BOOST_CHECK(received == body + body + "end");
+  BOOST_CHECK_EQUAL(shared.use_count(), 1);
+
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
+
+// copied bytes coalesce into ChainBuffer chunks, in order with the others
+BOOST_AUTO_TEST_CASE(testOutputQueueChain)
+{
+  int fds[2];
+  BOOST_REQUIRE_EQUAL(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  ::fcntl(fds[0], F_SETFL, O_NONBLOCK);
+
+  string body;
+  for (int i = 0; i < 300000; ++i)
+  {
+    body.push_back(static_cast<char>(i % 251));
+  }
+  OutputQueue queue;
+  queue.append(body.data(), 0);
+  BOOST_CHECK(queue.empty());
+  Buffer first;
+  first.append("first,");
+  queue.append(std::move(first));
+  queue.append(body.data(), 100000);
+  queue.append(body.data() + 100000, body.size() - 100000);
+  BOOST_CHECK_EQUAL(queue.numChunks(), 2);
+  std::shared_ptr<const string> shared(new string("0123456789"));
+  queue.append(shared, 0);
+  queue.append(body.data(), body.size());
+  BOOST_CHECK_EQUAL(queue.numChunks(), 4);
+  BOOST_CHECK_EQUAL(queue.readableBytes(), 6 + body.size() * 2 + 10);
+  Buffer tail;
+  tail.append("end");
+
+  const string expected = "first," + body + "0123456789" + body + "end";
+  string received;
+  int savedErrno = 0;
+  while (queue.readableBytes() + tail.readableBytes() > 0)
+  {
+    size_t before = queue.readableBytes() + tail.readableBytes();
+    ssize_t n = queue.writeFd(fds[0], &tail, &savedErrno);
+    BOOST_REQUIRE(n > 0 || savedErrno == EAGAIN);
+    if (n < 0)
+    {
+      received += readAll(fds[1], 1);
+      continue;
+    }
+    BOOST_CHECK_EQUAL(queue.readableBytes() + tail.readableBytes(), before - n);
+    received += readAll(fds[1], n);
+  }
+  received += readAll(fds[1], expected.size() - received.size());
+  BOOST_CHECK(received == expected);
+  BOOST_CHECK_EQUAL(shared.use_count(), 1);
+
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
+
+BOOST_AUTO_TEST_CASE(testOutputQueueFile)
+{
+  int fds[2];
+  BOOST_REQUIRE_EQUAL(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  ::fcntl(fds[0], F_SETFL, O_NONBLOCK);
+
+  char path[] = "/tmp/outputqueue_unittest_XXXXXX";
+  int filefd = ::mkstemp(path);
+  BOOST_REQUIRE(filefd >= 0);
+  ::unlink(path);
+  string content;
+  for (int i = 0; i < 300000; ++i)
+  {
+    content.push_back(static_cast<char>('a' + i % 26));
+  }
+  BOOST_REQUIRE_EQUAL(::write(filefd, content.data(), content.size()),
+                      static_cast<ssize_t>(content.size()));
+
+  OutputQueue queue;
+  Buffer header;
+  header.append("header,");
+  queue.append(std::move(header));
+  const int dup1 = ::dup(filefd);
+  const int dup2 = ::dup(filefd);
+  queue.appendFile(dup1, 1000, 200000);
+  std::shared_ptr<const string> shared(new string(",shared"));
+  queue.append(shared, 0);
+  queue.appendFile(dup2, 299990, 10);
+  BOOST_CHECK_EQUAL(queue.numChunks(), 4);
+  BOOST_CHECK_EQUAL(queue.readableBytes(), 200024);
+  Buffer tail;
+  tail.append(",tail");
+
+  string received;
+  int savedErrno = 0;
+  while (queue.readableBytes() + tail.readableBytes() > 0)
+  {
+    ssize_t n = queue.writeFd(fds[0], &tail, &savedErrno);
+    BOOST_REQUIRE(n >= 0 || savedErrno == EAGAIN);
+    char buf[65536];
+    ssize_t nr = ::read(fds[1], buf, sizeof buf);
+    BOOST_REQUIRE(nr > 0);
+    received.append(buf, nr);
+  }
+  const string expected = "header," + content.substr(1000, 200000) + ",shared"
+                          + content.substr(299990) + ",tail";
+  received += readAll(fds[1], expected.size() - received.size());
+  BOOST_CHECK(received == expected);
+  // both are closed when done
+  BOOST_CHECK_EQUAL(::fcntl(dup1, F_GETFD), -1);
+  BOOST_CHECK_EQUAL(::fcntl(dup2, F_GETFD), -1);
+
+  ::close(filefd);
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
+
+// sendfile(2) fails for good on a pipe or a write-only file,
+// or a file ends before the promised length
+BOOST_AUTO_TEST_CASE(testOutputQueueFileError)
+{
+  int fds[2];
+  BOOST_REQUIRE(tcpPair(fds));
+  int pipefds[2];
+  BOOST_REQUIRE(::pipe(pipefds) == 0);
+  BOOST_REQUIRE(::write(pipefds[1], "data", 4) == 4);
+  int writeOnly = ::open("/dev/null", O_WRONLY);
+  BOOST_REQUIRE(writeOnly >= 0);
+
+  for (int filefd : { pipefds[0], writeOnly })
+  {
+    OutputQueue queue;
+    int dupfd = ::dup(filefd);
+    queue.appendFile(dupfd, 0, 4);
+    queue.append(std::make_shared<const string>("after"), 0);
+    Buffer tail;
+
+    int savedErrno = 0;
+    BOOST_CHECK_EQUAL(queue.writeFd(fds[0], &tail, &savedErrno), -1);
+    BOOST_CHECK(savedErrno != EAGAIN);
+    // the file is dropped and closed, the rest stays
+    BOOST_CHECK_EQUAL(queue.numChunks(), 1);
+    BOOST_CHECK_EQUAL(queue.readableBytes(), 5);
+    BOOST_CHECK_EQUAL(::fcntl(dupfd, F_GETFD), -1);
+  }
+
+  char path[] = "/tmp/outputqueue_unittest_XXXXXX";
+  int shortFile = ::mkstemp(path);
+  BOOST_REQUIRE(shortFile >= 0);
+  ::unlink(path);
+  BOOST_REQUIRE(::write(shortFile, "data", 4) == 4);
+  {
+    OutputQueue queue;
+    int dupfd = ::dup(shortFile);
+    queue.appendFile(dupfd, 0, 8);
+    queue.append(std::make_shared<const string>("after"), 0);
+    Buffer tail;
+
+    int savedErrno = 0;
+    BOOST_CHECK_EQUAL(queue.writeFd(fds[0], &tail, &savedErrno), 4);
+    BOOST_CHECK_EQUAL(queue.readableBytes(), 9);
+    // nothing after the file is written in its place
+    BOOST_CHECK_EQUAL(queue.writeFd(fds[0], &tail, &savedErrno), -1);
+    BOOST_CHECK_EQUAL(savedErrno, EIO);
+    BOOST_CHECK_EQUAL(queue.numChunks(), 1);
+    BOOST_CHECK_EQUAL(queue.readableBytes(), 5);
+    BOOST_CHECK_EQUAL(::fcntl(dupfd, F_GETFD), -1);
+    BOOST_CHECK_EQUAL(readAll(fds[1], 4), "data");
+  }
+
+  ::close(shortFile);
+  ::close(writeOnly);
+  ::close(pipefds[0]);
+  ::close(pipefds[1]);
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
+
+BOOST_AUTO_TEST_CASE(testOutputQueueZeroCopy)
+{
+  int fds[2];
+  BOOST_REQUIRE(tcpPair(fds));
+  int on = 1;
+  if (::setsockopt(fds[0], SOL_SOCKET, SO_ZEROCOPY, &on, sizeof on) < 0)
+  {
+    BOOST_TEST_MESSAGE("SO_ZEROCOPY is not supported, skipped");
+    ::close(fds[0]);
+    ::close(fds[1]);
+    return;
+  }
+  ::fcntl(fds[0], F_SETFL, O_NONBLOCK);
+
+  string body;
+  for (int i = 0; i < 1000000; ++i)
+  {
+    body.push_back(static_cast<char>(i % 253));
+  }
+  std::shared_ptr<const string> shared(new string(body));
+  OutputQueue queue;
+  queue.append(shared, 0, true);
+  Buffer middle;
+  middle.append("middle");
+  queue.append(std::move(middle));
+  Buffer owned;
+  owned.append(body);
+  queue.append(std::move(owned), true);
+  BOOST_CHECK_EQUAL(queue.numChunks(), 3);
+  Buffer tail;
+  tail.append("end");
+
+  string received;
+  int savedErrno = 0;
+  while (queue.readableBytes() + tail.readableBytes() > 0)
+  {
+    ssize_t n = queue.writeFd(fds[0], &tail, &savedErrno);
+    BOOST_REQUIRE(n >= 0 || savedErrno == EAGAIN);
+    char buf[65536];
+    ssize_t nr = ::read(fds[1], buf, sizeof buf);
+    BOOST_REQUIRE(nr > 0);
+    received.append(buf, nr);
+  }
+  const string expected = body + "middle" + body + "end";
+  received += readAll(fds[1], expected.size() - received.size());
+  BOOST_CHECK(received == expected);
+  // written, but kept until completed
+  BOOST_CHECK_EQUAL(queue.numPinned(), 2);
+  BOOST_CHECK_EQUAL(shared.use_count(), 2);
+
+  while (queue.numPinned() > 0)
+  {
+    struct pollfd pfd = { fds[0], 0, 0 };
+    BOOST_REQUIRE_EQUAL(::poll(&pfd, 1, 1000), 1);
+    BOOST_REQUIRE(pfd.revents & POLLERR);
+    uint32_t lo = 0;
+    uint32_t hi = 0;
+    bool copied = false;
+    while (sockets::readZeroCopyCompletion(fds[0], &lo, &hi, &copied) > 0)
+    {
+      BOOST_CHECK(lo <= hi);
+      queue.completeZeroCopy(lo, hi, copied);
+    }
+  }
+  BOOST_CHECK_EQUAL(shared.use_count(), 1);
+  // loopback never sends in place
+  BOOST_CHECK(queue.numZeroCopyCopied() > 0);
+
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
+
+// A closed connection drops what is not written, but keeps the chunk
+// partly written with MSG_ZEROCOPY until completed.
+BOOST_AUTO_TEST_CASE(testOutputQueueDropUnwritten)
+{
+  int fds[2];
+  BOOST_REQUIRE(tcpPair(fds));
+  int on = 1;
+  if (::setsockopt(fds[0], SOL_SOCKET, SO_ZEROCOPY, &on, sizeof on) < 0)
+  {
+    BOOST_TEST_MESSAGE("SO_ZEROCOPY is not supported, skipped");
+    ::close(fds[0]);
+    ::close(fds[1]);
+    return;
+  }
+  ::fcntl(fds[0], F_SETFL, O_NONBLOCK);
+
+  // larger than the socket buffers
+  std::shared_ptr<const string> shared(new string(32 * 1024 * 1024, 'x'));
+  OutputQueue queue;
+  queue.append(shared, 0, true);
+  queue.append(std::make_shared<const string>("after"), 0);
+  Buffer tail;
+  int savedErrno = 0;
+  const ssize_t n = queue.writeFd(fds[0], &tail, &savedErrno);
+  BOOST_REQUIRE(n > 0);
+  BOOST_REQUIRE(static_cast<size_t>(n) < shared->size());
+  BOOST_CHECK_EQUAL(queue.numPinned(), 0);
+
+  queue.dropUnwritten();
+  BOOST_CHECK(queue.empty());
+  BOOST_CHECK_EQUAL(queue.readableBytes(), 0);
+  BOOST_CHECK_EQUAL(queue.numPinned(), 1);
+  BOOST_CHECK_EQUAL(shared.use_count(), 2);
+
+  BOOST_CHECK_EQUAL(readAll(fds[1], n).size(), static_cast<size_t>(n));
+  while (queue.numPinned() > 0)
+  {
+    struct pollfd pfd = { fds[0], 0, 0 };
+    BOOST_REQUIRE_EQUAL(::poll(&pfd, 1, 1000), 1);
+    uint32_t lo = 0;
+    uint32_t hi = 0;
+    bool copied = false;
+    while (sockets::readZeroCopyCompletion(fds[0], &lo, &hi, &copied) > 0)
+    {
+      queue.completeZeroCopy(lo, hi, copied);
+    }
+  }
+  BOOST_CHECK_EQUAL(shared.use_count(), 1);
+
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
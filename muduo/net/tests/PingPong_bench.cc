@@ -0,0 +1,183 @@
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/TcpServer.h"
+
+#include "muduo/base/CountDownLatch.h"
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThread.h"
+#include "muduo/net/InetAddress.h"
+#include "muduo/net/poller/IoUringPoller.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// Pingpong between sessions clients and an echo server over loopback, in
+// one process, for each Poller backend, with level-triggered and with
+// edge-triggered server connections, reports throughput and CPU time.
+//
+// usage: pingpong_bench [sessions [block_size [seconds [port]]]]
+
+double cpuSeconds()
+{
+  struct rusage usage;
+  ::getrusage(RUSAGE_SELF, &usage);
+  return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec)
+      + static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+}
+
+class Client : noncopyable
+{
+ public:
+  Client(EventLoop* loop, const InetAddress& serverAddr,
+         int sessionCount, size_t blockSize)
+    : loop_(loop),
+      message_(blockSize, 'p'),
+      numConnected_(0),
+      bytesRead_(0),
+      messagesRead_(0)
+  {
+    for (int i = 0; i < sessionCount; ++i)
+    {
+      TcpClient* client = new TcpClient(loop, serverAddr, "PingPong");
+      client->setConnectionCallback(
+          std::bind(&Client::onConnection, this, _1));
+      client->setMessageCallback(
+          std::bind(&Client::onMessage, this, _1, _2, _3));
+      clients_.emplace_back(client);
+    }
+  }
+
+  void start()
+  {
+    for (auto& client : clients_)
+    {
+      client->connect();
+    }
+  }
+
+  void stop()
+  {
+    for (auto& client : clients_)
+    {
+      client->disconnect();
+    }
+  }
+
+  int64_t bytesRead() const { return bytesRead_; }
+  int64_t messagesRead() const { return messagesRead_; }
+
+ private:
+  void onConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      conn->setTcpNoDelay(true);
+      ++numConnected_;
+      conn->send(message_);
+    }
+    else if (--numConnected_ == 0)
+    {
+      loop_->quit();
+    }
+  }
+
+  void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+  {
+    bytesRead_ += static_cast<int64_t>(buf->readableBytes());
+    ++messagesRead_;
+    conn->send(buf);
+  }
+
+  EventLoop* loop_;
+  const string message_;
+  std::vector<std::unique_ptr<TcpClient>> clients_;
+  int numConnected_;
+  int64_t bytesRead_;
+  int64_t messagesRead_;
+};
+
+void startEchoServer(EventLoop* loop, const InetAddress& listenAddr, bool edgeTriggered,
+                     std::unique_ptr<TcpServer>* server, CountDownLatch* latch)
+{
+  server->reset(new TcpServer(loop, listenAddr, "Echo"));
+  (*server)->setEdgeTriggered(edgeTriggered);
+  (*server)->setConnectionCallback([](const TcpConnectionPtr& conn) {
+    if (conn->connected())
+    {
+      conn->setTcpNoDelay(true);
+    }
+  });
+  (*server)->setMessageCallback(
+      [](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) { conn->send(buf); });
+  (*server)->start();
+  latch->countDown();
+}
+
+// the Poller is chosen when an EventLoop is constructed
+void bench(const char* backend, bool edgeTriggered, int sessionCount, size_t blockSize,
+           double seconds, uint16_t port)
+{
+  EventLoopThread serverThread;
+  EventLoop* serverLoop = serverThread.startLoop();
+  std::unique_ptr<TcpServer> server;
+  CountDownLatch started(1);
+  serverLoop->runInLoop(
+      std::bind(startEchoServer, serverLoop, InetAddress(port), edgeTriggered,
+                &server, &started));
+  started.wait();
+
+  EventLoop loop;
+  Client client(&loop, InetAddress("127.0.0.1", port), sessionCount, blockSize);
+  double cpuStart = cpuSeconds();
+  Timestamp start(Timestamp::now());
+  int64_t bytes = 0;
+  int64_t messages = 0;
+  loop.runAfter(seconds, [&] {
+    bytes = client.bytesRead();
+    messages = client.messagesRead();
+    client.stop();
+  });
+  client.start();
+  loop.loop();
+  double elapsed = timeDifference(Timestamp::now(), start);
+  double cpu = cpuSeconds() - cpuStart;
+  printf("%-10s %-5s %8.2f MiB/s %10.0f msgs/s %8.2f us cpu per msg\n",
+         backend, edgeTriggered ? "edge" : "level",
+         static_cast<double>(bytes) / elapsed / 1024 / 1024,
+         static_cast<double>(messages) / elapsed,
+         messages > 0 ? cpu / static_cast<double>(messages) * 1e6 : 0.0);
+
+  CountDownLatch stopped(1);
+  serverLoop->runInLoop([&] { server.reset(); stopped.countDown(); });
+  stopped.wait();
+}
+
+int main(int argc, char* argv[])
+{
+  Logger::setLogLevel(Logger::WARN);
+  int sessionCount = argc > 1 ? atoi(argv[1]) : 100;
+  size_t blockSize = argc > 2 ? atoi(argv[2]) : 16384;
+  double seconds = argc > 3 ? atof(argv[3]) : 5;
+  uint16_t port = static_cast<uint16_t>(argc > 4 ? atoi(argv[4]) : 9998);
+
+  printf("%d sessions, %zu bytes per block, %.1f seconds\n",
+         sessionCount, blockSize, seconds);
+  ::unsetenv("MUDUO_USE_POLL");
+  ::unsetenv("MUDUO_USE_IOURING");
+  bench("epoll", false, sessionCount, blockSize, seconds, port);
+  bench("epoll", true, sessionCount, blockSize, seconds, port);
+  if (IoUringPoller::available())
+  {
+    ::setenv("MUDUO_USE_IOURING", "1", 1);
+    bench("io_uring", false, sessionCount, blockSize, seconds, port);
+    bench("io_uring", true, sessionCount, blockSize, seconds, port);
+  }
+  else
+  {
+    printf("io_uring is not available\n");
+  }
+}
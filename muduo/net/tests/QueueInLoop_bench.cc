@@ -0,0 +1,165 @@
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThreadPool.h"
+
+#include "muduo/base/CountDownLatch.h"
+#include "muduo/base/MpscQueue.h"
+#include "muduo/base/Mutex.h"
+#include "muduo/base/Timestamp.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// Many threads posting functors to a few loops, as worker threads
+// sending responses through their connections' IO loops.
+//
+// usage: queueinloop_bench [producers [loops [functors_per_producer]]]
+
+// what EventLoop::queueInLoop used to do
+class MutexQueue : noncopyable
+{
+ public:
+  void push(EventLoop::Functor&& cb)
+  {
+    MutexLockGuard lock(mutex_);
+    functors_.push_back(std::move(cb));
+  }
+
+  size_t runAll()
+  {
+    std::vector<EventLoop::Functor> functors;
+    {
+      MutexLockGuard lock(mutex_);
+      functors.swap(functors_);
+    }
+    for (const EventLoop::Functor& functor : functors)
+    {
+      functor();
+    }
+    return functors.size();
+  }
+
+ private:
+  MutexLock mutex_;
+  std::vector<EventLoop::Functor> functors_ GUARDED_BY(mutex_);
+};
+
+class LockFreeQueue : noncopyable
+{
+ public:
+  void push(EventLoop::Functor&& cb)
+  {
+    queue_.push(std::move(cb));
+  }
+
+  size_t runAll()
+  {
+    size_t n = 0;
+    EventLoop::Functor functor;
+    while (queue_.pop(&functor))
+    {
+      functor();
+      ++n;
+    }
+    return n;
+  }
+
+ private:
+  MpscQueue<EventLoop::Functor> queue_;
+};
+
+// the queue alone, one consumer busy polling it
+template<typename QUEUE>
+void benchQueue(const char* name, int numProducers, int numFunctors)
+{
+  QUEUE queue;
+  int64_t sum = 0;
+  const size_t total = static_cast<size_t>(numProducers) * numFunctors;
+  Timestamp start(Timestamp::now());
+  std::vector<std::thread> producers;
+  for (int p = 0; p < numProducers; ++p)
+  {
+    producers.emplace_back([&queue, &sum, numFunctors] {
+      for (int i = 0; i < numFunctors; ++i)
+      {
+        queue.push([&sum] { ++sum; });
+      }
+    });
+  }
+  size_t done = 0;
+  while (done < total)
+  {
+    done += queue.runAll();
+  }
+  double seconds = timeDifference(Timestamp::now(), start);
+  for (std::thread& t : producers)
+  {
+    t.join();
+  }
+  printf("%-16s %3d producers %10.0f functors/s\n",
+         name, numProducers, static_cast<double>(total) / seconds);
+}
+
+// through EventLoop::queueInLoop, with wakeups
+void benchLoops(int numProducers, int numLoops, int numFunctors)
+{
+  EventLoop baseLoop;
+  EventLoopThreadPool pool(&baseLoop, "bench");
+  pool.setThreadNum(numLoops);
+  pool.start();
+  std::vector<EventLoop*> loops = pool.getAllLoops();
+
+  const int64_t total = static_cast<int64_t>(numProducers) * numFunctors;
+  std::atomic<int64_t> done(0);
+  CountDownLatch latch(1);
+  Timestamp start(Timestamp::now());
+  std::vector<std::thread> producers;
+  for (int p = 0; p < numProducers; ++p)
+  {
+    producers.emplace_back([&, p] {
+      for (int i = 0; i < numFunctors; ++i)
+      {
+        loops[(p + i) % loops.size()]->queueInLoop([&] {
+          if (done.fetch_add(1, std::memory_order_relaxed) + 1 == total)
+          {
+            latch.countDown();
+          }
+        });
+      }
+    });
+  }
+  latch.wait();
+  double seconds = timeDifference(Timestamp::now(), start);
+  for (std::thread& t : producers)
+  {
+    t.join();
+  }
+  int64_t wakeups = 0;
+  for (EventLoop* loop : loops)
+  {
+    wakeups += loop->numWakeups();
+  }
+  printf("%-16s %3d producers %3d loops %10.0f functors/s  %lld wakeups\n",
+         "queueInLoop", numProducers, numLoops, static_cast<double>(total) / seconds,
+         static_cast<long long>(wakeups));
+}
+
+int main(int argc, char* argv[])
+{
+  int numProducers = argc > 1 ? atoi(argv[1]) : 32;
+  int numLoops = argc > 2 ? atoi(argv[2]) : 8;
+  int numFunctors = argc > 3 ? atoi(argv[3]) : 100000;
+
+  for (int producers = 1; producers <= numProducers; producers *= 2)
+  {
+    benchQueue<MutexQueue>("mutex+vector", producers, numFunctors);
+    benchQueue<LockFreeQueue>("MpscQueue", producers, numFunctors);
+  }
+  benchLoops(numProducers, numLoops, numFunctors);
+}
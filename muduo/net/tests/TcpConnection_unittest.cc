@@ -0,0 +1,768 @@
+#include "muduo/net/TcpConnection.h"
+
+#include "muduo/base/CountDownLatch.h"
+#include "muduo/net/BufferPool.h"
+#include "muduo/net/ChainBuffer.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThread.h"
+
+//#define BOOST_TEST_MODULE TcpConnectionTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using muduo::CountDownLatch;
+using muduo::string;
+using muduo::net::Buffer;
+using muduo::net::BufferPool;
+using muduo::net::ChainBuffer;
+using muduo::net::EventLoop;
+using muduo::net::EventLoopThread;
+using muduo::net::InetAddress;
+using muduo::net::TcpConnection;
+using muduo::net::TcpConnectionPtr;
+
+namespace
+{
+
+// a connected TCP pair over loopback
+bool tcpPair(int fds[2])
+{
+  int listenfd = ::socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof addr);
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof addr;
+  bool ok = ::bind(listenfd, reinterpret_cast<struct sockaddr*>(&addr), len) == 0
+            && ::listen(listenfd, 1) == 0
+            && ::getsockname(listenfd, reinterpret_cast<struct sockaddr*>(&addr), &len) == 0;
+  fds[0] = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  ok = ok && (::connect(fds[0], reinterpret_cast<struct sockaddr*>(&addr), len) == 0
+              || errno == EINPROGRESS);
+  fds[1] = ok ? ::accept(listenfd, NULL, NULL) : -1;
+  ::close(listenfd);
+  return ok && fds[1] >= 0;
+}
+
+// bytes that differ from their neighbours, so misordering shows
+string pattern(size_t len)
+{
+  string data;
+  data.reserve(len);
+  for (size_t i = 0; i < len; ++i)
+  {
+    data.push_back(static_cast<char>(i % 251));
+  }
+  return data;
+}
+
+// Reads @c len bytes, or until nothing comes for a few seconds.
+string readExactly(int fd, size_t len)
+{
+  string received;
+  char buf[65536];
+  while (received.size() < len)
+  {
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    if (::poll(&pfd, 1, 5000) <= 0)
+    {
+      break;
+    }
+    ssize_t n = ::read(fd, buf, std::min(sizeof buf, len - received.size()));
+    if (n <= 0)
+    {
+      break;
+    }
+    received.append(buf, n);
+  }
+  return received;
+}
+
+void setBufferSizes(int fd, int bytes)
+{
+  ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof bytes);
+  ::setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &bytes, sizeof bytes);
+}
+
+// Bytes which have arrived at @c fd, once no more come.
+int waitForBytes(int fd)
+{
+  int available = 0;
+  for (int i = 0, last = -1; i < 500 && available != last; ++i)
+  {
+    last = available;
+    ::usleep(20 * 1000);
+    ::ioctl(fd, FIONREAD, &available);
+  }
+  return available;
+}
+
+// Reads until EOF, or until nothing comes for a few seconds.
+// Returns true on EOF.
+bool readUntilEof(int fd, string* received)
+{
+  for (;;)
+  {
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    if (::poll(&pfd, 1, 5000) <= 0)
+    {
+      return false;
+    }
+    char buf[65536];
+    ssize_t n = ::read(fd, buf, sizeof buf);
+    if (n <= 0)
+    {
+      return n == 0;
+    }
+    received->append(buf, n);
+  }
+}
+
+///
+/// A TcpConnection in a loop thread over one end of a loopback TCP pair,
+/// the test thread is the peer on the other end, with blocking I/O.
+/// Owned in the loop, like TcpServer does, so the socket is closed once
+/// the connection is closed and the test has let go of it.
+///
+class ConnectionFixture : muduo::noncopyable
+{
+ public:
+  typedef std::function<void(const TcpConnectionPtr&)> SetupCallback;
+
+  /// @c setup runs in loop before the connection is established
+  explicit ConnectionFixture(bool edgeTriggered,
+                             const SetupCallback& setup = SetupCallback())
+    : loop_(loopThread_.startLoop()),
+      destroyed_(1),
+      local_(-1),
+      peer_(-1)
+  {
+    int fds[2];
+    BOOST_REQUIRE(tcpPair(fds));
+    local_ = fds[0];
+    peer_ = fds[1];
+    CountDownLatch established(1);
+    loop_->runInLoop([&] {
+      owner_.reset(new TcpConnection(loop_, "conn", fds[0],
+                                     InetAddress(), InetAddress()));
+      owner_->setConnectionCallback(muduo::net::defaultConnectionCallback);
+      owner_->setEdgeTriggered(edgeTriggered);
+      owner_->setCloseCallback([this](const TcpConnectionPtr& conn) {
+        owner_.reset();
+        loop_->queueInLoop([this, conn] {
+          conn->connectDestroyed();
+          destroyed_.countDown();
+        });
+      });
+      if (setup)
+      {
+        setup(owner_);
+      }
+      owner_->connectEstablished();
+      conn_ = owner_;
+      established.countDown();
+    });
+    established.wait();
+  }
+
+  ~ConnectionFixture()
+  {
+    TcpConnectionPtr conn(conn_.lock());
+    if (conn)
+    {
+      conn->forceClose();
+    }
+    conn.reset();
+    destroyed_.wait();
+    ::close(peer_);
+  }
+
+  /// null once closed
+  TcpConnectionPtr conn() const { return conn_.lock(); }
+  EventLoop* loop() const { return loop_; }
+  /// the connection's end, for socket options only
+  int local() const { return local_; }
+  int peer() const { return peer_; }
+
+  /// Runs @c cb in loop and waits for it.
+  void runInLoop(const std::function<void()>& cb)
+  {
+    CountDownLatch done(1);
+    loop_->runInLoop([&] {
+      cb();
+      done.countDown();
+    });
+    done.wait();
+  }
+
+ private:
+  EventLoopThread loopThread_;
+  EventLoop* loop_;
+  CountDownLatch destroyed_;
+  TcpConnectionPtr owner_;  // in loop
+  std::weak_ptr<TcpConnection> conn_;
+  int local_;
+  int peer_;
+};
+
+}  // namespace
+
+// A file that sendfile(2) can't read, eg. a pipe or write-only, closes the
+// connection, rather than waiting for the socket to become writable forever.
+BOOST_AUTO_TEST_CASE(testSendFileError)
+{
+  int pipefds[2];
+  BOOST_REQUIRE(::pipe(pipefds) == 0);
+  BOOST_REQUIRE(::write(pipefds[1], "data", 4) == 4);
+  int writeOnly = ::open("/dev/null", O_WRONLY | O_CLOEXEC);
+  BOOST_REQUIRE(writeOnly >= 0);
+
+  for (bool edgeTriggered : { false, true })
+  {
+    for (int filefd : { pipefds[0], writeOnly })
+    {
+      // right away
+      {
+        ConnectionFixture fixture(edgeTriggered);
+        TcpConnectionPtr conn(fixture.conn());
+        conn->sendFile(filefd, 0, 4);
+        conn.reset();
+        string received;
+        BOOST_CHECK(readUntilEof(fixture.peer(), &received));
+        BOOST_CHECK_EQUAL(received.size(), 0);
+      }
+
+      // after a message larger than the socket buffers
+      {
+        ConnectionFixture fixture(edgeTriggered);
+        const string message(32 * 1024 * 1024, 'x');
+        TcpConnectionPtr conn(fixture.conn());
+        conn->send(string(message));
+        conn->sendFile(filefd, 0, 4);
+        conn->send(string("after"));
+        conn.reset();
+        string received;
+        BOOST_CHECK(readUntilEof(fixture.peer(), &received));
+        BOOST_CHECK(received == message);
+      }
+    }
+  }
+
+  // the dup()ed fds are closed, so the pipe has no reader left
+  ::close(pipefds[0]);
+  BOOST_CHECK_EQUAL(::write(pipefds[1], "data", 4), -1);
+  BOOST_CHECK_EQUAL(errno, EPIPE);
+  ::close(pipefds[1]);
+  ::close(writeOnly);
+}
+
+// A file shorter than the length promised closes the connection after what
+// it has, rather than stalling or sending what comes after in its place.
+BOOST_AUTO_TEST_CASE(testSendFileShort)
+{
+  char path[] = "/tmp/tcpconnection_unittest_XXXXXX";
+  int filefd = ::mkstemp(path);
+  BOOST_REQUIRE(filefd >= 0);
+  ::unlink(path);
+  BOOST_REQUIRE(::write(filefd, "data", 4) == 4);
+
+  for (bool edgeTriggered : { false, true })
+  {
+    // ends part way, and before the offset
+    for (off_t offset : { 0, 10 })
+    {
+      const string expected = offset == 0 ? "data" : "";
+      {
+        ConnectionFixture fixture(edgeTriggered);
+        TcpConnectionPtr conn(fixture.conn());
+        conn->sendFile(filefd, offset, 8);
+        conn->send(string("after"));
+        conn.reset();
+        string received;
+        BOOST_CHECK(readUntilEof(fixture.peer(), &received));
+        BOOST_CHECK_EQUAL(received, expected);
+      }
+
+      // after a message larger than the socket buffers
+      {
+        ConnectionFixture fixture(edgeTriggered);
+        const string message(32 * 1024 * 1024, 'x');
+        TcpConnectionPtr conn(fixture.conn());
+        conn->send(string(message));
+        conn->sendFile(filefd, offset, 8);
+        conn->send(string("after"));
+        conn.reset();
+        string received;
+        BOOST_CHECK(readUntilEof(fixture.peer(), &received));
+        BOOST_CHECK(received == message + expected);
+      }
+    }
+  }
+  ::close(filefd);
+}
+
+// Edge-triggered, reading stopped and started again in one loop iteration,
+// with data left in the socket, which brings no new edge.
+BOOST_AUTO_TEST_CASE(testRestartReadingEdgeTriggered)
+{
+  std::atomic<size_t> received(0);
+  std::atomic<int> restarts(0);
+  ConnectionFixture fixture(true, [&](const TcpConnectionPtr& conn) {
+    conn->setMessageCallback([&](const TcpConnectionPtr& c, muduo::net::Buffer* buf,
+                                 muduo::Timestamp) {
+      received += buf->readableBytes();
+      buf->retrieveAll();
+      if (restarts++ < 10)
+      {
+        c->stopRead();
+        c->getLoop()->queueInLoop([c] { c->startRead(); });
+      }
+    });
+  });
+  TcpConnectionPtr conn(fixture.conn());
+  conn->stopRead();
+
+  // more than one read, held in the socket until reading starts
+  const size_t kBytes = 4 * 1024 * 1024;
+  std::thread writer([&fixture, kBytes] {
+    const string data(kBytes, 'x');
+    size_t written = 0;
+    while (written < kBytes)
+    {
+      ssize_t n = ::write(fixture.peer(), data.data() + written, kBytes - written);
+      if (n <= 0)
+      {
+        break;
+      }
+      written += n;
+    }
+  });
+  ::usleep(100 * 1000);
+  conn->startRead();
+  conn.reset();
+  for (int i = 0; i < 500 && received < kBytes; ++i)
+  {
+    ::usleep(10 * 1000);
+  }
+  BOOST_CHECK_EQUAL(received.load(), kBytes);
+  BOOST_CHECK(restarts > 10);
+  if (received < kBytes)
+  {
+    ::shutdown(fixture.peer(), SHUT_RDWR);
+  }
+  writer.join();
+}
+
+// Read into a ChainBuffer and echoed back with copying sends, which queue
+// ChainBuffer chunks too, both drawing their blocks from the loop's pool.
+BOOST_AUTO_TEST_CASE(testChainBufferEcho)
+{
+  for (bool edgeTriggered : { false, true })
+  {
+    std::atomic<int64_t> poolHits(-1);
+    ConnectionFixture fixture(edgeTriggered, [&](const TcpConnectionPtr& conn) {
+      poolHits = BufferPool::current()->numHits();
+      conn->setChainMessageCallback([](const TcpConnectionPtr& c, ChainBuffer* buf,
+                                       muduo::Timestamp) {
+        while (buf->readableBytes() > 0)
+        {
+          size_t n = buf->contiguousBytes();
+          c->send(buf->peek(), static_cast<int>(n));
+          buf->retrieve(n);
+        }
+      });
+    });
+
+    const size_t kBytes = 8 * 1024 * 1024;
+    string data;
+    for (size_t i = 0; i < kBytes; ++i)
+    {
+      data.push_back(static_cast<char>(i % 251));
+    }
+    std::thread writer([&fixture, &data] {
+      size_t written = 0;
+      while (written < data.size())
+      {
+        ssize_t n = ::write(fixture.peer(), data.data() + written, data.size() - written);
+        if (n <= 0)
+        {
+          break;
+        }
+        written += n;
+      }
+    });
+    string received;
+    char buf[65536];
+    while (received.size() < kBytes)
+    {
+      struct pollfd pfd = { fixture.peer(), POLLIN, 0 };
+      if (::poll(&pfd, 1, 5000) <= 0)
+      {
+        break;
+      }
+      ssize_t n = ::read(fixture.peer(), buf, sizeof buf);
+      if (n <= 0)
+      {
+        break;
+      }
+      received.append(buf, n);
+    }
+    BOOST_CHECK(received == data);
+    if (received.size() < kBytes)
+    {
+      ::shutdown(fixture.peer(), SHUT_RDWR);
+    }
+    writer.join();
+
+    CountDownLatch checked(1);
+    fixture.loop()->runInLoop([&] {
+      BOOST_CHECK(BufferPool::current()->numHits() > poolHits + 100);
+      checked.countDown();
+    });
+    checked.wait();
+  }
+}
+
+// Sends more than the socket buffers hold, of each kind of chunk, to a
+// peer which reads only later.  Edge-triggered, a full socket waits for
+// EPOLLOUT quietly, rather than retrying every iteration.
+BOOST_AUTO_TEST_CASE(testLargeTransfer)
+{
+  const size_t kPart = 4 * 1024 * 1024;
+  const string data = pattern(3 * kPart);
+  for (bool edgeTriggered : { false, true })
+  {
+    std::atomic<int> writeCompletes(0);
+    ConnectionFixture fixture(edgeTriggered, [&](const TcpConnectionPtr& conn) {
+      conn->setWriteCompleteCallback([&](const TcpConnectionPtr&) { ++writeCompletes; });
+    });
+    TcpConnectionPtr conn(fixture.conn());
+    fixture.runInLoop([&] {
+      conn->send(data.data(), static_cast<int>(kPart));
+      conn->send(std::make_shared<const string>(data.substr(kPart, kPart)));
+      Buffer buf;
+      buf.append(data.data() + 2 * kPart, kPart);
+      conn->send(std::move(buf));
+    });
+
+    ::usleep(100 * 1000);
+    int64_t before = 0;
+    size_t bytesToWrite = 0;
+    fixture.runInLoop([&] { before = fixture.loop()->iteration(); });
+    ::usleep(200 * 1000);
+    int64_t after = 0;
+    fixture.runInLoop([&] {
+      after = fixture.loop()->iteration();
+      bytesToWrite = conn->bytesToWrite();
+    });
+    BOOST_CHECK(bytesToWrite > 0);
+    BOOST_CHECK_LT(after - before, 10);
+
+    BOOST_CHECK(readExactly(fixture.peer(), data.size()) == data);
+    fixture.runInLoop([&] { bytesToWrite = conn->bytesToWrite(); });
+    BOOST_CHECK_EQUAL(bytesToWrite, 0);
+    BOOST_CHECK_EQUAL(writeCompletes.load(), 1);
+  }
+}
+
+// Edge-triggered, one readiness reads everything in the socket.
+BOOST_AUTO_TEST_CASE(testEdgeTriggeredReadUntilEagain)
+{
+  std::map<int64_t, size_t> bytesByIteration;  // in loop
+  string received;
+  ConnectionFixture fixture(true, [&](const TcpConnectionPtr& conn) {
+    conn->setMessageCallback([&](const TcpConnectionPtr& c, Buffer* buf, muduo::Timestamp) {
+      bytesByIteration[c->getLoop()->iteration()] += buf->readableBytes();
+      received += buf->retrieveAllAsString();
+    });
+  });
+  setBufferSizes(fixture.local(), 1024 * 1024);
+  setBufferSizes(fixture.peer(), 1024 * 1024);
+  TcpConnectionPtr conn(fixture.conn());
+  fixture.runInLoop([&] { conn->stopRead(); });
+
+  // more than one read, less than the budget
+  const string data = pattern(160 * 1024);
+  std::thread writer([&fixture, &data] {
+    BOOST_CHECK_EQUAL(::write(fixture.peer(), data.data(), data.size()),
+                      static_cast<ssize_t>(data.size()));
+  });
+  BOOST_REQUIRE_EQUAL(waitForBytes(fixture.local()), static_cast<int>(data.size()));
+  writer.join();
+
+  conn->startRead();
+  for (int i = 0; i < 500; ++i)
+  {
+    size_t size = 0;
+    fixture.runInLoop([&] { size = received.size(); });
+    if (size == data.size())
+    {
+      break;
+    }
+    ::usleep(10 * 1000);
+  }
+  fixture.runInLoop([&] {
+    BOOST_CHECK(received == data);
+    BOOST_CHECK_EQUAL(bytesByIteration.size(), 1);
+  });
+}
+
+// Edge-triggered, a connection reads or writes about 256KiB, then hands the
+// loop to others and resumes in a later iteration.  Checked with socket
+// buffers larger than that, as far as the system allows.
+BOOST_AUTO_TEST_CASE(testEdgeTriggeredBudget)
+{
+  const size_t kBudget = 256 * 1024;
+  // one handleRead() or writeOutput() stops past the budget, by less than
+  // one read or sendfile(2), and may resume in the same iteration once
+  const size_t kMaxPerIteration = 2 * (kBudget + 64 * 1024 + Buffer::kInitialSize);
+  const string data = pattern(4 * 1024 * 1024);
+
+  // reading
+  {
+    std::map<int64_t, size_t> bytesByIteration;  // in loop
+    string received;
+    ConnectionFixture fixture(true, [&](const TcpConnectionPtr& conn) {
+      conn->setMessageCallback([&](const TcpConnectionPtr& c, Buffer* buf, muduo::Timestamp) {
+        bytesByIteration[c->getLoop()->iteration()] += buf->readableBytes();
+        received += buf->retrieveAllAsString();
+      });
+    });
+    setBufferSizes(fixture.local(), 8 * 1024 * 1024);
+    setBufferSizes(fixture.peer(), 8 * 1024 * 1024);
+    TcpConnectionPtr conn(fixture.conn());
+    fixture.runInLoop([&] { conn->stopRead(); });
+    std::thread writer([&fixture, &data] {
+      BOOST_CHECK_EQUAL(::write(fixture.peer(), data.data(), data.size()),
+                        static_cast<ssize_t>(data.size()));
+    });
+    const size_t available = waitForBytes(fixture.local());
+
+    conn->startRead();
+    for (int i = 0; i < 500; ++i)
+    {
+      size_t size = 0;
+      fixture.runInLoop([&] { size = received.size(); });
+      if (size == data.size())
+      {
+        break;
+      }
+      ::usleep(10 * 1000);
+    }
+    writer.join();
+    fixture.runInLoop([&] {
+      BOOST_CHECK(received == data);
+      BOOST_CHECK_GE(bytesByIteration.size(), available / kMaxPerIteration + 1);
+      for (const auto& item : bytesByIteration)
+      {
+        BOOST_CHECK_LE(item.second, kMaxPerIteration);
+      }
+    });
+  }
+
+  // writing, file chunks are sent one sendfile(2) at a time
+  {
+    char path[] = "/tmp/tcpconnection_unittest_XXXXXX";
+    int filefd = ::mkstemp(path);
+    BOOST_REQUIRE(filefd >= 0);
+    ::unlink(path);
+    BOOST_REQUIRE_EQUAL(::write(filefd, data.data(), data.size()),
+                        static_cast<ssize_t>(data.size()));
+
+    std::vector<size_t> written;  // in loop, by iteration
+    ConnectionFixture fixture(true, [](const TcpConnectionPtr& conn) {
+      // queued without writing directly, flushed after the iteration
+      conn->setAutoCork(true);
+    });
+    setBufferSizes(fixture.local(), 8 * 1024 * 1024);
+    setBufferSizes(fixture.peer(), 8 * 1024 * 1024);
+    TcpConnectionPtr conn(fixture.conn());
+    std::function<void()> sample;
+    size_t lastBytes = data.size();
+    sample = [&] {
+      size_t bytes = conn->bytesToWrite();
+      written.push_back(lastBytes - bytes);
+      lastBytes = bytes;
+      if (bytes > 0)
+      {
+        fixture.loop()->queueInLoop(sample);
+      }
+    };
+    fixture.runInLoop([&] {
+      const size_t kChunk = 64 * 1024;
+      for (size_t offset = 0; offset < data.size(); offset += kChunk)
+      {
+        conn->sendFile(filefd, static_cast<off_t>(offset), kChunk);
+      }
+      fixture.loop()->queueInLoop(sample);
+    });
+    BOOST_CHECK(readExactly(fixture.peer(), data.size()) == data);
+    fixture.runInLoop([&] {
+      BOOST_CHECK_EQUAL(lastBytes, 0);
+      BOOST_CHECK_GE(written.size(), data.size() / kMaxPerIteration);
+      for (size_t n : written)
+      {
+        BOOST_CHECK_LE(n, kMaxPerIteration);
+      }
+    });
+    ::close(filefd);
+  }
+}
+
+// Shutdown with output waiting for a full socket, it comes after the output.
+BOOST_AUTO_TEST_CASE(testShutdownWhileWriting)
+{
+  const string data = pattern(16 * 1024 * 1024);
+  for (bool edgeTriggered : { false, true })
+  {
+    ConnectionFixture fixture(edgeTriggered);
+    TcpConnectionPtr conn(fixture.conn());
+    bool waiting = false;
+    fixture.runInLoop([&] {
+      conn->send(data.data(), static_cast<int>(data.size()));
+      conn->shutdown();
+      waiting = conn->bytesToWrite() > 0;
+    });
+    BOOST_CHECK(waiting);
+    conn.reset();
+
+    ::usleep(100 * 1000);
+    string received;
+    BOOST_CHECK(readUntilEof(fixture.peer(), &received));
+    BOOST_CHECK(received == data);
+  }
+}
+
+// Auto-cork, pipelined requests are answered in order with one flush at the
+// end of the iteration, then writeCompleteCallback, then the shutdown asked
+// for by the last request.
+BOOST_AUTO_TEST_CASE(testAutoCorkPipelined)
+{
+  const int kRequests = 100;
+  string requests;
+  string expected;
+  for (int i = 0; i < kRequests; ++i)
+  {
+    requests += std::to_string(i) + "\n";
+    expected += "response " + std::to_string(i) + "\n";
+  }
+  requests += "quit\n";
+  expected += "bye\n";
+
+  for (bool edgeTriggered : { false, true })
+  {
+    // in loop
+    std::map<int64_t, int> messagesByIteration;
+    std::map<int64_t, int> completesByIteration;
+    bool allCorked = true;
+    bool drainedOnComplete = true;
+    ConnectionFixture fixture(edgeTriggered, [&](const TcpConnectionPtr& conn) {
+      conn->setAutoCork(true);
+      conn->setMessageCallback([&](const TcpConnectionPtr& c, Buffer* buf, muduo::Timestamp) {
+        ++messagesByIteration[c->getLoop()->iteration()];
+        const char* eol = NULL;
+        while ((eol = buf->findEOL()) != NULL)
+        {
+          string request(buf->peek(), eol);
+          buf->retrieveUntil(eol + 1);
+          string response = request == "quit" ? "bye\n" : "response " + request + "\n";
+          size_t before = c->bytesToWrite();
+          c->send(response);
+          allCorked = allCorked && c->bytesToWrite() == before + response.size();
+          if (request == "quit")
+          {
+            c->shutdown();
+          }
+        }
+      });
+      conn->setWriteCompleteCallback([&](const TcpConnectionPtr& c) {
+        ++completesByIteration[c->getLoop()->iteration()];
+        drainedOnComplete = drainedOnComplete && c->bytesToWrite() == 0;
+      });
+    });
+
+    BOOST_REQUIRE_EQUAL(::write(fixture.peer(), requests.data(), requests.size()),
+                        static_cast<ssize_t>(requests.size()));
+    string received;
+    BOOST_CHECK(readUntilEof(fixture.peer(), &received));
+    BOOST_CHECK_EQUAL(received, expected);
+
+    fixture.runInLoop([&] {
+      BOOST_CHECK(allCorked);
+      BOOST_CHECK(drainedOnComplete);
+      BOOST_CHECK(!messagesByIteration.empty());
+      // one flush for all responses of an iteration, completed in that iteration
+      BOOST_CHECK(completesByIteration.size() == messagesByIteration.size());
+      for (const auto& item : completesByIteration)
+      {
+        BOOST_CHECK_EQUAL(item.second, 1);
+        BOOST_CHECK(messagesByIteration.count(item.first) == 1);
+      }
+    });
+  }
+}
+
+// Destroyed with MSG_ZEROCOPY sends not completed, the message is kept until
+// the kernel is done with it, and the peer still gets what was sent and EOF.
+BOOST_AUTO_TEST_CASE(testDestroyWhileZeroCopyPinned)
+{
+  int on = 1;
+  int probe = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  bool supported = ::setsockopt(probe, SOL_SOCKET, SO_ZEROCOPY, &on, sizeof on) == 0;
+  ::close(probe);
+  if (!supported)
+  {
+    BOOST_TEST_MESSAGE("SO_ZEROCOPY is not supported, skipped");
+    return;
+  }
+
+  for (bool edgeTriggered : { false, true })
+  {
+    ConnectionFixture fixture(edgeTriggered, [](const TcpConnectionPtr& conn) {
+      conn->setZeroCopyThreshold(1);
+    });
+    // larger than the socket buffers, so the peer's window stops the sends
+    std::shared_ptr<const string> message(new string(pattern(32 * 1024 * 1024)));
+    std::weak_ptr<const string> weak(message);
+    TcpConnectionPtr conn(fixture.conn());
+    fixture.runInLoop([&] {
+      conn->send(message);
+      BOOST_CHECK(conn->bytesToWrite() > 0);
+    });
+    message.reset();
+    conn->forceClose();
+    conn.reset();
+    // after forceClose, then after connectDestroyed queued by it
+    fixture.runInLoop([] {});
+    fixture.runInLoop([] {});
+    BOOST_CHECK(!fixture.conn());
+    BOOST_CHECK(!weak.expired());
+
+    string received;
+    BOOST_CHECK(readUntilEof(fixture.peer(), &received));
+    BOOST_CHECK(received.size() > 0);
+    BOOST_CHECK(received == pattern(received.size()));
+    // released once the completions come
+    for (int i = 0; i < 500 && !weak.expired(); ++i)
+    {
+      ::usleep(10 * 1000);
+    }
+    BOOST_CHECK(weak.expired());
+  }
+}
@@ -2,7 +2,12 @@
 #include "muduo/net/EventLoopThread.h"
 #include "muduo/base/Thread.h"
 
+#include <algorithm>
+#include <vector>
+
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 using namespace muduo;
@@ -20,7 +25,7 @@ void printTid()
 void print(const char* msg)
 {
     printf("msg %s %s\n", Timestamp::now().toString().c_str(), msg);
-    if (++cnt == 20)
+    if (++cnt == 25)
     {
         g_loop->quit();
     }
@@ -32,12 +37,99 @@ void cancel(TimerId timer)
     printf("cancelled at %s\n", Timestamp::now().toString().c_str());
 }
 
-int main()
+void reset(TimerId timer, double delay, bool lazy)
+{
+    g_loop->resetTimer(timer, addTime(Timestamp::now(), delay), lazy);
+    printf("reset%s at %s\n", lazy ? " lazily" : "", Timestamp::now().toString().c_str());
+}
+
+const EventLoop::TimerStructure kStructures[] =
+    { EventLoop::kTimerTree, EventLoop::kTimerWheel, EventLoop::kTimerHeap };
+const char* kStructureNames[] = { "tree", "wheel", "heap" };
+
+const char* structureName(EventLoop::TimerStructure structure)
 {
+    return kStructureNames[structure];
+}
+
+enum Rearm { kCancelAdd, kReset, kLazyReset };
+
+// Idle timeouts of many connections, each pushed back on every message.
+void benchRearm(EventLoop::TimerStructure structure, Rearm rearm, int numTimers, int rounds)
+{
+    EventLoop loop;
+    loop.setTimerStructure(structure);
+    std::vector<TimerId> timers;
+    for (int i = 0; i < numTimers; ++i)
+    {
+        timers.push_back(loop.runAfter(60 + i % 1000 * 0.001, [] {}));
+    }
+    Timestamp start(Timestamp::now());
+    for (int r = 0; r < rounds; ++r)
+    {
+        for (int i = 0; i < numTimers; ++i)
+        {
+            if (rearm == kCancelAdd)
+            {
+                loop.cancel(timers[i]);
+                timers[i] = loop.runAfter(60 + i % 1000 * 0.001, [] {});
+            }
+            else
+            {
+                Timestamp when(addTime(Timestamp::now(), 60 + i % 1000 * 0.001));
+                loop.resetTimer(timers[i], when, rearm == kLazyReset);
+            }
+        }
+    }
+    double seconds = timeDifference(Timestamp::now(), start);
+    const char* names[] = { "cancel+add", "reset", "lazy reset" };
+    printf("%-6s %-10s %8d timers %10.0f per second\n", structureName(structure),
+           names[rearm], numTimers, numTimers * rounds / seconds);
+}
+
+// Many timers expiring within a second, how late they run.
+void benchExpire(EventLoop::TimerStructure structure, int numTimers)
+{
+    EventLoop loop;
+    loop.setTimerStructure(structure);
+    int fired = 0;
+    double maxLate = 0;
+    Timestamp start(Timestamp::now());
+    for (int i = 0; i < numTimers; ++i)
+    {
+        Timestamp when(addTime(start, 0.1 + static_cast<double>(i % 900) * 0.001));
+        loop.runAt(when, [&, when] {
+            maxLate = std::max(maxLate, timeDifference(Timestamp::now(), when));
+            if (++fired == numTimers)
+            {
+                loop.quit();
+            }
+        });
+    }
+    loop.loop();
+    printf("%-6s expire %8d timers, at most %.3f ms late\n",
+           structureName(structure), fired, maxLate * 1000);
+}
+
+// usage: timerqueue_unittest [tree|wheel|heap [timers]]
+int main(int argc, char* argv[])
+{
+    EventLoop::TimerStructure structure = EventLoop::kTimerTree;
+    for (EventLoop::TimerStructure s : kStructures)
+    {
+        if (argc > 1 && strcmp(argv[1], structureName(s)) == 0)
+        {
+            structure = s;
+        }
+    }
+    int numTimers = argc > 2 ? atoi(argv[2]) : 100000;
+
     printTid();
+    printf("%s\n", structureName(structure));
     sleep(1);
     {
         EventLoop loop;
+        loop.setTimerStructure(structure);
         g_loop = &loop;
 
         print("main");
@@ -51,16 +143,39 @@ int main()
         loop.runEvery(2, std::bind(print, "every2"));
         TimerId t3 = loop.runEvery(3, std::bind(print, "every3"));
         loop.runAfter(9.001, std::bind(cancel, t3));
+        TimerId t55 = loop.runAfter(5.5, std::bind(print, "once5.5 reset to 6.5"));
+        loop.runAfter(5, std::bind(reset, t55, 1.5, true));
+        TimerId t75 = loop.runAfter(7.5, std::bind(print, "once7.5 reset to 6.8"));
+        loop.runAfter(5.2, std::bind(reset, t75, 1.6, false));
+        loop.runAfterCoarse(3.2, std::bind(print, "coarse once3.2"));
+        TimerId tc27 = loop.runEveryCoarse(2.7, std::bind(print, "coarse every2.7"));
+        loop.runAfter(6, std::bind(cancel, tc27));
+        TimerId tc46 = loop.runAfterCoarse(4.6, std::bind(print, "coarse once4.6"));
+        loop.runAfter(4.3, std::bind(cancel, tc46));
 
         loop.loop();
         print("main loop exits");
     }
     sleep(1);
     {
-        EventLoopThread loopThread;
+        EventLoopThread loopThread([structure](EventLoop* loop) {
+            loop->setTimerStructure(structure);
+        });
         EventLoop* loop = loopThread.startLoop();
         loop->runAfter(2, printTid);
         sleep(3);
         print("thread loop exits");
     }
+
+    for (Rearm rearm : { kCancelAdd, kReset, kLazyReset })
+    {
+        for (EventLoop::TimerStructure s : kStructures)
+        {
+            benchRearm(s, rearm, numTimers, 5);
+        }
+    }
+    for (EventLoop::TimerStructure s : kStructures)
+    {
+        benchExpire(s, numTimers);
+    }
 }
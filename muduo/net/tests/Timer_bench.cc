@@ -0,0 +1,224 @@
+#include "muduo/net/EventLoop.h"
+
+#include "muduo/base/Timestamp.h"
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <vector>
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// Adds, cancels and expires many timers in one loop, with each
+// TimerStructure, as coarse timers, and with what TimerQueue used to do.
+// Reports operations per second of the loop thread, heap bytes per timer,
+// and how many times the loop woke up to expire them.
+//
+// usage: timer_bench [timers]
+
+double threadCpuSeconds()
+{
+  struct timespec ts;
+  ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) * 1e-9;
+}
+
+size_t heapBytes()
+{
+  return mallinfo2().uordblks;
+}
+
+// what TimerQueue used to do, a Timer allocated per add, in two sets
+class TwoSets : noncopyable
+{
+ public:
+  struct Timer
+  {
+    Timer(TimerCallback cb, Timestamp when, int64_t seq)
+      : callback(std::move(cb)), expiration(when), sequence(seq) {}
+    TimerCallback callback;
+    Timestamp expiration;
+    int64_t sequence;
+  };
+  typedef std::pair<Timer*, int64_t> Id;
+
+  ~TwoSets()
+  {
+    for (const Entry& entry : timers_)
+    {
+      delete entry.second;
+    }
+  }
+
+  Id add(TimerCallback cb, Timestamp when)
+  {
+    Timer* timer = new Timer(std::move(cb), when, ++sequence_);
+    timers_.insert(Entry(when, timer));
+    activeTimers_.insert(Id(timer, timer->sequence));
+    return Id(timer, timer->sequence);
+  }
+
+  void cancel(Id id)
+  {
+    std::set<Id>::iterator it = activeTimers_.find(id);
+    if (it != activeTimers_.end())
+    {
+      timers_.erase(Entry(it->first->expiration, it->first));
+      delete it->first;
+      activeTimers_.erase(it);
+    }
+  }
+
+  size_t expire(Timestamp now)
+  {
+    std::vector<Entry> expired;
+    Entry sentry(now, reinterpret_cast<Timer*>(UINTPTR_MAX));
+    std::set<Entry>::iterator end = timers_.lower_bound(sentry);
+    std::copy(timers_.begin(), end, back_inserter(expired));
+    timers_.erase(timers_.begin(), end);
+    for (const Entry& entry : expired)
+    {
+      activeTimers_.erase(Id(entry.second, entry.second->sequence));
+      entry.second->callback();
+      delete entry.second;
+    }
+    return expired.size();
+  }
+
+ private:
+  typedef std::pair<Timestamp, Timer*> Entry;
+  std::set<Entry> timers_;
+  std::set<Id> activeTimers_;
+  int64_t sequence_ = 0;
+};
+
+void report(const char* name, int numTimers, double addSeconds, double cancelSeconds,
+            double expireSeconds, int64_t wakeups, size_t bytes)
+{
+  printf("%-10s %10.0f adds/s %10.0f cancels/s %10.0f expires/s %6lld wakeups"
+         " %6zu bytes/timer\n",
+         name, numTimers / addSeconds, numTimers / cancelSeconds,
+         numTimers / expireSeconds, static_cast<long long>(wakeups), bytes / numTimers);
+}
+
+void benchTwoSets(const std::vector<double>& delays, const std::vector<int>& order)
+{
+  const int numTimers = static_cast<int>(delays.size());
+  std::vector<TwoSets::Id> ids(delays.size());
+  TwoSets timers;
+  Timestamp now(Timestamp::now());
+  size_t bytes = heapBytes();
+  double start = threadCpuSeconds();
+  for (int i = 0; i < numTimers; ++i)
+  {
+    ids[i] = timers.add([] {}, addTime(now, 10 + delays[i]));
+  }
+  double added = threadCpuSeconds();
+  bytes = heapBytes() - bytes;
+  for (int i : order)
+  {
+    timers.cancel(ids[i]);
+  }
+  double canceled = threadCpuSeconds();
+
+  // due after all are added
+  now = addTime(Timestamp::now(), 3);
+  for (int i = 0; i < numTimers; ++i)
+  {
+    timers.add([] {}, addTime(now, delays[i]));
+  }
+  // checked every millisecond, like the ticks of the wheel
+  EventLoop loop;
+  size_t expired = 0;
+  loop.runAt(now, [&] {
+    loop.runEvery(0.001, [&] {
+      expired += timers.expire(Timestamp::now());
+      if (expired == delays.size())
+      {
+        loop.quit();
+      }
+    });
+  });
+  double expireStart = threadCpuSeconds();
+  loop.loop();
+  report("two sets", numTimers, added - start, canceled - added,
+         threadCpuSeconds() - expireStart, loop.iteration(), bytes);
+}
+
+void bench(const char* name, EventLoop::TimerStructure structure, bool coarse,
+           const std::vector<double>& delays, const std::vector<int>& order)
+{
+  const int numTimers = static_cast<int>(delays.size());
+  std::vector<TimerId> ids(delays.size());
+  EventLoop loop;
+  loop.setTimerStructure(structure);
+  Timestamp now(Timestamp::now());
+  size_t bytes = heapBytes();
+  double start = threadCpuSeconds();
+  for (int i = 0; i < numTimers; ++i)
+  {
+    ids[i] = coarse ? loop.runAfterCoarse(10 + delays[i], [] {})
+                    : loop.runAt(addTime(now, 10 + delays[i]), [] {});
+  }
+  double added = threadCpuSeconds();
+  bytes = heapBytes() - bytes;
+  for (int i : order)
+  {
+    loop.cancel(ids[i]);
+  }
+  double canceled = threadCpuSeconds();
+
+  // recycled timers, as in a long running loop, due after all are added
+  now = addTime(Timestamp::now(), 3);
+  int expired = 0;
+  TimerCallback cb = [&] {
+    if (++expired == numTimers)
+    {
+      loop.quit();
+    }
+  };
+  for (int i = 0; i < numTimers; ++i)
+  {
+    if (coarse)
+    {
+      loop.runAfterCoarse(timeDifference(now, Timestamp::now()) + delays[i], cb);
+    }
+    else
+    {
+      loop.runAt(addTime(now, delays[i]), cb);
+    }
+  }
+  int64_t iteration = loop.iteration();
+  double expireStart = threadCpuSeconds();
+  loop.loop();
+  report(name, numTimers, added - start, canceled - added,
+         threadCpuSeconds() - expireStart, loop.iteration() - iteration, bytes);
+}
+
+int main(int argc, char* argv[])
+{
+  int numTimers = argc > 1 ? atoi(argv[1]) : 1000000;
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<double> delay(0.05, 0.55);
+  std::vector<double> delays;
+  std::vector<int> order;
+  for (int i = 0; i < numTimers; ++i)
+  {
+    delays.push_back(delay(rng));
+    order.push_back(i);
+  }
+  std::shuffle(order.begin(), order.end(), rng);
+
+  printf("%d timers\n", numTimers);
+  benchTwoSets(delays, order);
+  bench("tree", EventLoop::kTimerTree, false, delays, order);
+  bench("wheel", EventLoop::kTimerWheel, false, delays, order);
+  bench("heap", EventLoop::kTimerHeap, false, delays, order);
+  bench("coarse", EventLoop::kTimerTree, true, delays, order);
+}
@@ -0,0 +1,153 @@
+#include "muduo/net/TcpClient.h"
+#include "muduo/net/TcpServer.h"
+
+#include "muduo/base/CountDownLatch.h"
+#include "muduo/base/Logging.h"
+#include "muduo/net/EventLoop.h"
+#include "muduo/net/EventLoopThread.h"
+#include "muduo/net/InetAddress.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// Sends total_mb of message_kb messages to a discard server, with plain
+// write(2) and with MSG_ZEROCOPY, reports throughput and the CPU time of
+// the sending thread.
+//
+// Without peer_ip it runs its own discard server over loopback, where the
+// kernel copies MSG_ZEROCOPY sends anyway, so run it against another host,
+// eg. examples/simple/discard, to see the difference.
+//
+// usage: zerocopy_bench [message_kb [total_mb [peer_ip [port]]]]
+
+double threadCpuSeconds()
+{
+  struct timespec ts;
+  ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) * 1e-9;
+}
+
+class Sender : noncopyable
+{
+ public:
+  Sender(EventLoop* loop, const InetAddress& peerAddr,
+         size_t messageSize, int64_t totalBytes, size_t zeroCopyThreshold)
+    : loop_(loop),
+      client_(loop, peerAddr, "Sender"),
+      message_(std::make_shared<const string>(messageSize, 'z')),
+      totalBytes_(totalBytes),
+      sentBytes_(0),
+      zeroCopyThreshold_(zeroCopyThreshold),
+      cpuStart_(0),
+      cpuSeconds_(0)
+  {
+    client_.setConnectionCallback(
+        std::bind(&Sender::onConnection, this, _1));
+    client_.setWriteCompleteCallback(
+        std::bind(&Sender::onWriteComplete, this, _1));
+  }
+
+  void start()
+  {
+    client_.connect();
+  }
+
+  double cpuSeconds() const { return cpuSeconds_; }
+
+ private:
+  void onConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      conn->setZeroCopyThreshold(zeroCopyThreshold_);
+      start_ = Timestamp::now();
+      cpuStart_ = threadCpuSeconds();
+      onWriteComplete(conn);
+    }
+    else
+    {
+      loop_->quit();
+    }
+  }
+
+  void onWriteComplete(const TcpConnectionPtr& conn)
+  {
+    if (sentBytes_ < totalBytes_)
+    {
+      sentBytes_ += static_cast<int64_t>(message_->size());
+      conn->send(message_);
+    }
+    else
+    {
+      cpuSeconds_ = threadCpuSeconds() - cpuStart_;
+      double seconds = timeDifference(Timestamp::now(), start_);
+      printf("%-10s %8.2f MiB/s  %6.3f cpu seconds\n",
+             zeroCopyThreshold_ > 0 ? "zerocopy" : "write",
+             static_cast<double>(sentBytes_) / seconds / 1024 / 1024,
+             cpuSeconds_);
+      conn->shutdown();
+    }
+  }
+
+  EventLoop* loop_;
+  TcpClient client_;
+  std::shared_ptr<const string> message_;
+  const int64_t totalBytes_;
+  int64_t sentBytes_;
+  const size_t zeroCopyThreshold_;
+  Timestamp start_;
+  double cpuStart_;
+  double cpuSeconds_;
+};
+
+void startDiscardServer(EventLoop* loop, const InetAddress& listenAddr,
+                        std::unique_ptr<TcpServer>* server, CountDownLatch* latch)
+{
+  server->reset(new TcpServer(loop, listenAddr, "Discard"));
+  (*server)->setMessageCallback(
+      [](const TcpConnectionPtr&, Buffer* buf, Timestamp) { buf->retrieveAll(); });
+  (*server)->start();
+  latch->countDown();
+}
+
+int main(int argc, char* argv[])
+{
+  Logger::setLogLevel(Logger::WARN);
+  size_t messageSize = (argc > 1 ? atoi(argv[1]) : 1024) * 1024;
+  int64_t totalBytes = static_cast<int64_t>(argc > 2 ? atoi(argv[2]) : 4096) * 1024 * 1024;
+  uint16_t port = static_cast<uint16_t>(argc > 4 ? atoi(argv[4]) : 9999);
+
+  EventLoopThread discardThread;
+  EventLoop* discardLoop = NULL;
+  std::unique_ptr<TcpServer> discardServer;
+  InetAddress peerAddr(argc > 3 ? argv[3] : "127.0.0.1", port);
+  if (argc <= 3)
+  {
+    discardLoop = discardThread.startLoop();
+    CountDownLatch latch(1);
+    discardLoop->runInLoop(
+        std::bind(startDiscardServer, discardLoop, InetAddress(port), &discardServer, &latch));
+    latch.wait();
+  }
+
+  printf("%zu bytes per message, %lld bytes in total\n",
+         messageSize, static_cast<long long>(totalBytes));
+  const size_t thresholds[] = { 0, 64 * 1024 };
+  for (size_t threshold : thresholds)
+  {
+    EventLoop loop;
+    Sender sender(&loop, peerAddr, messageSize, totalBytes, threshold);
+    sender.start();
+    loop.loop();
+  }
+  if (discardLoop)
+  {
+    CountDownLatch latch(1);
+    discardLoop->runInLoop([&] { discardServer.reset(); latch.countDown(); });
+    latch.wait();
+  }
+}
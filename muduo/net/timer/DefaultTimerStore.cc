@@ -0,0 +1,36 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include "muduo/net/TimerStore.h"
+#include "muduo/net/timer/HeapTimerStore.h"
+#include "muduo/net/timer/TreeTimerStore.h"
+#include "muduo/net/timer/WheelTimerStore.h"
+
+using namespace muduo::net;
+
+namespace
+{
+    const int64_t kWheelTickMicroSeconds = 1000;
+    const int64_t kCoarseTickMicroSeconds = 10 * 1000;
+}
+
+TimerStore* TimerStore::newTimerStore(EventLoop::TimerStructure structure)
+{
+    switch (structure)
+    {
+    case EventLoop::kTimerWheel:
+        return new WheelTimerStore(kWheelTickMicroSeconds);
+    case EventLoop::kTimerHeap:
+        return new HeapTimerStore;
+    case EventLoop::kTimerTree:
+    default:
+        return new TreeTimerStore;
+    }
+}
+
+TimerStore* TimerStore::newCoarseTimerStore()
+{
+    return new WheelTimerStore(kCoarseTickMicroSeconds);
+}
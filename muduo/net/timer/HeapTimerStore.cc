@@ -0,0 +1,112 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include "muduo/net/timer/HeapTimerStore.h"
+
+#include "muduo/net/Timer.h"
+
+#include <assert.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+void HeapTimerStore::insert(Timer* timer)
+{
+    heap_.push_back(timer);
+    timer->set_index(static_cast<int>(heap_.size() - 1));
+    siftUp(heap_.size() - 1);
+}
+
+void HeapTimerStore::erase(Timer* timer)
+{
+    const size_t index = static_cast<size_t>(timer->index());
+    assert(index < heap_.size() && heap_[index] == timer);
+    removeAt(index);
+}
+
+void HeapTimerStore::popExpired(Timestamp now, std::vector<Timer*>* expired)
+{
+    while (!heap_.empty() && !(now < heap_.front()->expiration()))
+    {
+        expired->push_back(heap_.front());
+        removeAt(0);
+    }
+}
+
+Timestamp HeapTimerStore::nextExpiration() const
+{
+    return heap_.empty() ? Timestamp() : heap_.front()->expiration();
+}
+
+void HeapTimerStore::siftUp(size_t index)
+{
+    Timer* timer = heap_[index];
+    while (index > 0)
+    {
+        const size_t parent = (index - 1) / kArity;
+        if (!(timer->expiration() < heap_[parent]->expiration()))
+        {
+            break;
+        }
+        place(heap_[parent], index);
+        index = parent;
+    }
+    place(timer, index);
+}
+
+void HeapTimerStore::siftDown(size_t index)
+{
+    Timer* timer = heap_[index];
+    const size_t size = heap_.size();
+    while (true)
+    {
+        const size_t first = index * kArity + 1;
+        if (first >= size)
+        {
+            break;
+        }
+        const size_t last = first + kArity < size ? first + kArity : size;
+        size_t least = first;
+        for (size_t child = first + 1; child < last; ++child)
+        {
+            if (heap_[child]->expiration() < heap_[least]->expiration())
+            {
+                least = child;
+            }
+        }
+        if (!(heap_[least]->expiration() < timer->expiration()))
+        {
+            break;
+        }
+        place(heap_[least], index);
+        index = least;
+    }
+    place(timer, index);
+}
+
+void HeapTimerStore::place(Timer* timer, size_t index)
+{
+    heap_[index] = timer;
+    timer->set_index(static_cast<int>(index));
+}
+
+void HeapTimerStore::removeAt(size_t index)
+{
+    heap_[index]->set_index(-1);
+    Timer* last = heap_.back();
+    heap_.pop_back();
+    if (index < heap_.size())
+    {
+        place(last, index);
+        if (index > 0 && last->expiration() < heap_[(index - 1) / kArity]->expiration())
+        {
+            siftUp(index);
+        }
+        else
+        {
+            siftDown(index);
+        }
+    }
+}
@@ -0,0 +1,46 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_TIMER_HEAPTIMERSTORE_H
+#define MUDUO_NET_TIMER_HEAPTIMERSTORE_H
+
+#include "muduo/net/TimerStore.h"
+
+namespace muduo
+{
+    namespace net
+    {
+        ///
+        /// Timers in a 4-ary min-heap, by exact expiration.
+        ///
+        /// Each timer keeps its position in Timer::index(), for O(log n) erase.
+        /// Shallower than a binary heap, and the children of a node share
+        /// a cache line or two.
+        ///
+        class HeapTimerStore : public TimerStore
+        {
+        public:
+            void insert(Timer* timer) override;
+            void erase(Timer* timer) override;
+            void popExpired(Timestamp now, std::vector<Timer*>* expired) override;
+            Timestamp nextExpiration() const override;
+            size_t size() const override { return heap_.size(); }
+
+        private:
+            static const size_t kArity = 4;
+
+            void siftUp(size_t index);
+            void siftDown(size_t index);
+            void place(Timer* timer, size_t index);
+            void removeAt(size_t index);
+
+            std::vector<Timer*> heap_;
+        };
+    } // namespace net
+} // namespace muduo
+
+#endif  // MUDUO_NET_TIMER_HEAPTIMERSTORE_H
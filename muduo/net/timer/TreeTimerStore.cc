@@ -0,0 +1,48 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef __STDC_LIMIT_MACROS
+#define __STDC_LIMIT_MACROS
+#endif
+
+#include "muduo/net/timer/TreeTimerStore.h"
+
+#include "muduo/net/Timer.h"
+
+#include <assert.h>
+#include <stdint.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+void TreeTimerStore::insert(Timer* timer)
+{
+    std::pair<TimerList::iterator, bool> result
+        = timers_.insert(Entry(timer->expiration(), timer));
+    assert(result.second); (void)result;
+}
+
+void TreeTimerStore::erase(Timer* timer)
+{
+    size_t n = timers_.erase(Entry(timer->expiration(), timer));
+    assert(n == 1); (void)n;
+}
+
+void TreeTimerStore::popExpired(Timestamp now, std::vector<Timer*>* expired)
+{
+    Entry sentry(now, reinterpret_cast<Timer*>(UINTPTR_MAX));
+    TimerList::iterator end = timers_.lower_bound(sentry);
+    assert(end == timers_.end() || now < end->first);
+    for (TimerList::iterator it = timers_.begin(); it != end; ++it)
+    {
+        expired->push_back(it->second);
+    }
+    timers_.erase(timers_.begin(), end);
+}
+
+Timestamp TreeTimerStore::nextExpiration() const
+{
+    return timers_.empty() ? Timestamp() : timers_.begin()->first;
+}
@@ -0,0 +1,40 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_TIMER_TREETIMERSTORE_H
+#define MUDUO_NET_TIMER_TREETIMERSTORE_H
+
+#include "muduo/net/TimerStore.h"
+
+#include <set>
+
+namespace muduo
+{
+    namespace net
+    {
+        ///
+        /// Timers in a std::set, sorted by expiration, O(log n) each operation.
+        ///
+        class TreeTimerStore : public TimerStore
+        {
+        public:
+            void insert(Timer* timer) override;
+            void erase(Timer* timer) override;
+            void popExpired(Timestamp now, std::vector<Timer*>* expired) override;
+            Timestamp nextExpiration() const override;
+            size_t size() const override { return timers_.size(); }
+
+        private:
+            typedef std::pair<Timestamp, Timer*> Entry;
+            typedef std::set<Entry> TimerList;
+
+            TimerList timers_;
+        };
+    } // namespace net
+} // namespace muduo
+
+#endif  // MUDUO_NET_TIMER_TREETIMERSTORE_H
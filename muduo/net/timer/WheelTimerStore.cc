@@ -0,0 +1,191 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef __STDC_LIMIT_MACROS
+#define __STDC_LIMIT_MACROS
+#endif
+
+#include "muduo/net/timer/WheelTimerStore.h"
+
+#include "muduo/net/Timer.h"
+
+#include <algorithm>
+
+#include <assert.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+    uint64_t rotateRight(uint64_t bits, int n)
+    {
+        return n == 0 ? bits : (bits >> n) | (bits << (64 - n));
+    }
+}
+
+WheelTimerStore::WheelTimerStore(int64_t tickMicroSeconds)
+    : tickMicroSeconds_(tickMicroSeconds),
+      current_(Timestamp::now().microSecondsSinceEpoch() / tickMicroSeconds),
+      size_(0)
+{
+    assert(tickMicroSeconds_ > 0);
+    memZero(occupied_, sizeof occupied_);
+    memZero(slots_, sizeof slots_);
+}
+
+void WheelTimerStore::insert(Timer* timer)
+{
+    if (size_ == 0)
+    {
+        // nothing to move down, catches up with the clock, so that
+        // the timer goes to the level it belongs to
+        current_ = std::max(current_,
+                            Timestamp::now().microSecondsSinceEpoch() / tickMicroSeconds_);
+    }
+    link(timer);
+    ++size_;
+}
+
+void WheelTimerStore::erase(Timer* timer)
+{
+    unlink(timer);
+    --size_;
+}
+
+void WheelTimerStore::popExpired(Timestamp now, std::vector<Timer*>* expired)
+{
+    const int64_t last = now.microSecondsSinceEpoch() / tickMicroSeconds_;
+    while (size_ > 0)
+    {
+        const int64_t tick = nextTick();
+        if (tick > last)
+        {
+            break;
+        }
+        current_ = tick;
+        for (int level = kLevels - 1; level > 0; --level)
+        {
+            if ((tick & ((static_cast<int64_t>(1) << (kSlotBits * level)) - 1)) == 0)
+            {
+                cascade(level, tick);
+            }
+        }
+        const int slot = static_cast<int>(tick & (kSlots - 1));
+        while (Timer* timer = slots_[slot])
+        {
+            unlink(timer);
+            --size_;
+            expired->push_back(timer);
+        }
+        current_ = tick + 1;
+    }
+    // skipped ticks had nothing to expire or move down
+    current_ = std::max(current_, last + 1);
+}
+
+Timestamp WheelTimerStore::nextExpiration() const
+{
+    return size_ == 0 ? Timestamp() : Timestamp(nextTick() * tickMicroSeconds_);
+}
+
+int64_t WheelTimerStore::tickOf(Timestamp when) const
+{
+    // rounds up, never expires early
+    return (when.microSecondsSinceEpoch() + tickMicroSeconds_ - 1) / tickMicroSeconds_;
+}
+
+// The first tick, from current_ on, a non-empty slot expires at level 0,
+// or is moved down at a level above.  A slot of level n comes up when
+// the tick is a multiple of 64^n, and its index matches.
+int64_t WheelTimerStore::nextTick() const
+{
+    int64_t next = INT64_MAX;
+    for (int level = 0; level < kLevels; ++level)
+    {
+        if (occupied_[level] != 0)
+        {
+            const int shift = kSlotBits * level;
+            const int64_t group = (current_ + (static_cast<int64_t>(1) << shift) - 1) >> shift;
+            const uint64_t bits = rotateRight(occupied_[level],
+                                              static_cast<int>(group & (kSlots - 1)));
+            next = std::min(next, (group + __builtin_ctzll(bits)) << shift);
+        }
+    }
+    return next;
+}
+
+void WheelTimerStore::link(Timer* timer)
+{
+    int64_t tick = std::max(tickOf(timer->expiration()), current_);
+    const int64_t delta = tick - current_;
+    int level = 0;
+    while (level < kLevels - 1 && (delta >> (kSlotBits * (level + 1))) != 0)
+    {
+        ++level;
+    }
+    const int64_t span = static_cast<int64_t>(1) << (kSlotBits * kLevels);
+    if (delta >= span)
+    {
+        // moved down, and back here, until it is within reach
+        tick = current_ + span - 1;
+    }
+
+    const int index = static_cast<int>((tick >> (kSlotBits * level)) & (kSlots - 1));
+    const int slot = level * kSlots + index;
+    Timer* head = slots_[slot];
+    timer->set_prev(NULL);
+    timer->set_next(head);
+    if (head)
+    {
+        head->set_prev(timer);
+    }
+    slots_[slot] = timer;
+    timer->set_index(slot);
+    occupied_[level] |= static_cast<uint64_t>(1) << index;
+}
+
+void WheelTimerStore::unlink(Timer* timer)
+{
+    const int slot = timer->index();
+    assert(slot >= 0 && slot < kLevels * kSlots);
+    Timer* prev = timer->prev();
+    Timer* next = timer->next();
+    if (prev)
+    {
+        prev->set_next(next);
+    }
+    else
+    {
+        assert(slots_[slot] == timer);
+        slots_[slot] = next;
+        if (next == NULL)
+        {
+            occupied_[slot / kSlots] &= ~(static_cast<uint64_t>(1) << (slot % kSlots));
+        }
+    }
+    if (next)
+    {
+        next->set_prev(prev);
+    }
+    timer->set_prev(NULL);
+    timer->set_next(NULL);
+    timer->set_index(-1);
+}
+
+void WheelTimerStore::cascade(int level, int64_t tick)
+{
+    const int index = static_cast<int>((tick >> (kSlotBits * level)) & (kSlots - 1));
+    const int slot = level * kSlots + index;
+    Timer* timer = slots_[slot];
+    slots_[slot] = NULL;
+    occupied_[level] &= ~(static_cast<uint64_t>(1) << index);
+    while (timer)
+    {
+        Timer* next = timer->next();
+        link(timer);
+        timer = next;
+    }
+}
@@ -0,0 +1,58 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_TIMER_WHEELTIMERSTORE_H
+#define MUDUO_NET_TIMER_WHEELTIMERSTORE_H
+
+#include "muduo/net/TimerStore.h"
+
+#include <stdint.h>
+
+namespace muduo
+{
+    namespace net
+    {
+        ///
+        /// Hashed hierarchical timing wheel, O(1) insert and erase.
+        ///
+        /// Timers are rounded up to ticks.  Level 0 has a slot per tick for
+        /// the next 64 ticks, each level above has a slot per 64 slots of the
+        /// level below, timers move down a level when their slot comes up.
+        /// Timers beyond the top level wait in its last slot.
+        ///
+        class WheelTimerStore : public TimerStore
+        {
+        public:
+            explicit WheelTimerStore(int64_t tickMicroSeconds);
+
+            void insert(Timer* timer) override;
+            void erase(Timer* timer) override;
+            void popExpired(Timestamp now, std::vector<Timer*>* expired) override;
+            Timestamp nextExpiration() const override;
+            size_t size() const override { return size_; }
+
+        private:
+            static const int kLevels = 5;
+            static const int kSlotBits = 6;
+            static const int kSlots = 1 << kSlotBits;
+
+            int64_t tickOf(Timestamp when) const;
+            int64_t nextTick() const;
+            void link(Timer* timer);
+            void unlink(Timer* timer);
+            void cascade(int level, int64_t tick);
+
+            const int64_t tickMicroSeconds_;
+            int64_t current_;  // the first tick not handled
+            size_t size_;
+            uint64_t occupied_[kLevels];  // a bit per non-empty slot
+            Timer* slots_[kLevels * kSlots];  // intrusive lists
+        };
+    } // namespace net
+} // namespace muduo
+
+#endif  // MUDUO_NET_TIMER_WHEELTIMERSTORE_H